@@ -10,6 +10,7 @@
 #include <tf/transform_listener.h>
 
 class ObstacleCloud;
+class PoseTracker;
 
 class CollisionAvoider
 {
@@ -30,7 +31,7 @@ public:
 
     virtual ~CollisionAvoider() {}
 
-    void setTransformListener(const tf::TransformListener *tf_listener);
+    void setPoseTracker(PoseTracker *pose_tracker);
     void setRobotFrameId(const std::string& frame_id);
 
     bool hasObstacles() const;
@@ -53,7 +54,7 @@ protected:
 protected:
     std::shared_ptr<ObstacleCloud const> obstacles_;
 
-    const tf::TransformListener *tf_listener_;
+    PoseTracker *pose_tracker_;
     std::string robot_frame_;
 };
 
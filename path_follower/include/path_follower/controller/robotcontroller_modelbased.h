@@ -171,7 +171,6 @@ protected:
     Waypoint target_;
     Waypoint goal_;
     std::vector<cv::Point3f> currentPath_;
-    tf::Transformer* transformer_;
     int commandStatus;
     bool doPlan_;
     ModelBasedPlannerConfig config;
@@ -203,7 +202,7 @@ protected:
 
     void imageCallback (const sensor_msgs::ImageConstPtr& image);
 
-    bool GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::StampedTransform &trans);
+    bool GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::Transform &trans);
 
     void TransformPath(tf::Transform trans);
 
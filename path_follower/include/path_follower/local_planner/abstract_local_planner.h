@@ -47,7 +47,7 @@ public:
     virtual bool isNull() const;
 
     void setObstacleCloud(const std::shared_ptr<ObstacleCloud const> &msg);
-    void setElevationMap(const std::shared_ptr<ElevationMap const> &msg);
+    virtual void setElevationMap(const std::shared_ptr<ElevationMap const> &msg);
 
 
     void addConstraint(Constraint::Ptr constraint);
@@ -73,7 +73,6 @@ protected:
 protected:
     RobotController* controller_;
     PoseTracker* pose_tracker_;
-    tf::Transformer* transformer_;
 
     const LocalPlannerParameters* opt_;
 
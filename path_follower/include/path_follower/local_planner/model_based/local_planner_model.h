@@ -7,6 +7,7 @@
 
 /// SYSTEM
 #include <ros/time.h>
+#include <sensor_msgs/Image.h>
 
 /// LIBRARIES
 #include <model_based_planner/imodelbasedplanner.h>
@@ -33,6 +34,8 @@ public:
 
     virtual void reset() override;
 
+    virtual void setElevationMap(const std::shared_ptr<ElevationMap const> &msg) override;
+
     Path::Ptr updateLocalPath_BaseLink();
     Path::Ptr updateLocalPath_LocalMap();
 
@@ -69,7 +72,7 @@ private:
 
     bool transformWPS(std::string source, std::string target, SubPath &waypoints, ros::Time& now);
 
-    bool GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::StampedTransform &trans);
+    bool GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::Transform &trans);
 
     void printTimeUsage();
 
@@ -96,6 +99,9 @@ protected:
 
     std::vector<cv::Point3f> currentPath_;
 
+    //! Elevation map message that was last passed to the planner
+    sensor_msgs::ImageConstPtr uploaded_dem_;
+
 
     ros::Time last_update_;
 
@@ -28,6 +28,8 @@ public:
     P<std::string> model_planner_type;
     P<std::string> model_node_expander_type;
     P<std::string> model_scorer_type;
+    P<std::string> descriptor_cache_dir;
+    P<bool> use_dem_pyramid;
 
 
 
@@ -36,6 +38,11 @@ public:
     P<int> max_depth; //        int maxLevel;
     P<int> curve_segment_subdivisions;//        int numSubSamples;
     P<double> look_ahead_time;//        float lookAheadTime;
+    P<int> num_threads;//        int numThreads;
+    P<bool> use_closed_set;//        bool useClosedSet;
+    P<double> closed_set_distance;//        float closedSetDist;
+    P<double> closed_set_rotation;//        float closedSetRot;
+    P<int> pose_batch_size;//        int poseBatchSize;
 
     //
 
@@ -100,6 +107,8 @@ public:
         config.plannerType_ = model_planner_type();
         config.nodeExpanderType_ = model_node_expander_type();
         config.scorerType_ = model_scorer_type();
+        config.procConfig_.descriptorCacheDir = descriptor_cache_dir();
+        config.procConfig_.useDemPyramid = use_dem_pyramid();
 
 
         //Planner
@@ -107,6 +116,11 @@ public:
         config.plannerConfig_.maxLevel = max_depth();
         config.plannerConfig_.numSubSamples = curve_segment_subdivisions();
         config.plannerConfig_.lookAheadTime = look_ahead_time();
+        config.plannerConfig_.numThreads = num_threads();
+        config.plannerConfig_.useClosedSet = use_closed_set();
+        config.plannerConfig_.closedSetDist = closed_set_distance();
+        config.plannerConfig_.closedSetRot = closed_set_rotation();
+        config.plannerConfig_.poseBatchSize = pose_batch_size();
 
 
         //Scorer
@@ -177,11 +191,18 @@ public:
         model_planner_type(this, "model_planner_type", "AStar", "Type of model based planner used"),
         model_node_expander_type(this, "model_node_expander_type", "angular_vel", "Type of node expander used"),
         model_scorer_type(this, "model_scorer_type", "path_scorer", "Type of model based scorer used"),
+        descriptor_cache_dir(this, "descriptor_cache_dir", "~/.ros/model_based_planner", "Directory of the cache for rendered wheel and chassis templates, empty disables the cache"),
+        use_dem_pyramid(this, "use_dem_pyramid", true, "Reject or accept poses with a coarse min/max pyramid of the DEM before the full wheel and chassis tests"),
         // Planner
         max_num_nodes(this, "max_num_nodes", 10000, "Determines the maximum number of nodes used by the local planner"),
         max_depth(this, "max_depth", 3, "Determines the maximum depth of the tree used by the local planner"),
         curve_segment_subdivisions(this, "curve_segment_subdivisions", 20, "Determines the number of subdivisions of curve segments in the final path"),
         look_ahead_time(this, "look_ahead_time", 3.0, "look ahead time for model based planner"),
+        num_threads(this, "num_threads", 1, "Number of threads for the evaluation of the trajectories of the model based planner (1 = single threaded, <= 0 = one per core)"),
+        use_closed_set(this, "use_closed_set", true, "Prune nodes of the model based planner that end close to an already expanded node of the same depth"),
+        closed_set_distance(this, "closed_set_distance", 1.0, "Cell size of the closed set in DEM pixels"),
+        closed_set_rotation(this, "closed_set_rotation", 0.0174533, "Orientation cell size of the closed set in rad"),
+        pose_batch_size(this, "pose_batch_size", 4, "Number of trajectory poses the model based planner evaluates together before scoring them (1 = one pose at a time)"),
         // Model based scores
         grav_angle_threshold(this, "grav_angle_threshold", 0.2, "Min value for angle between robot and gravity "),
         delta_angle_threshold(this, "delta_angle_threshold", 0.1, "Min value for angle between old and new robot pose "),
@@ -19,6 +19,7 @@
 /// SYSTEM
 #include <ros/node_handle.h>
 #include <ros/publisher.h>
+#include <ros/time.h>
 #include <memory>
 #include <boost/variant.hpp>
 #include <sensor_msgs/Image.h>
@@ -147,6 +148,9 @@ private:
     //! Publish to the global path_points
     void publishPathMarker();
 
+    //! Publish the run time statistics of the supervisors, at most once per second and only if someone listens
+    void publishSupervisorTimings();
+
     //! Converts a goal to a configuration name
     PathFollowerConfigName goalToConfig(const path_msgs::FollowPathGoal &goal) const;
 
@@ -168,6 +172,10 @@ private:
     ros::Publisher whole_local_path_pub_;
     //! Publisher for the path points of the global path
     ros::Publisher marker_pub_;
+    //! Publisher for the run time statistics of the supervisors
+    ros::Publisher supervisor_timings_pub_;
+    //! Time of the last message of supervisor_timings_pub_
+    ros::WallTime last_supervisor_timings_;
 
     //! The pse tracker keeps track of tf information
     std::shared_ptr<PoseTracker> pose_tracker_;
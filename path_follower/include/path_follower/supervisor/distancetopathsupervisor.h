@@ -20,6 +20,13 @@ public:
         return "DistanceToPath";
     }
 
+    virtual Schedule getSchedule() const {
+        // one point-line distance plus visualization
+        Schedule s;
+        s.cost = 1;
+        return s;
+    }
+
     virtual void supervise(State &state, Result *out);
 
 private:
@@ -3,6 +3,8 @@
 
 /// STL
 #include <vector>
+#include <utility>
+#include <cstdint>
 
 /// THIRD PARTY
 #include <opencv2/imgproc/imgproc.hpp>
@@ -43,11 +45,14 @@ struct Obstacle
  *   - Add observed obstacles w/o matching partner in the list of currently tracked obstacles as new.
  *
  * Matching:
- *   1) Construct a matrix with all distances between tracked and observed obstacles (observed = rows, tracked = columns)
- *   2) Search the matrix for the pair with the minimal distance. Match this pair.
- *   3) Remove the row and the column, related to the matched obstacles, from the distance matrix.
- *   4) Iterate until distance matrix is empty (= all are matched), or the minimal distance in the remaining matrix is
- *      greater than a defined threshold (-> do not match, if they are to far away from each other).
+ *   1) Put the tracked obstacles into a spatial hash with a cell size of the matching threshold. Only pairs of an
+ *      observed and a tracked obstacle in neighbouring cells with a distance below the threshold are candidates
+ *      (gating), all other pairs can never be matched.
+ *   2) Split the candidate pairs into independent groups (connected components of the bipartite candidate graph).
+ *   3) Solve the assignment problem for each group optimally (Hungarian method), maximizing the number of matched
+ *      pairs first and minimizing the sum of the distances second.
+ *
+ * Since the groups are typically tiny, the cost is roughly linear in the number of obstacles.
  *
  * Currently only the center point of an obstacle is used.
  */
@@ -57,16 +62,25 @@ public:
     class TrackedObstacle {
     public:
         TrackedObstacle(Obstacle obs):
+            TrackedObstacle(obs, ros::Time::now())
+        {}
+
+        TrackedObstacle(Obstacle obs, const ros::Time &now):
             obstacle_(obs),
-            time_of_first_sight_(ros::Time::now()),
-            time_of_last_sight_(ros::Time::now()),
+            time_of_first_sight_(now),
+            time_of_last_sight_(now),
             id_(nextId())
         {}
 
         void update(Obstacle obs)
+        {
+            update(obs, ros::Time::now());
+        }
+
+        void update(Obstacle obs, const ros::Time &now)
         {
             obstacle_ = obs;
-            time_of_last_sight_ = ros::Time::now();
+            time_of_last_sight_ = now;
         }
 
         Obstacle obstacle() const
@@ -141,26 +155,40 @@ private:
         {}
     } opt_;
 
+    //! Possible match of an observed and a tracked obstacle (passed the gating).
+    struct Candidate
+    {
+        int observed;
+        int tracked;
+        float dist;
+        //! Connected component of the candidate graph.
+        int group;
+    };
+
     //! List of tracked obstacles
     std::vector<TrackedObstacle> obstacles_;
 
-    //! Check if an obstacle is dead (= no observation for more than the allowed ''lost lifetime'') and thus can be
-    //! removed from the list.
-    bool isDead(TrackedObstacle o);
-
-    /**
-     * @brief Remove a row from a matrix.
-     * @param m    The matrix.
-     * @param row  Row-Index.
-     */
-    static inline void removeRow(cv::Mat &m, int row);
-
-    /**
-     * @brief Remove a column from a matrix.
-     * @param m    The matrix.
-     * @param col  Column-Index.
-     */
-    static inline void removeColumn(cv::Mat &m, int col);
+    /* Work buffers of update(). They are kept as members to avoid reallocation in every update. */
+    //! Spatial hash of the tracked obstacles as sorted list of (cell key, index in obstacles_).
+    std::vector<std::pair<uint64_t, int>> track_cells_;
+    //! Candidate pairs of the current update.
+    std::vector<Candidate> candidates_;
+    //! Union-find forest over observed (first) and tracked (second) obstacles.
+    std::vector<int> component_;
+    //! Index of each observed/tracked obstacle inside of the group that is currently solved (-1 if not part of it).
+    std::vector<int> local_index_;
+    //! Index of the tracked obstacle matched to each observed obstacle (-1 if unmatched).
+    std::vector<int> match_;
+
+    //! Check if an obstacle is dead (= no observation for more than the allowed ''lost lifetime'' at time <now>) and
+    //! thus can be removed from the list.
+    bool isDead(const TrackedObstacle &o, const ros::Time &now) const;
+
+    //! Find the candidate pairs of observed and tracked obstacles (see class description).
+    void findCandidates(const std::vector<Obstacle> &observed_obstacles);
+
+    //! Optimally match the candidates of one group (candidates_[begin, end)).
+    void matchGroup(size_t begin, size_t end);
 };
 
 #endif // OBSTACLETRACKER_H
@@ -3,6 +3,9 @@
 
 /// STL
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 
 /// THIRD PARTY
 #include <opencv2/imgproc/imgproc.hpp>
@@ -35,6 +38,11 @@ class PoseTracker;
  * There are two parameters to adjust the weight:
  *    ~obstacle_scale_distance: Distance at which the robot stops, independed of the duration-weight.
  *    ~obstacle_scale_lifetime: Duration after which the robot stops, independend of the distance-weight.
+ *
+ * To keep the cost per cycle independent of the path length, the corridor around the path (up to the lookout
+ * distance) is rasterised into a mask whenever the path or the current waypoint changes. Each obstacle point is
+ * then tested with a single lookup in this mask (this replaces the former parameter `segment_step_size`).
+ * The points on the corridor are clustered with GridClustering, using the cell size `scan_cluster_max_distance`.
  */
 class PathLookout : public Supervisor
 {
@@ -45,6 +53,8 @@ public:
         return "PathLookout";
     }
 
+    virtual Schedule getSchedule() const;
+
     void setObstacleCloud(const std::shared_ptr<ObstacleCloud const> &cloud);
 
     //! Check if there is an obstacle on the path ahead of the robot, that gives a reason to cancel the current path.
@@ -111,6 +121,41 @@ public:
     static std::list<std::list<cv::Point2f> > clusterPoints(const std::list<cv::Point2f> &points,
                                                             const float dist_threshold);
 
+    /**
+     * @brief Clustering of 2d points by labelling the connected components of a sparse grid.
+     *
+     * The points are put into the cells of a grid and 8-connected occupied cells form one cluster.
+     * Points closer than the cell size are always in the same cluster, but points in neighbouring cells
+     * are combined as well, even if they are up to 2*sqrt(2) times the cell size apart.
+     * Each cluster is described by its centroid and the radius of the circle around it, that encloses
+     * all points of the cluster.
+     *
+     * The buffers are kept between calls to avoid reallocation.
+     */
+    class GridClustering
+    {
+    public:
+        /**
+         * @param points The unclustered points.
+         * @param cell_size Cell size of the grid.
+         * @param min_number_of_points Clusters with fewer points are ignored.
+         * @return One obstacle per cluster.
+         */
+        std::vector<Obstacle> cluster(const std::vector<cv::Point2f> &points, float cell_size,
+                                      int min_number_of_points);
+
+    private:
+        //! Occupied cells, mapping cell key to the index in parent_.
+        std::unordered_map<uint64_t, int> cells_;
+        //! Union-find forest over the occupied cells.
+        std::vector<int> parent_;
+        //! Cell of each point (replaced by the cluster label while clustering).
+        std::vector<int> point_cell_;
+
+        //! Find the root of a cell in the union-find forest (with path halving).
+        int findRoot(int cell);
+    };
+
 
 private:
     struct Options : public Parameters
@@ -118,10 +163,13 @@ private:
         P<float> scale_obstacle_distance;
         P<float> scale_obstacle_lifetime;
         P<float> path_width;
-        P<int> segment_step_size;
+        P<float> grid_resolution;
         P<float> scan_cluster_max_distance;
         P<int> min_number_of_points;
         P<float> lookout_distance;
+        P<int> tick_interval;
+        P<bool> new_data_only;
+        P<float> time_budget;
 
         Options():
             Parameters("supervisor"),
@@ -130,14 +178,25 @@ private:
             scale_obstacle_lifetime(this, "path_lookout/obstacle_scale_lifetime",  10.0f, ""),
             path_width(this, "path_lookout/path_width",  0.5f,
                        "Width of the path in meters (should be at least the width of the robot)."),
-            segment_step_size(this, "path_lookout/segment_step_size",  5,
-                              "Number of path segments that are approximated by a line to speed up computation."),
+            grid_resolution(this, "path_lookout/grid_resolution",  0.05f,
+                            "Cell size (in meters) of the mask that is used to check if a point is on the path."
+                            " Replaces `segment_step_size`."),
             scan_cluster_max_distance(this, "path_lookout/scan_cluster_max_distance",  0.5f,
-                                      "Maximum distance between two obstacle points, to combine them to one obstacle."),
+                                      "Maximum distance between two obstacle points, to combine them to one obstacle."
+                                      " This is the cell size of the clustering grid, points in neighbouring cells are"
+                                      " combined as well (up to 2*sqrt(2) times this distance)."),
             min_number_of_points(this, "path_lookout/min_number_of_points",  3,
                                  "Minimum number of points on one obstacle (smaller clusters are ignored)."),
             lookout_distance(this,"path_lookout/lookout_distance", 99.0,
-            "Maximum distance to lookout on path")
+            "Maximum distance to lookout on path"),
+            tick_interval(this, "path_lookout/tick_interval", 1,
+                          "Only look out for obstacles on every n-th cycle of the follower."),
+            new_data_only(this, "path_lookout/new_data_only", false,
+                          "Set to `true` to skip the lookout, if no new obstacle cloud has been received since the"
+                          " last run."),
+            time_budget(this, "path_lookout/time_budget", 0.01f,
+                        "Expected maximum duration (in seconds) of one lookout. A warning is printed, if it is"
+                        " exceeded. Set to 0 to disable.")
         {}
     } opt_;
 
@@ -153,16 +212,33 @@ private:
 
     SubPath path_;
 
+    //! Path version and waypoint index, for which the corridor mask has been computed.
+    uint64_t corridor_path_version_;
+    size_t corridor_waypoint_index_;
+
+    //! Mask of the corridor around the path (non-zero = on the path).
+    cv::Mat corridor_;
+    //! Position of the cell (0,0) of corridor_ in obstacle_frame_.
+    cv::Point2f corridor_origin_;
+
+    //! Obstacle points found in the last cycle (reused to avoid reallocation).
+    std::vector<cv::Point2f> obstacle_points_;
+    GridClustering grid_clustering_;
+
 
     //! Set the path, which is to be checked for obstacles.
     void setPath(Path::ConstPtr path);
 
+    //! Rasterise the corridor around path_ (up to the lookout distance) into corridor_.
+    void updateCorridor();
+
     std::vector<Obstacle> lookForObstacles();
 
     //! Compute weight for the given obstacle, depending on its distance to the robot and its lifetime.
     float weightObstacle(cv::Point2f robot_pos, ObstacleTracker::TrackedObstacle o) const;
 
-    std::list<cv::Point2f> findObstaclesInCloud(const std::shared_ptr<ObstacleCloud const> &cloud);
+    //! Collect all points of the cloud that are within the path corridor in obstacle_points_.
+    void findObstaclesInCloud(const std::shared_ptr<ObstacleCloud const> &cloud);
 
     /**
      * @brief Cluster the given points along one axis.
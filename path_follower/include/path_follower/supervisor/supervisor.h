@@ -54,10 +54,39 @@ public:
         int8_t status;
     };
 
+    /**
+     * @brief Scheduling hints for the SupervisorChain.
+     *
+     * The default values describe a cheap supervisor that is evaluated on every tick.
+     */
+    struct Schedule
+    {
+        Schedule():
+            cost(0),
+            tick_interval(1),
+            new_data_only(false),
+            time_budget(0.0)
+        {}
+
+        //! Relative cost of supervise(). Cheaper supervisors are evaluated first.
+        int cost;
+        //! supervise() is only called on every n-th tick of the chain.
+        int tick_interval;
+        //! If true, supervise() is only called if there is a new obstacle cloud, goal or waypoint since its last call.
+        bool new_data_only;
+        //! Expected maximum duration (in seconds) of one call of supervise(). Exceeding it causes a warning. 0 disables.
+        double time_budget;
+    };
+
     virtual void supervise(State &state, Result *out) = 0;
 
     virtual std::string getName() const = 0;
 
+    //! Scheduling hints, evaluated once when the supervisor is added to a SupervisorChain.
+    virtual Schedule getSchedule() const {
+        return Schedule();
+    }
+
     virtual void eventNewGoal() {}
     virtual void eventNewWaypoint() {}
 };
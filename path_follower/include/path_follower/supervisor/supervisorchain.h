@@ -1,12 +1,48 @@
 #ifndef SUPERVISORCHAIN_H
 #define SUPERVISORCHAIN_H
 
-#include <list>
+#include <vector>
+#include <string>
 #include <path_follower/supervisor/supervisor.h>
 
+/**
+ * @brief Runs a list of supervisors on every cycle of the follower.
+ *
+ * The supervisors are ordered by their declared cost (see Supervisor::Schedule), cheap ones first, and the evaluation
+ * stops at the first supervisor that demands a stop. Supervisors can be run on every n-th tick only or only if new
+ * data is available. The duration of each call is measured, the statistics are available with getTimings() and are
+ * logged periodically on debug level.
+ */
 class SupervisorChain
 {
 public:
+    //! Run time statistics of one supervisor.
+    struct Timing
+    {
+        Timing():
+            runs(0),
+            skips(0),
+            total(0.0),
+            max(0.0)
+        {}
+
+        std::string name;
+        //! Number of calls of supervise().
+        unsigned long runs;
+        //! Number of ticks on which the supervisor has been skipped due to its schedule.
+        unsigned long skips;
+        //! Sum of all durations in seconds.
+        double total;
+        //! Maximum duration in seconds.
+        double max;
+
+        double mean() const {
+            return runs > 0 ? total / runs : 0.0;
+        }
+    };
+
+    SupervisorChain();
+
     void addSupervisor(Supervisor::Ptr supervisor);
 
     Supervisor::Result supervise(Supervisor::State &state);
@@ -14,8 +50,31 @@ public:
     void notifyNewGoal();
     void notifyNewWaypoint();
 
+    //! Run time statistics of all supervisors, in order of evaluation.
+    std::vector<Timing> getTimings() const;
+
 private:
-    std::list<Supervisor::Ptr> supervisors_;
+    struct Entry
+    {
+        Supervisor::Ptr supervisor;
+        Supervisor::Schedule schedule;
+        //! Ticks since the last call of supervise().
+        int ticks_since_run;
+        //! True, if there was a new goal or waypoint since the last call.
+        bool new_data;
+        //! Obstacle cloud of the last call (kept to detect new clouds).
+        std::shared_ptr<ObstacleCloud const> last_cloud;
+        Timing timing;
+    };
+
+    //! Supervisors, sorted by cost.
+    std::vector<Entry> supervisors_;
+
+    //! Check if the supervisor of <entry> has to be run on this tick.
+    bool isDue(Entry &entry, const Supervisor::State &state) const;
+
+    //! Summary of the run time statistics of all supervisors, in order of evaluation.
+    std::string formatTimings() const;
 };
 
 #endif // SUPERVISORCHAIN_H
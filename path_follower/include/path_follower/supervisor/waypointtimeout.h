@@ -39,6 +39,13 @@ public:
         return "WaypointTimeout";
     }
 
+    virtual Schedule getSchedule() const {
+        // only compares two time stamps
+        Schedule s;
+        s.cost = 0;
+        return s;
+    }
+
     virtual void supervise(Supervisor::State &state, Supervisor::Result *out);
     virtual void eventNewGoal();
     virtual void eventNewWaypoint();
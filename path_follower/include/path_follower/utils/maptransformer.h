@@ -4,14 +4,14 @@
 #include <string>
 #include <opencv2/core/core.hpp>
 #include <nav_msgs/OccupancyGrid.h>
-#include <tf/transform_listener.h>
+#include <path_follower/utils/pose_tracker.h>
 
 //! Simple helper class to transform points from and to map coordinates
 class MapTransformer
 {
 public:
-    MapTransformer(const tf::TransformListener *tf_listener):
-        tf_listener_(tf_listener)
+    MapTransformer(const PoseTracker *pose_tracker):
+        pose_tracker_(pose_tracker)
     {}
 
     void setMap(const nav_msgs::OccupancyGridConstPtr &map);
@@ -21,8 +21,7 @@ public:
      * @param p     The point which is to be transformed.
      * @param from  The TF-frame in which the point is defined.
      * @return      The transformed point in (non-integer!) map coordinates.
-     * @throws tf::TransformException
-     * @throws std::runtime_error If no map was set.
+     * @throws std::runtime_error If no map was set or the transformation does not exist.
      */
     cv::Point2f transformPointToMap(const cv::Point2f &p, std::string from) const;
 
@@ -31,15 +30,14 @@ public:
      * @param p     The point in map coordinates.
      * @param to    The target TF-frame in which the point is to be transformed.
      * @return      The transformed point.
-     * @throws tf::TransformException
-     * @throws std::runtime_error If no map was set.
+     * @throws std::runtime_error If no map was set or the transformation does not exist.
      */
     cv::Point2f transformPointFromMap(const cv::Point2f &p, std::string to) const;
 
 private:
     nav_msgs::OccupancyGridConstPtr map_;
 
-    const tf::TransformListener *tf_listener_;
+    const PoseTracker *pose_tracker_;
 
     tf::Transform trans_from_map_cell_to_map_frame_;
 };
@@ -0,0 +1,85 @@
+#ifndef OBSTACLE_CLOUD_FILTER_H
+#define OBSTACLE_CLOUD_FILTER_H
+
+/// SYSTEM
+#include <unordered_set>
+#include <cstdint>
+#include <ros/console.h>
+
+/// PROJECT
+#include <path_follower/utils/obstacle_cloud.h>
+#include <path_follower/utils/parameters.h>
+
+/**
+ * @brief The ObstacleCloudFilter class reduces incoming obstacle clouds before they are handed to the follower.
+ *
+ * Most consumers of the obstacle cloud (collision avoiders, local planners, supervisors) only need a 2D footprint
+ * of the obstacles at a resolution of a few centimetres. This filter transforms a sensor cloud into the fixed frame
+ * and, in the same pass,
+ *  - drops all points with non-finite coordinates,
+ *  - drops all points outside of a height band (z in the fixed frame),
+ *  - drops all points farther away than a maximum range (measured in the xy-plane around the sensor origin),
+ *  - keeps at most one point per 2D cell of a grid with the configured resolution.
+ *
+ * Binning is done with a hash set of occupied cells that is reused between calls, so no per-frame filter objects
+ * or intermediate clouds are created.
+ */
+class ObstacleCloudFilter
+{
+public:
+    ObstacleCloudFilter();
+
+    /**
+     * @brief isEnabled
+     * @return true, iff the filter stage is activated via parameters
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief filter transforms <sensor_cloud> into <target_frame> and reduces it.
+     * @param sensor_cloud the cloud as received from the sensor
+     * @param fixed_to_sensor transformation from the sensor frame to <target_frame>
+     * @param target_frame the frame of the resulting cloud
+     * @return the reduced obstacle cloud in <target_frame>
+     */
+    ObstacleCloud::Ptr filter(const ObstacleCloud::Cloud& sensor_cloud,
+                              const tf::Transform& fixed_to_sensor,
+                              const std::string& target_frame);
+
+private:
+    struct Options : public Parameters
+    {
+        P<bool> enabled;
+        P<float> min_height;
+        P<float> max_height;
+        P<float> max_range;
+        P<float> resolution;
+
+        Options():
+            Parameters("obstacle_filter"),
+
+            enabled(this, "enabled", false,
+                    "Set to `true` to reduce the obstacle cloud before it is passed to the follower."),
+            min_height(this, "min_height", -1.0f,
+                       "Points below this height (z in the fixed frame) are dropped."),
+            max_height(this, "max_height", 2.0f,
+                       "Points above this height (z in the fixed frame) are dropped."),
+            max_range(this, "max_range", 8.0f,
+                      "Points farther away from the sensor than this distance (in the xy-plane) are dropped."
+                      " Set to a value <= 0 to disable the range crop."),
+            resolution(this, "resolution", 0.05f,
+                       "Cell size of the 2D grid, only one point per cell is kept."
+                       " Set to a value <= 0 to disable the decimation.")
+        {
+            if(max_height() < min_height()) {
+                ROS_ERROR("obstacle filter: min height larger than max height!");
+                max_height.set(min_height());
+            }
+        }
+    } opt_;
+
+    //! Cells of the 2D grid that already contain a point. Kept as member to reuse the allocated buckets.
+    std::unordered_set<uint64_t> occupied_cells_;
+};
+
+#endif // OBSTACLE_CLOUD_FILTER_H
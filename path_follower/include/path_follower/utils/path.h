@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <functional>
+#include <cstdint>
 #include <geometry_msgs/Pose.h>
 #include <tf/tf.h>
 #include <Eigen/Core>
@@ -222,7 +223,9 @@ public:
         frame_id_(frame_id),
         current_sub_path_(path_.begin()),
         has_callback_(false)
-    {}
+    {
+        touch();
+    }
 
     //! Clear path and reset current subpath/waypoint.
     void clear();
@@ -336,6 +339,14 @@ public:
     std::string getFrameId() const;
     void setFrameId(const std::string& frame_id);
 
+    /**
+     * @brief Get the version of the path, it changes whenever the path or the current sub path changes.
+     *
+     * Versions are unique over all paths, so a new path never has the version of an old one,
+     * even if it is allocated at the same address.
+     */
+    uint64_t getVersion() const;
+
 private:
     //! frame in which the path is valid
     std::string frame_id_;
@@ -357,6 +368,12 @@ private:
     NextWaypointCallback_t next_wp_callback_;
     bool has_callback_;
 
+    //! Version of the path, see getVersion().
+    uint64_t version_;
+
+    //! Assign a new version to the path.
+    void touch();
+
     /**
      * @brief Precompute the distance from each waypoint to the end of the subpath.
      *
@@ -5,11 +5,26 @@
 #include <tf/transform_listener.h>
 #include <nav_msgs/Odometry.h>
 #include <Eigen/Core>
+#include <map>
+
+/// PROJECT
+#include <path_follower/utils/parameters.h>
 
 class PathFollowerParameters;
 
 /**
  * @brief The PoseTracker class simplifies access to lookup various transformations.
+ *
+ * All components of the follower should request their transformations from the pose tracker
+ * instead of querying the tf::TransformListener directly.
+ * Transformations are cached per control cycle (a cycle starts with each call of updateRobotPose()),
+ * so each frame pair is only looked up once per cycle, no matter how many components request it.
+ * Requests of the latest transformation (ros::Time(0)) are cached until tf has newer data for the frame pair,
+ * so they are also up to date while no cycles are running.
+ *
+ * Optionally, the robot pose is not looked up via tf every cycle but composed of the slowly changing
+ * correction world -> odom (refreshed in a configurable interval) and the latest odometry pose,
+ * extrapolated to the current time using the odometry twist.
  */
 class PoseTracker
 {
@@ -73,6 +88,32 @@ public:
      * @throws std::runtime_error if the transform is not availble at all
      */
     tf::Transform getTransform(const std::string& fixed_frame, const std::string& frame, const ros::Time& time, const ros::Duration &max_wait) const;
+
+    /**
+     * @brief tryGetTransform behaves like getTransform, but reports failure via the return value instead of throwing.
+     * @param fixed_frame Name of the parent frame
+     * @param frame Name of the child frame
+     * @param time Timat for which the tranform is requested
+     * @param max_wait Duration in seconds to wait for the transform
+     * @param trafo [out] the requested transform
+     * @return true, iff <trafo> is a valid transform
+     */
+    bool tryGetTransform(const std::string& fixed_frame, const std::string& frame, const ros::Time& time, const ros::Duration &max_wait,
+                         tf::Transform& trafo) const;
+
+    /**
+     * @brief tryGetExactTransform behaves like tryGetTransform, but fails instead of falling back to the latest transform
+     *        if the transformation is not available at time <time>.
+     * @param fixed_frame Name of the parent frame
+     * @param frame Name of the child frame
+     * @param time Timat for which the tranform is requested
+     * @param max_wait Duration in seconds to wait for the transform
+     * @param trafo [out] the requested transform
+     * @return true, iff <trafo> is the transform at time <time>
+     */
+    bool tryGetExactTransform(const std::string& fixed_frame, const std::string& frame, const ros::Time& time, const ros::Duration &max_wait,
+                              tf::Transform& trafo) const;
+
     /**
      * @brief getRelativeTransform returns the transformation between the robot frame and the given frame at time <time>.
      *        If the transformation is not availible at time <time>, the latest transform will be returned.
@@ -112,6 +153,7 @@ public:
     /**
      * @brief updateRobotPose refreshed the current robot pose.
      *        This method has to be called periodically by the main thread.
+     *        It also starts a new cycle of the transform cache.
      * @return true, iff the pose is available
      */
     bool updateRobotPose();
@@ -131,7 +173,55 @@ private:
 
     bool getWorldPose(Eigen::Vector3d *pose_vec, geometry_msgs::Pose* pose_msg = nullptr) const;
 
+    //! Compose the robot pose of the world -> odom correction and the extrapolated odometry pose.
+    bool getExtrapolatedPose();
+
+    //! Convert a tf pose to the Eigen and message representations.
+    static void poseFromTF(const tf::Transform& pose, Eigen::Vector3d* pose_vec, geometry_msgs::Pose* pose_msg);
+
 private:
+    struct Options : public Parameters
+    {
+        P<bool> extrapolate_odometry;
+        P<float> max_extrapolation;
+        WrappedP<ros::Duration, float> correction_interval;
+        WrappedP<ros::Duration, float> latest_cache_lifetime;
+
+        Options():
+            Parameters("pose_tracker"),
+
+            extrapolate_odometry(this, "extrapolate_odometry", false,
+                                 "If `true`, the robot pose is composed of the world -> odom correction and the latest"
+                                 " odometry pose, extrapolated to the current time. Otherwise it is looked up via tf every cycle."),
+            max_extrapolation(this, "max_extrapolation", 0.2f,
+                              "Maximum time (in seconds) the odometry pose is extrapolated."),
+            correction_interval(this, "correction_interval", 0.1f,
+                                "Interval (in seconds) in which the world -> odom correction is refreshed,"
+                                " if extrapolate_odometry is set."),
+            latest_cache_lifetime(this, "latest_cache_lifetime", 0.05f,
+                                  "Maximum age (in seconds) of a cached latest transform (time 0). Within a cycle all lookups"
+                                  " are cached, this limits the age while the follower is idle and no cycle runs.")
+        {}
+    } pt_opt_;
+
+    //! A cached transformation, only valid within the cycle it was looked up in.
+    //! The latest transformation (time 0) additionally expires after latest_cache_lifetime.
+    struct CachedTransform
+    {
+        tf::Transform transform;
+        ros::Time time;
+        //! Time of the lookup, only used for the latest transformation.
+        ros::Time looked_up;
+        unsigned long cycle;
+        //! False, if the transformation at <time> was not available and the latest one is cached instead.
+        bool exact;
+    };
+
+    //! Returns the cached transformation of (fixed_frame, frame) at <time>, nullptr if there is none in the current cycle.
+    const CachedTransform* findCached(const std::string& fixed_frame, const std::string& frame, const ros::Time& time, bool exact) const;
+    void storeCached(const std::string& fixed_frame, const std::string& frame, const ros::Time& time, const tf::Transform& trafo,
+                     bool exact) const;
+
     const PathFollowerParameters& opt_;
     tf::TransformListener pose_listener_;
 
@@ -139,7 +229,17 @@ private:
     ros::Subscriber odom_sub_;
 
     //! The last received odometry message.
-    nav_msgs::Odometry odometry_;
+    nav_msgs::OdometryConstPtr odometry_;
+
+    //! Transformations that have been looked up in the current cycle, indexed by (fixed frame, frame).
+    mutable std::map<std::pair<std::string, std::string>, CachedTransform> transform_cache_;
+    //! Counter of the current cycle, incremented by updateRobotPose().
+    unsigned long cycle_;
+
+    //! Correction world -> odom used for the extrapolated pose.
+    tf::Transform world_to_odom_;
+    //! Time, when world_to_odom_ was refreshed the last time.
+    ros::Time world_to_odom_update_;
 
     //! Current pose of the robot as Eigen vector (x,y,theta).
     Eigen::Vector3d robot_pose_world_;
@@ -5,15 +5,15 @@
 #include <path_follower/utils/obstacle_cloud.h>
 
 CollisionAvoider::CollisionAvoider()
-    : tf_listener_(nullptr),
+    : pose_tracker_(nullptr),
       robot_frame_("base_link")
 {
 
 }
 
-void CollisionAvoider::setTransformListener(const tf::TransformListener *tf_listener)
+void CollisionAvoider::setPoseTracker(PoseTracker *pose_tracker)
 {
-    tf_listener_ = tf_listener;
+    pose_tracker_ = pose_tracker;
 }
 
 void CollisionAvoider::setRobotFrameId(const std::string& frame_id)
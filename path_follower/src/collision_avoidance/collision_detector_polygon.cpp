@@ -11,6 +11,7 @@
 #include <pcl_ros/transforms.h>
 #include <pcl_conversions/pcl_conversions.h>
 #include <path_follower/utils/visualizer.h>
+#include <path_follower/utils/pose_tracker.h>
 
 using namespace std;
 
@@ -33,25 +34,21 @@ bool CollisionDetectorPolygon::checkOnCloud(std::shared_ptr<ObstacleCloud const>
 
     if(obstacles->header.frame_id != pwf.frame) {
         /// transform the polygon to the obstacle cloud frame
-        try {
-            geometry_msgs::PointStamped gm_p, gm_pt;
-            gm_p.header.frame_id = pwf.frame;
-            gm_p.header.stamp = pcl_conversions::fromPCL(obstacles->header.stamp);
-    
-            for (cv::Point2f &p : pwf.polygon) {
-                gm_p.point.x = p.x;
-                gm_p.point.y = p.y;
-                tf_listener_->transformPoint(obstacles->header.frame_id, gm_p, gm_pt);
-                p.x = gm_pt.point.x;
-                p.y = gm_pt.point.y;
-            }
-            pwf.frame = obstacles->header.frame_id;
-
-        } catch (tf::TransformException& ex) {
-            ROS_ERROR_NAMED(MODULE, "Failed to transform polygon to obstacle cloud frame: %s", ex.what());
+        tf::Transform cloud_to_polygon;
+        if (!pose_tracker_->tryGetExactTransform(obstacles->header.frame_id, pwf.frame,
+                                                 pcl_conversions::fromPCL(obstacles->header.stamp),
+                                                 ros::Duration(0), cloud_to_polygon)) {
+            ROS_ERROR_NAMED(MODULE, "Failed to transform polygon to obstacle cloud frame");
             // can't check for obstacles, so better assume there is one.
             return true;
         }
+
+        for (cv::Point2f &p : pwf.polygon) {
+            tf::Point pt = cloud_to_polygon * tf::Point(p.x, p.y, 0);
+            p.x = pt.x();
+            p.y = pt.y();
+        }
+        pwf.frame = obstacles->header.frame_id;
     }
 
     /// now check each point of the scan
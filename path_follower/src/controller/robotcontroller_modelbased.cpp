@@ -70,8 +70,6 @@ void RobotController_ModelBased::initialize()
 {
     RobotController::initialize();
 
-    transformer_ = &pose_tracker_->getTransformListener();
-
     m_opt_.AssignParams(config);
 
     config.expanderConfig_.minLinVel = opt_.min_linear_velocity();
@@ -274,22 +272,9 @@ void RobotController_ModelBased::publishMoveCommand(const MoveCommand &cmd) cons
 }
 
 
-bool RobotController_ModelBased::GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::StampedTransform &trans)
+bool RobotController_ModelBased::GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::Transform &trans)
 {
-    try{//Try to get the latest avaiable Transform
-        transformer_->lookupTransform(targetFrame, sourceFrame, time, trans);
-    }catch(tf::TransformException ex){//if not available, then wait
-        (void) ex;
-        if(!transformer_->waitForTransform(targetFrame, sourceFrame, time, ros::Duration(0.05))){
-            ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
-            return false;
-        }
-        transformer_->lookupTransform(targetFrame, sourceFrame, time, trans);
-    }
-
-    return true;
-
-
+    return pose_tracker_->tryGetTransform(targetFrame, sourceFrame, time, ros::Duration(0.05), trans);
 }
 
 
@@ -317,20 +302,14 @@ void RobotController_ModelBased::TransformPath(tf::Transform trans)
 
 bool RobotController_ModelBased::targetTransform2base(ros::Time& now)
 {
-    tf::StampedTransform now_map_to_base;
+    tf::Transform now_map_to_base;
 
     std::string world_frame = PathFollowerParameters::getInstance()->world_frame();
     std::string robot_frame = localMapFrame_;
 
-    try{//Try to get the latest avaiable Transform
-        transformer_->lookupTransform(world_frame, robot_frame, ros::Time(0), now_map_to_base);
-    }catch(tf::TransformException ex){//if not available, then wait
-        (void) ex;
-        if(!transformer_->waitForTransform(world_frame, robot_frame, now, ros::Duration(0.1))){
-            ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
-            return false;
-        }
-        transformer_->lookupTransform(world_frame, robot_frame, now, now_map_to_base);
+    if(!pose_tracker_->tryGetTransform(world_frame, robot_frame, ros::Time(0), ros::Duration(0.1), now_map_to_base)) {
+        ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
+        return false;
     }
 
     tf::Transform transform_correction = now_map_to_base.inverse();
@@ -371,7 +350,9 @@ void RobotController_ModelBased::imageCallback (const sensor_msgs::ImageConstPtr
     std::string robot_frame = PathFollowerParameters::getInstance()->robot_frame();
     std::string map_frame = image->header.frame_id;
 
+    // shares the message data, the only copy is the one into the planner's back buffer
     cv::Mat inputImage = cv_bridge::toCvShare(image,"")->image;
+    model_based_planner_->UpdateDEM(inputImage);
 
     cv::Point3f pose(0,0,0);
 
@@ -380,7 +361,7 @@ void RobotController_ModelBased::imageCallback (const sensor_msgs::ImageConstPtr
     {
         tf::Transform transLocalMap =pose_tracker_->getTransform(map_frame ,localMapFrame_,now,ros::Duration(0.01));
         /*
-        tf::StampedTransform transLocalMap;
+        tf::Transform transLocalMap;
         if (!GetTransform(now, map_frame, localMapFrame_, transLocalMap))
         {
             ROS_ERROR_STREAM_THROTTLE(1, "RobotController_ModelBased: Cannot transform local map to map!" );
@@ -393,7 +374,7 @@ void RobotController_ModelBased::imageCallback (const sensor_msgs::ImageConstPtr
 
 
         /*
-        tf::StampedTransform trans;
+        tf::Transform trans;
         if (!GetTransform(now, map_frame, robot_frame, trans))
         {
             ROS_ERROR_STREAM_THROTTLE(1, "RobotController_ModelBased: Cannot transform local map to map!" );
@@ -457,8 +438,6 @@ void RobotController_ModelBased::imageCallback (const sensor_msgs::ImageConstPtr
         model_based_planner_->SetVelocity(nvel);
     }
 
-    model_based_planner_->UpdateDEM(inputImage);
-
     Stopwatch sw;
     sw.restart();
 
@@ -49,7 +49,7 @@ std::shared_ptr<PathFollowerConfig> FollowerFactory::construct(const PathFollowe
     ROS_ASSERT_MSG(result.collision_avoider_ != nullptr, "Obstacle Avoider was not set");
 
     // wiring
-    result.collision_avoider_->setTransformListener(&pose_tracker_.getTransformListener());
+    result.collision_avoider_->setPoseTracker(&pose_tracker_);
     result.collision_avoider_->setRobotFrameId(pose_tracker_.getRobotFrameId());
 
     result.local_planner_->init(result.controller_.get(), &pose_tracker_);
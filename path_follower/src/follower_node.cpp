@@ -3,6 +3,7 @@
 #include <path_follower/path_follower_server.h>
 #include <path_follower/utils/parameters.h>
 #include <path_follower/utils/obstacle_cloud.h>
+#include <path_follower/utils/obstacle_cloud_filter.h>
 #include <path_follower/utils/elevation_map.h>
 #include <path_follower/utils/pose_tracker.h>
 #include <path_follower/factory/follower_factory.h>
@@ -12,7 +13,7 @@
 #include <fstream>
 
 namespace {
-void importCloud(const ObstacleCloud::Cloud::ConstPtr& sensor_cloud, PathFollower* pf)
+void importCloud(const ObstacleCloud::Cloud::ConstPtr& sensor_cloud, PathFollower* pf, ObstacleCloudFilter* filter)
 {
     ros::Time now;
     now.fromNSec(sensor_cloud->header.stamp * 1e3);
@@ -27,9 +28,13 @@ void importCloud(const ObstacleCloud::Cloud::ConstPtr& sensor_cloud, PathFollowe
     try {
         tf::Transform fixed_to_sensor = pose_tracker.getTransform(pose_tracker.getFixedFrameId(), sensor_frame, now, ros::Duration(0.1));
 
-        auto obstacle_cloud = std::make_shared<ObstacleCloud>(sensor_cloud);
-        obstacle_cloud->transformCloud(fixed_to_sensor, pose_tracker.getFixedFrameId());
-        pf->setObstacles(obstacle_cloud);
+        if(filter->isEnabled()) {
+            pf->setObstacles(filter->filter(*sensor_cloud, fixed_to_sensor, pose_tracker.getFixedFrameId()));
+        } else {
+            auto obstacle_cloud = std::make_shared<ObstacleCloud>(sensor_cloud);
+            obstacle_cloud->transformCloud(fixed_to_sensor, pose_tracker.getFixedFrameId());
+            pf->setObstacles(obstacle_cloud);
+        }
     } catch(const std::exception& e) {
         ROS_ERROR_STREAM_THROTTLE(1, "error transforming the obstacle cloud from " <<
                          sensor_frame << " to " <<
@@ -105,6 +110,7 @@ int main(int argc, char** argv) {
 
     PathFollower pf(nh);
     PathFollowerServer server(pf);
+    ObstacleCloudFilter obstacle_filter;
 
     for(uint8_t i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -131,10 +137,9 @@ int main(int argc, char** argv) {
         }
     }
 
-
     ros::Subscriber obstacle_cloud_sub_ =
             nh.subscribe<ObstacleCloud::Cloud>("obstacle_cloud", 10,
-                                        boost::bind(&importCloud, _1, &pf));
+                                        boost::bind(&importCloud, _1, &pf, &obstacle_filter));
     ros::Subscriber elevation_map_sub_ =
                 nh.subscribe<ElevationMap::EMapType>("elevation_map", 1,
                                             boost::bind(&importElevationMap, _1, &pf));
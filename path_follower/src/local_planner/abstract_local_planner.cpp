@@ -12,7 +12,6 @@
 AbstractLocalPlanner::AbstractLocalPlanner()
     : controller_(nullptr),
       pose_tracker_(nullptr),
-      transformer_(nullptr),
       opt_(nullptr),
 
       last_update_(0)
@@ -29,8 +28,6 @@ void AbstractLocalPlanner::init(RobotController* controller, PoseTracker* pose_t
 
     update_interval_ = ros::Duration (opt_->update_interval());
 
-    transformer_ = &pose_tracker_->getTransformListener();
-
     setParams(*opt_);
 }
 
@@ -53,18 +50,10 @@ void AbstractLocalPlanner::setGlobalPath(Path::Ptr path)
     std::string world_frame = PathFollowerParameters::getInstance()->world_frame();
     std::string odom_frame = PathFollowerParameters::getInstance()->odom_frame();
 
-    tf::StampedTransform initial_map_to_odom_;    
-    if(transformer_->waitForTransform(world_frame, odom_frame, now, ros::Duration(1.0))) {
-        transformer_->lookupTransform(world_frame, odom_frame, now, initial_map_to_odom_);
-        return;
-    }
-    if(transformer_->waitForTransform(world_frame, odom_frame, ros::Time(0), ros::Duration(1.0))) {
-        ROS_WARN_NAMED("global_path", "cannot transform map to odom, using latest");
-        transformer_->lookupTransform(world_frame, odom_frame, ros::Time(0), initial_map_to_odom_);
-        return;
+    tf::Transform initial_map_to_odom_;
+    if(!pose_tracker_->tryGetTransform(world_frame, odom_frame, now, ros::Duration(1.0), initial_map_to_odom_)) {
+        ROS_ERROR_NAMED("global_path", "cannot transform %s to %s", world_frame.c_str(), odom_frame.c_str());
     }
-
-    ROS_ERROR_NAMED("global_path", "cannot transform %s to %s", world_frame.c_str(), odom_frame.c_str());
 }
 
 bool AbstractLocalPlanner::isNull() const
@@ -29,14 +29,12 @@ Path::Ptr LocalPlannerTransformer::updateLocalPath()
     if(last_update_ + update_interval_ < now) {
         // only look at the first sub path for now
         // calculate the corrective transformation to map from world coordinates to odom
-        if(!transformer_->waitForTransform(world_frame, odom_frame, ros::Time(0), ros::Duration(0.1))) {
+        tf::Transform now_map_to_odom;
+        if(!pose_tracker_->tryGetTransform(world_frame, odom_frame, ros::Time(0), ros::Duration(0.1), now_map_to_odom)) {
             ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
             return {};
         }
 
-        tf::StampedTransform now_map_to_odom;
-        transformer_->lookupTransform(world_frame, odom_frame, ros::Time(0), now_map_to_odom);
-
         tf::Transform transform_correction = now_map_to_odom.inverse();
 
         // transform the waypoints from world to odom
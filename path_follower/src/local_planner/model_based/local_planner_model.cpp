@@ -37,22 +37,21 @@ LocalPlannerModel::LocalPlannerModel()
 }
 
 
-bool LocalPlannerModel::GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::StampedTransform &trans)
+bool LocalPlannerModel::GetTransform(ros::Time time,std::string targetFrame, std::string sourceFrame, tf::Transform &trans)
 {
-    try{//Try to get the latest avaiable Transform
-        transformer_->lookupTransform(targetFrame, sourceFrame, time, trans);
-    }catch(tf::TransformException ex){//if not available, then wait
-        (void) ex;
-        if(!transformer_->waitForTransform(targetFrame, sourceFrame, time, ros::Duration(0.05))){
-            ROS_WARN_STREAM_THROTTLE_NAMED(1, "LocalPlannerModel", "cannot lookup transform from :" << targetFrame << " to " << sourceFrame);
-            return false;
-        }
-        transformer_->lookupTransform(targetFrame, sourceFrame, time, trans);
-    }
+    return pose_tracker_->tryGetTransform(targetFrame, sourceFrame, time, ros::Duration(0.05), trans);
+}
 
-    return true;
+void LocalPlannerModel::setElevationMap(const std::shared_ptr<ElevationMap const> &msg)
+{
+    AbstractLocalPlanner::setElevationMap(msg);
+
+    // new elevation maps are written into the planner's back buffer when they arrive, planning picks up the latest one
+    if (!initialized_ || msg == nullptr || msg->empty() || msg->elevationMap == uploaded_dem_) return;
 
+    model_based_planner_->UpdateDEM(msg->toCVMat());
 
+    uploaded_dem_ = msg->elevationMap;
 }
 
 void LocalPlannerModel::PublishDebugImage()
@@ -105,11 +104,6 @@ Path::Ptr LocalPlannerModel::updateLocalPath_BaseLink()
     model_based_planner_->SetGoalMap(goal);
 
 
-    const cv::Mat cvImage = elevation_map_->toCVMat();
-
-
-    model_based_planner_->UpdateDEM(cvImage);
-
     //Eigen::Vector3d pose = pose_tracker_->getRobotPose();
 
     //std::size_t nnodes = 0;
@@ -201,7 +195,7 @@ Path::Ptr LocalPlannerModel::updateLocalPath_LocalMap()
     tf::Transform transLocalMap = pose_tracker_->getTransform(map_frame, local_frame,mapTime,ros::Duration(0.01));
 
     /*
-    tf::StampedTransform transLocalMap;
+    tf::Transform transLocalMap;
     if (!GetTransform(mapTime, map_frame, local_frame, transLocalMap))
     {
         ROS_ERROR_STREAM_THROTTLE(1, "LocalPlannerModel: Cannot transform local map to map!" );
@@ -227,7 +221,7 @@ Path::Ptr LocalPlannerModel::updateLocalPath_LocalMap()
     tf::Transform trans = pose_tracker_->getTransform(map_frame, robot_frame,mapTime,ros::Duration(0.01));
 
     /*
-    tf::StampedTransform trans;
+    tf::Transform trans;
     if (!GetTransform(now, map_frame, robot_frame, trans))
     {
         ROS_ERROR_STREAM_THROTTLE(1, "LocalPlannerModel: Cannot transform local map to map!" );
@@ -256,11 +250,6 @@ Path::Ptr LocalPlannerModel::updateLocalPath_LocalMap()
 
     model_based_planner_->SetRobotPose(pose);
 
-    const cv::Mat cvImage = elevation_map_->toCVMat();
-
-
-    model_based_planner_->UpdateDEM(cvImage);
-
     //Eigen::Vector3d pose = pose_tracker_->getRobotPose();
 
     //std::size_t nnodes = 0;
@@ -469,20 +458,14 @@ void LocalPlannerModel::setGlobalPath(Path::Ptr path)
 
 bool LocalPlannerModel::transform2base(ros::Time& now)
 {
-    tf::StampedTransform now_map_to_base;
+    tf::Transform now_map_to_base;
 
     std::string world_frame = PathFollowerParameters::getInstance()->world_frame();
     std::string robot_frame = PathFollowerParameters::getInstance()->robot_frame();
 
-    try{//Try to get the latest avaiable Transform
-        transformer_->lookupTransform(world_frame, robot_frame, ros::Time(0), now_map_to_base);
-    }catch(tf::TransformException ex){//if not available, then wait
-        (void) ex;
-        if(!transformer_->waitForTransform(world_frame, robot_frame, now, ros::Duration(0.1))){
-            ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
-            return false;
-        }
-        transformer_->lookupTransform(world_frame, robot_frame, now, now_map_to_base);
+    if(!pose_tracker_->tryGetTransform(world_frame, robot_frame, ros::Time(0), ros::Duration(0.1), now_map_to_base)) {
+        ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
+        return false;
     }
 
     tf::Transform transform_correction = now_map_to_base.inverse();
@@ -518,18 +501,12 @@ bool LocalPlannerModel::transform2base(ros::Time& now)
 
 bool LocalPlannerModel::transformWPS(std::string source, std::string target, SubPath &waypoints, ros::Time& now)
 {
-    tf::StampedTransform now_transform;
+    tf::Transform now_transform;
 
 
-    try{//Try to get the latest avaiable Transform
-        transformer_->lookupTransform(target, source, ros::Time(0), now_transform);
-    }catch(tf::TransformException ex){//if not available, then wait
-        (void) ex;
-        if(!transformer_->waitForTransform(target, source, now, ros::Duration(0.1))){
-            ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
-            return false;
-        }
-        transformer_->lookupTransform(target, source, now, now_transform);
+    if(!pose_tracker_->tryGetTransform(target, source, ros::Time(0), ros::Duration(0.1), now_transform)) {
+        ROS_WARN_THROTTLE_NAMED(1, "local_path", "cannot transform map to odom");
+        return false;
     }
 
     tf::Transform transform_correction = now_transform;
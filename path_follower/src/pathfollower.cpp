@@ -11,6 +11,7 @@
 /// ROS
 #include <geometry_msgs/Twist.h>
 #include <std_msgs/Int32MultiArray.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <tf_conversions/tf_eigen.h>
 #include <path_msgs/PathSequence.h>
 
@@ -58,6 +59,7 @@ PathFollower::PathFollower(ros::NodeHandle &nh):
     local_path_pub_ = node_handle_.advertise<path_msgs::PathSequence>("local_path", 1, true);
     whole_local_path_pub_ = node_handle_.advertise<nav_msgs::Path>("whole_local_path", 1, true);
     marker_pub_ = node_handle_.advertise<visualization_msgs::Marker>("visualization_marker", 10);
+    supervisor_timings_pub_ = node_handle_.advertise<diagnostic_msgs::DiagnosticArray>("supervisor_timings", 1);
 
     /*** Initialize supervisors ***/
 
@@ -128,6 +130,10 @@ void PathFollower::setObstacles(const std::shared_ptr<ObstacleCloud const> &msg)
 void PathFollower::setElevationMap(const std::shared_ptr<ElevationMap const> &msg)
 {
     elevation_map_ = msg;
+
+    if(current_config_) {
+        current_config_->local_planner_->setElevationMap(msg);
+    }
     /*
     if(current_config_) {
         current_config_->collision_avoider_->setElevationMap(msg);
@@ -168,6 +174,7 @@ boost::variant<FollowPathFeedback, FollowPathResult> PathFollower::update()
                             feedback);
 
     Supervisor::Result s_res = supervisors_->supervise(state);
+    publishSupervisorTimings();
     if(!s_res.can_continue) {
         ROS_WARN("My supervisor told me to stop.");
         stop(s_res.status);
@@ -513,6 +520,41 @@ void PathFollower::findSegments(const path_msgs::PathSequence& path)
     path_->setPath(subpaths);
 }
 
+void PathFollower::publishSupervisorTimings()
+{
+    if (supervisor_timings_pub_.getNumSubscribers() == 0) {
+        return;
+    }
+
+    const ros::WallTime now = ros::WallTime::now();
+    if (now - last_supervisor_timings_ < ros::WallDuration(1.0)) {
+        return;
+    }
+    last_supervisor_timings_ = now;
+
+    auto value = [](const std::string &key, const std::string &val) {
+        diagnostic_msgs::KeyValue kv;
+        kv.key = key;
+        kv.value = val;
+        return kv;
+    };
+
+    diagnostic_msgs::DiagnosticArray msg;
+    msg.header.stamp = ros::Time::now();
+    for (const SupervisorChain::Timing &t : supervisors_->getTimings()) {
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = "supervisor/" + t.name;
+        status.message = "run time statistics";
+        status.values.push_back(value("runs", std::to_string(t.runs)));
+        status.values.push_back(value("skips", std::to_string(t.skips)));
+        status.values.push_back(value("mean_ms", std::to_string(t.mean() * 1e3)));
+        status.values.push_back(value("max_ms", std::to_string(t.max * 1e3)));
+        msg.status.push_back(status);
+    }
+    supervisor_timings_pub_.publish(msg);
+}
+
 void PathFollower::publishPathMarker(){
     Eigen::Vector3d current_pose = pose_tracker_->getRobotPose();
     geometry_msgs::Point pt;
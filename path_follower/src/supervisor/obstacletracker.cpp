@@ -1,117 +1,170 @@
 #include <path_follower/supervisor/obstacletracker.h>
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 using namespace std;
 
 namespace {
 //! Module name, that is used for ros console output
 const std::string MODULE = "s_obstacle_tracker";
+
+//! Combine the two cell indices into one hash key.
+inline uint64_t cellKey(int32_t ix, int32_t iy)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) | static_cast<uint32_t>(iy);
 }
 
-void ObstacleTracker::update(std::vector<Obstacle> observed_obstacles)
+//! Root of node i in the union-find forest (with path halving).
+int findRoot(std::vector<int> &parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/**
+ * @brief Solve the rectangular assignment problem with the Hungarian method (O(n^2 m)).
+ * @param cost  Row-major n x m cost matrix. Requires n <= m.
+ * @param row_to_col Output: index of the column assigned to each row.
+ */
+void solveAssignment(const std::vector<double> &cost, int n, int m, std::vector<int> &row_to_col)
 {
-    /**
-     * There is a slight difference in the actual implementation of the algorithmn, compared to the description in the
-     * class comment:
-     * Since removing rows/columns from the distance matrix changes the indices of the remaining entries, it would be
-     * quite complicated to keep the connetion between the obstacles and the entries in the matrix. Therefore, instead
-     * of cutting the distance matrix ('dist'), an additional matrix 'd_idx' is constructed, containing indices to the
-     * fields in the distance matrix. This index-matrix is then used to cut away matched obstacles, instead of the
-     * distance matrix itself.
-     */
+    const double INF = std::numeric_limits<double>::infinity();
+
+    // potentials and the column->row assignment use 1-based indices, index 0 is a virtual column.
+    std::vector<double> u(n+1, 0.0), v(m+1, 0.0), minv(m+1);
+    std::vector<int> p(m+1, 0), way(m+1, 0);
+    std::vector<char> used(m+1);
 
+    for (int i = 1; i <= n; ++i) {
+        p[0] = i;
+        int j0 = 0;
+        std::fill(minv.begin(), minv.end(), INF);
+        std::fill(used.begin(), used.end(), false);
+
+        // augment along the shortest alternating path from the free row i
+        do {
+            used[j0] = true;
+            int i0 = p[j0];
+            int j1 = 0;
+            double delta = INF;
+            for (int j = 1; j <= m; ++j) {
+                if (!used[j]) {
+                    double cur = cost[(i0-1)*m + (j-1)] - u[i0] - v[j];
+                    if (cur < minv[j]) {
+                        minv[j] = cur;
+                        way[j] = j0;
+                    }
+                    if (minv[j] < delta) {
+                        delta = minv[j];
+                        j1 = j;
+                    }
+                }
+            }
+            for (int j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    row_to_col.assign(n, -1);
+    for (int j = 1; j <= m; ++j) {
+        if (p[j] != 0) {
+            row_to_col[p[j]-1] = j-1;
+        }
+    }
+}
+}
+
+void ObstacleTracker::update(std::vector<Obstacle> observed_obstacles)
+{
     // TODO: exploit enclosing circle of obstacles for matching (match if center is within the circle or something like that)
 
+    // All obstacles of one observation share the same time stamp.
+    const ros::Time now = ros::Time::now();
 
     // Delete "dead" obstacles, which could not be matched for more than the time, specified in lost_lifetime_.
-    // Use ugly c++ version of functional "filter"...
     // FIXME: I think it's not the best solution to drop old entries before matching, as this will completely crush
-    // any tracking, if lost_lifetime is set to 0 ("do not track obstacles that are out of sight"). Doing it after
-    // matching will cause the same problem though, as there is a small amount of time passing between the two steps.
-    // It has somehow to be guaranteed, that no obstacles are dropped, that could be matched in this iteration.
+    // any tracking, if lost_lifetime is set to 0 ("do not track obstacles that are out of sight").
     size_t dead_count = obstacles_.size();
     obstacles_.erase(std::remove_if(obstacles_.begin(), obstacles_.end(),
-                                    [this](TrackedObstacle o) { return isDead(o); }),
+                                    [this, &now](const TrackedObstacle &o) { return isDead(o, now); }),
                      obstacles_.end());
     dead_count = dead_count - obstacles_.size();
 
+    const size_t n_observed = observed_obstacles.size();
+    const size_t n_nodes = n_observed + obstacles_.size();
 
-    // construct distanc matrix. D[i,j] = distance between observed obstacle i and tracked obstacle j.
-    cv::Mat dist(observed_obstacles.size(), obstacles_.size(), CV_32F);
-    cv::Mat d_idx(dist.rows, dist.cols, CV_16U);
-    vector<bool> obs_matched(observed_obstacles.size(), false);
-
-    ushort i = 0; // ATTENTION: i is the data-index to dist. Therefore the outer loop must iterate over rows, the inner over columns!
-    for (size_t o = 0; o < observed_obstacles.size(); ++o)
-    for (size_t t = 0; t < obstacles_.size();         ++t) {
-        dist.at<float>(o, t)   = norm(observed_obstacles[o].center - obstacles_[t].obstacle().center);
-        d_idx.at<ushort>(o, t) = i++;
+    findCandidates(observed_obstacles);
 
+    // group candidates by connected component. Observed obstacles are the nodes [0, n_observed), tracked obstacles
+    // the nodes [n_observed, n_nodes).
+    component_.resize(n_nodes);
+    for (size_t i = 0; i < n_nodes; ++i) {
+        component_[i] = i;
     }
-
-    //ROS_DEBUG_STREAM_NAMED(MODULE, "D =\n" << dist);
-
-    // now match the points
-    int match_counter = 0;
-    while (!d_idx.empty()) {
-        //ROS_DEBUG_STREAM_NAMED(MODULE, "Didx =\n" << d_idx);
-
-        // min_idx = argmin(D)
-        float min = dist.at<float>(d_idx.at<ushort>(0));
-        int min_idx = 0;
-        for (int i = 1; i < d_idx.rows*d_idx.cols; ++i) {
-            int idx = d_idx.at<ushort>(i);
-            if (dist.at<float>(idx) < min) {
-                min = dist.at<float>(idx);
-                min_idx = i;
-            }
+    for (const Candidate &c : candidates_) {
+        int a = findRoot(component_, c.observed);
+        int b = findRoot(component_, n_observed + c.tracked);
+        if (a != b) {
+            component_[b] = a;
         }
-
-        //ROS_DEBUG_NAMED(MODULE, "min idx = %d (%d), dist = %g", d_idx.at<ushort>(min_idx), min_idx, dist.at<float>(d_idx.at<ushort>(min_idx)));
-
-        // If the shortest distance is to big, assume that all matchable obstacles are matched.
-        if (min > opt_.max_dist()) {
-            break;
+    }
+    for (Candidate &c : candidates_) {
+        c.group = findRoot(component_, c.observed);
+    }
+    std::sort(candidates_.begin(), candidates_.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.group != b.group) {
+            return a.group < b.group;
         }
+        return a.observed < b.observed || (a.observed == b.observed && a.tracked < b.tracked);
+    });
 
-        // data-index to distance-matrix coords (mi, mj are the indices of the matched obstacles)
-        int mi = d_idx.at<ushort>(min_idx) / dist.cols;
-        int mj = d_idx.at<ushort>(min_idx) % dist.cols;
-        // ... and to index-matrix coords (those are only needed, to remove the corresponding row and column, a few lines below)
-        int mi_idx = min_idx / d_idx.cols;
-        int mj_idx = min_idx % d_idx.cols;
-
-        //ROS_DEBUG_NAMED(MODULE, "matched %d, %d (%d,%d)", mi, mj, mi_idx, mj_idx);
-
-        // match observed obstacle mi with tracked obstacle mj
-        obstacles_[mj].update(observed_obstacles[mi]);
-        ++match_counter;
-        // mark mi as matched.
-        obs_matched[mi] = true;
-
-        // delete mi and mj from the distances index matrix
-        removeRow(d_idx, mi_idx);
-        if (d_idx.empty())
-            break; // stop before calling removeColumn on an empty matrix will cause a crash.
-        removeColumn(d_idx, mj_idx);
+    // now match the obstacles group by group
+    match_.assign(n_observed, -1);
+    local_index_.assign(n_nodes, -1);
+    for (size_t begin = 0; begin < candidates_.size();) {
+        size_t end = begin + 1;
+        while (end < candidates_.size() && candidates_[end].group == candidates_[begin].group) {
+            ++end;
+        }
+        matchGroup(begin, end);
+        begin = end;
     }
 
-//    ROS_DEBUG_NAMED(MODULE, "Matched %d obstacles", match_counter);
-//    ROS_DEBUG_NAMED(MODULE, "Lost %zu obstacles", obstacles_.size() - match_counter);
-//    ROS_DEBUG_NAMED(MODULE, "Droped %zu dead obstacles", dead_count);
-
-    // If there are unmatched obstacles in the observation, add them as new obstacles
+    int match_counter = 0;
     int add_counter = 0;
-    for (size_t i = 0; i < observed_obstacles.size(); ++i) {
-        if (!obs_matched[i]) {
-            TrackedObstacle to(observed_obstacles[i]);
-            obstacles_.push_back(to);
+    const size_t n_tracked = obstacles_.size();
+    obstacles_.reserve(n_tracked + n_observed);
+    for (size_t o = 0; o < n_observed; ++o) {
+        if (match_[o] >= 0) {
+            obstacles_[match_[o]].update(observed_obstacles[o], now);
+            ++match_counter;
+        } else {
+            // If there are unmatched obstacles in the observation, add them as new obstacles
+            obstacles_.push_back(TrackedObstacle(observed_obstacles[o], now));
             ++add_counter;
         }
     }
 
-//    ROS_DEBUG_NAMED(MODULE, "Added %d new obstacles", add_counter);
+    ROS_DEBUG_NAMED(MODULE, "Matched %d, added %d, dropped %zu dead obstacles (%zu candidate pairs)",
+                    match_counter, add_counter, dead_count, candidates_.size());
 }
 
 void ObstacleTracker::reset()
@@ -119,37 +172,115 @@ void ObstacleTracker::reset()
     obstacles_.clear();
 }
 
-bool ObstacleTracker::isDead(ObstacleTracker::TrackedObstacle o)
+bool ObstacleTracker::isDead(const ObstacleTracker::TrackedObstacle &o, const ros::Time &now) const
 {
-    return (ros::Time::now() - o.time_of_last_sight()) > ros::Duration(opt_.lost_lifetime());
+    return (now - o.time_of_last_sight()) > ros::Duration(opt_.lost_lifetime());
 }
 
-void ObstacleTracker::removeRow(cv::Mat &m, int row)
+void ObstacleTracker::findCandidates(const std::vector<Obstacle> &observed_obstacles)
 {
-    assert(row >= 0 && row < m.rows);
+    const float max_dist = opt_.max_dist();
+    // avoid degenerated cells, if the threshold is 0 (only exact matches)
+    const float cell_size = std::max(max_dist, 1e-3f);
 
-    // {v|h}concat can not handle empty matrices, thus there are some nasty case distinctions necessary...
-    // Beware: end row/col of range-methods is exclusive!
-    if (row == 0) {
-        m = m.rowRange(1,m.rows);
-    } else if (row == m.rows-1) {
-        m = m.rowRange(0,row);
-    } else {
-        cv::vconcat(m.rowRange(0,row), m.rowRange(row+1, m.rows),  m);
+    // spatial hash of the tracked obstacles
+    track_cells_.clear();
+    track_cells_.reserve(obstacles_.size());
+    for (size_t t = 0; t < obstacles_.size(); ++t) {
+        const cv::Point2f &c = obstacles_[t].obstacle().center;
+        const int32_t cx = static_cast<int32_t>(std::floor(c.x / cell_size));
+        const int32_t cy = static_cast<int32_t>(std::floor(c.y / cell_size));
+        track_cells_.emplace_back(cellKey(cx, cy), t);
+    }
+    std::sort(track_cells_.begin(), track_cells_.end());
+
+    auto key_less = [](const std::pair<uint64_t, int> &a, const std::pair<uint64_t, int> &b) {
+        return a.first < b.first;
+    };
+
+    // gating: only tracked obstacles in the neighbouring cells can be closer than max_dist
+    candidates_.clear();
+    for (size_t o = 0; o < observed_obstacles.size(); ++o) {
+        const cv::Point2f &c = observed_obstacles[o].center;
+        const int32_t cx = static_cast<int32_t>(std::floor(c.x / cell_size));
+        const int32_t cy = static_cast<int32_t>(std::floor(c.y / cell_size));
+
+        for (int32_t dx = -1; dx <= 1; ++dx) {
+            for (int32_t dy = -1; dy <= 1; ++dy) {
+                const std::pair<uint64_t, int> key(cellKey(cx + dx, cy + dy), 0);
+                auto range = std::equal_range(track_cells_.begin(), track_cells_.end(), key, key_less);
+                for (auto it = range.first; it != range.second; ++it) {
+                    const float d = cv::norm(c - obstacles_[it->second].obstacle().center);
+                    if (d <= max_dist) {
+                        candidates_.push_back({static_cast<int>(o), it->second, d, 0});
+                    }
+                }
+            }
+        }
     }
 }
 
-void ObstacleTracker::removeColumn(cv::Mat &m, int col)
+void ObstacleTracker::matchGroup(size_t begin, size_t end)
 {
-    assert(col >= 0 && col < m.cols);
-
-    // {v|h}concat can not handle empty matrices, thus there are some nasty case distinctions necessary...
-    // Beware: end col/col of range-methods is exclusive!
-    if (col == 0) {
-        m = m.colRange(1,m.cols);
-    } else if (col == m.cols-1) {
-        m = m.colRange(0,col);
-    } else {
-        cv::hconcat(m.colRange(0,col), m.colRange(col+1, m.cols),  m);
+    // trivial, but by far the most common case
+    if (end - begin == 1) {
+        match_[candidates_[begin].observed] = candidates_[begin].tracked;
+        return;
+    }
+
+    const size_t n_observed = match_.size();
+
+    // local indices of the observed (rows) and tracked (columns) obstacles in this group
+    std::vector<int> rows, cols;
+    for (size_t k = begin; k < end; ++k) {
+        const Candidate &c = candidates_[k];
+        if (local_index_[c.observed] < 0) {
+            local_index_[c.observed] = rows.size();
+            rows.push_back(c.observed);
+        }
+        if (local_index_[n_observed + c.tracked] < 0) {
+            local_index_[n_observed + c.tracked] = cols.size();
+            cols.push_back(c.tracked);
+        }
+    }
+
+    // Hungarian method requires rows <= columns, so transpose if necessary.
+    const bool transpose = rows.size() > cols.size();
+    const int n = transpose ? cols.size() : rows.size();
+    const int m = transpose ? rows.size() : cols.size();
+
+    // Pairs that did not pass the gating get a cost that is higher than any complete assignment of valid pairs.
+    // This way the number of matches is maximized first and the sum of distances second.
+    const double invalid = opt_.max_dist() * n + 1.0;
+    std::vector<double> cost(n * m, invalid);
+    for (size_t k = begin; k < end; ++k) {
+        const Candidate &c = candidates_[k];
+        int r = local_index_[c.observed];
+        int q = local_index_[n_observed + c.tracked];
+        if (transpose) {
+            std::swap(r, q);
+        }
+        cost[r * m + q] = c.dist;
+    }
+
+    std::vector<int> assignment;
+    solveAssignment(cost, n, m, assignment);
+
+    for (int r = 0; r < n; ++r) {
+        const int q = assignment[r];
+        if (q < 0 || cost[r * m + q] >= invalid) {
+            continue;
+        }
+        const int o = transpose ? rows[q] : rows[r];
+        const int t = transpose ? cols[r] : cols[q];
+        match_[o] = t;
+    }
+
+    // reset the local indices for the next group
+    for (int o : rows) {
+        local_index_[o] = -1;
+    }
+    for (int t : cols) {
+        local_index_[n_observed + t] = -1;
     }
 }
@@ -8,6 +8,8 @@
 #endif
 #include <vector>
 #include <string>
+#include <cmath>
+#include <algorithm>
 
 #include <laser_geometry/laser_geometry.h>
 #include <pcl_ros/transforms.h>
@@ -22,11 +24,19 @@ using namespace std;
 namespace {
 //! Module name, that is used for ros console output
 const std::string MODULE = "s_pathlookout";
+
+//! Combine the two cell indices into one hash key.
+inline uint64_t cellKey(int32_t cx, int32_t cy)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+}
 }
 
 PathLookout::PathLookout(PoseTracker &pose_tracker):
     obstacle_frame_(PathFollowerParameters::getInstance()->world_frame()),
-    pose_tracker_(pose_tracker)
+    pose_tracker_(pose_tracker),
+    corridor_path_version_(0),
+    corridor_waypoint_index_(0)
 {
     #if DEBUG_PATHLOOKOUT
         cv::namedWindow("Map", CV_WINDOW_KEEPRATIO);
@@ -44,6 +54,13 @@ void PathLookout::setObstacleCloud(const std::shared_ptr<ObstacleCloud const> &c
 
 void PathLookout::setPath(Path::ConstPtr path)
 {
+    const uint64_t version = path->getVersion();
+    const size_t waypoint_index = path->getWaypointIndex();
+    if (version == corridor_path_version_ && waypoint_index == corridor_waypoint_index_ && !path_.empty()) {
+        // neither the path nor the current waypoint changed -> the corridor is still valid
+        return;
+    }
+
     // only use path from the last waypoint on ("do not look behind")
     path_.wps.clear();
     if (path->getWaypointIndex() == 0) {
@@ -53,6 +70,70 @@ void PathLookout::setPath(Path::ConstPtr path)
         start += (path->getWaypointIndex()-1);
         path_.wps.assign(start, (std::vector<Waypoint>::const_iterator) path->getCurrentSubPath().end());
     }
+
+    corridor_path_version_ = version;
+    corridor_waypoint_index_ = waypoint_index;
+    updateCorridor();
+}
+
+void PathLookout::updateCorridor()
+{
+    corridor_ = cv::Mat();
+
+    if (path_.size() < 2) {
+        return;
+    }
+
+    // only the part of the path within the lookout distance is checked
+    size_t end = 1;
+    float dist = 0.0f;
+    for (; end < path_.size(); ++end) {
+        dist += path_[end].distanceTo(path_[end-1]);
+        if (dist > opt_.lookout_distance()) {
+            break;
+        }
+    }
+    if (end < 2) {
+        return;
+    }
+
+    cv::Point2f min_pt(path_[0].x, path_[0].y);
+    cv::Point2f max_pt = min_pt;
+    for (size_t i = 1; i < end; ++i) {
+        min_pt.x = std::min<float>(min_pt.x, path_[i].x);
+        min_pt.y = std::min<float>(min_pt.y, path_[i].y);
+        max_pt.x = std::max<float>(max_pt.x, path_[i].x);
+        max_pt.y = std::max<float>(max_pt.y, path_[i].y);
+    }
+
+    const float res = opt_.grid_resolution();
+    const float margin = opt_.path_width() / 2.0f + res;
+    corridor_origin_ = cv::Point2f(min_pt.x - margin, min_pt.y - margin);
+
+    const int cols = std::ceil((max_pt.x - min_pt.x + 2*margin) / res) + 1;
+    const int rows = std::ceil((max_pt.y - min_pt.y + 2*margin) / res) + 1;
+    corridor_ = cv::Mat::zeros(rows, cols, CV_8U);
+
+    // A thick line with round caps covers exactly the points closer than path_width/2 to the segment.
+    const int thickness = std::max(1, cvRound(opt_.path_width() / res));
+    auto toCell = [this, res](const Waypoint& wp) {
+        return cv::Point(cvFloor((wp.x - corridor_origin_.x) / res),
+                         cvFloor((wp.y - corridor_origin_.y) / res));
+    };
+    for (size_t i = 1; i < end; ++i) {
+        cv::line(corridor_, toCell(path_[i-1]), toCell(path_[i]), cv::Scalar(255), thickness, 8);
+    }
+}
+
+Supervisor::Schedule PathLookout::getSchedule() const
+{
+    // processes the whole obstacle cloud
+    Schedule s;
+    s.cost = 2;
+    s.tick_interval = std::max(1, opt_.tick_interval());
+    s.new_data_only = opt_.new_data_only();
+    s.time_budget = opt_.time_budget();
+    return s;
 }
 
 void PathLookout::supervise(State &state, Supervisor::Result *out)
@@ -146,41 +227,17 @@ void PathLookout::eventNewGoal()
 
 vector<Obstacle> PathLookout::lookForObstacles()
 {
-    list<cv::Point2f> obs_front = findObstaclesInCloud(obstacle_cloud_);
-
-    // cluster
-    list<list<cv::Point2f> > obstacle_points = clusterPoints(obs_front,
-                                                             opt_.scan_cluster_max_distance());
-
-    vector<Obstacle> observed_obstacles;
-    observed_obstacles.reserve(obstacle_points.size());
-    for (auto it = obstacle_points.cbegin(); it != obstacle_points.cend(); ++it) {
-        // ignore clusters, that are too small
-        if (it->size() < (size_t)opt_.min_number_of_points()) {
-            continue;
-        }
-
-        try {
-            // get obstacle position and size from enclosing circle
-            Obstacle obstacle;
-            vector<cv::Point2f> v_obs_points(it->begin(), it->end());
-            cv::minEnclosingCircle(v_obs_points, obstacle.center, obstacle.radius);
-
-            observed_obstacles.push_back(obstacle);
-        } catch (const tf::TransformException& ex) {
-            ROS_ERROR_NAMED(MODULE, "TF-Error. Could not transform obstacle position. %s", ex.what());
-        } catch (const std::runtime_error &ex) { // is thrown, if no obstacle map is available.
-            ROS_ERROR_NAMED(MODULE, "An error occured: %s", ex.what());
-        }
-    }
+    findObstaclesInCloud(obstacle_cloud_);
 
-    return observed_obstacles;
+    return grid_clustering_.cluster(obstacle_points_, opt_.scan_cluster_max_distance(), opt_.min_number_of_points());
 }
 
 void PathLookout::reset()
 {
     // important! path has to be reseted, otherwise obstacles will be readded immediately.
     path_.wps.clear();
+    corridor_path_version_ = 0;
+    corridor_ = cv::Mat();
     tracker_.reset();
 }
 
@@ -224,115 +281,141 @@ float PathLookout::weightObstacle(cv::Point2f robot_pos, ObstacleTracker::Tracke
     return w_dist + w_time;
 }
 
-std::list<cv::Point2f> PathLookout::findObstaclesInCloud(const std::shared_ptr<ObstacleCloud const> &obstacles_container)
-{    
-    if (path_.size() < 2) {
+void PathLookout::findObstaclesInCloud(const std::shared_ptr<ObstacleCloud const> &obstacles_container)
+{
+    obstacle_points_.clear();
+
+    if (corridor_.empty()) {
         ROS_WARN_NAMED(MODULE, "Path has fewer than 2 waypoints. No obstacle lookout is done.");
-        return std::list<cv::Point2f>(); // return empty cloud
+        return;
     }
 
     ObstacleCloud::Cloud::ConstPtr cloud = obstacles_container->cloud;
 
     //TODO: ensure that obstacle_frame_ is the frame of the path.
-    ObstacleCloud::Cloud trans_cloud;
-    bool has_tf = pose_tracker_.getTransformListener().waitForTransform(obstacle_frame_,
-                                                                        cloud->header.frame_id,
-                                                                        pcl_conversions::fromPCL(cloud->header.stamp),
-                                                                        ros::Duration(0.05));
-    if (!has_tf) {
+    tf::Transform obstacle_to_cloud;
+    if (!pose_tracker_.tryGetTransform(obstacle_frame_, cloud->header.frame_id,
+                                       pcl_conversions::fromPCL(cloud->header.stamp),
+                                       ros::Duration(0.05), obstacle_to_cloud)) {
         ROS_WARN_THROTTLE_NAMED(0.5, MODULE, "Got no transfom for obstacle cloud. %s to %s ",obstacle_frame_.c_str(),
                         cloud->header.frame_id.c_str());
-        return std::list<cv::Point2f>(); // return empty cloud
-    }
-    if (!pcl_ros::transformPointCloud(obstacle_frame_, *cloud, trans_cloud, pose_tracker_.getTransformListener())) {
-        ROS_ERROR_THROTTLE_NAMED(1.0, MODULE, "Failed to transform obstacle cloud");
-        return std::list<cv::Point2f>(); // return empty cloud
+        return;
     }
 
-    //! Contains an 'is obstacle' flag for each point in the cloud
-    vector<bool> is_point_obs(trans_cloud.size(), false);
+    // Only the x/y-coordinates are needed, so the cloud is not transformed as a whole. Instead, each point is
+    // transformed on the fly and looked up in the corridor mask.
+    const tf::Vector3 row_x = obstacle_to_cloud.getBasis().getRow(0);
+    const tf::Vector3 row_y = obstacle_to_cloud.getBasis().getRow(1);
+    const tf::Vector3& t = obstacle_to_cloud.getOrigin();
+    const float inv_res = 1.0f / opt_.grid_resolution();
 
-    cv::Point2f a(path_[0].x, path_[0].y);
+    for (const ObstacleCloud::ObstaclePoint& pt : cloud->points) {
+        const float x = row_x.x() * pt.x + row_x.y() * pt.y + row_x.z() * pt.z + t.x();
+        const float y = row_y.x() * pt.x + row_y.y() * pt.y + row_y.z() * pt.z + t.y();
 
-    // iterate over second to last point, making steps of size opt_.segment_step_size() (i.e.
-    // 'step_size' many segments are approximated by one bigger segment).
-    // To assure, that every part of the path is checked, make the first step shorter, if the
-    // length of the path is not divisable by the step size.
-    size_t first_step = (path_.size() - 1) % opt_.segment_step_size();
-    if (first_step == 0) {
-        first_step = opt_.segment_step_size();
+        const int cx = cvFloor((x - corridor_origin_.x) * inv_res);
+        const int cy = cvFloor((y - corridor_origin_.y) * inv_res);
+        if (cx < 0 || cy < 0 || cx >= corridor_.cols || cy >= corridor_.rows) {
+            continue;
+        }
+
+        if (corridor_.at<uchar>(cy, cx)) {
+            obstacle_points_.emplace_back(x, y);
+        }
     }
-    size_t first_idx = 0;//min(first_step, path_.size()-1);
- //   size_t first_idx = path_->getWaypointIndex();
-    float dist = 0.0;
-    cv::Point2f prev(path_[first_idx].x,path_[first_idx].y);
-    ROS_INFO_THROTTLE(1.0, "first wp %f %f", prev.x,prev.y);
-  //  size_t i = path_->getWaypointIndex();
-
-    for (size_t i = min(first_step, path_.size()-1); i < path_.size(); i += opt_.segment_step_size()) {
-   // for (size_t i = path_->getWaypointIndex(); i < path_.size(); i += opt_.segment_step_size()) {
-        cv::Point2f b(path_[i].x, path_[i].y);
-        dist += cv::norm(b-prev);
-        prev = b;
-        if (dist>opt_.lookout_distance()) {
-            ROS_INFO_THROTTLE(1.0,"no obstacles");
-            break;
+}
+
+int PathLookout::GridClustering::findRoot(int cell)
+{
+    while (parent_[cell] != cell) {
+        parent_[cell] = parent_[parent_[cell]];
+        cell = parent_[cell];
+    }
+    return cell;
+}
+
+std::vector<Obstacle> PathLookout::GridClustering::cluster(const std::vector<cv::Point2f> &points, float cell_size,
+                                                           int min_number_of_points)
+{
+    std::vector<Obstacle> observed_obstacles;
+    if (points.empty()) {
+        return observed_obstacles;
+    }
+
+    // 1) put the points into the cells of a sparse grid
+    cells_.clear();
+    parent_.clear();
+    point_cell_.resize(points.size());
+
+    for (size_t i = 0; i < points.size(); ++i) {
+        const cv::Point2f& p = points[i];
+        const uint64_t key = cellKey(cvFloor(p.x / cell_size), cvFloor(p.y / cell_size));
+
+        auto res = cells_.emplace(key, static_cast<int>(parent_.size()));
+        if (res.second) {
+            parent_.push_back(res.first->second);
         }
-        /**
-         * For each point, compute the distance of this point to the current path segment. If the distance is too small,
-         * the corresponding field in is_point_obs is set to true (= this point is assumed to be an obstacle).
-         *
-         * Formulas taken from http://www.f09.fh-koeln.de/imperia/md/content/personen/schuh_werner/lehrveranstaltung/abstand
-         * Section 3 "Abstand zwischen einem Punkt und einer Strecke":
-         *
-         * Let A, B be the start and end point of the path segment. To get the distance of a point P to this segment
-         * first compute
-         *      $ \lambda = \frac{\overrightarrow{AP} \cdot \overrightarrow{AB}}{\overrightarrow{AB}^2} $
-         * If \lambda < 0:          dist = |\overrightarrow{AP}|
-         * If \lambda > 0:          dist = |\overrightarrow{BP}|
-         * If \lambda \in [0,1]:    dist = |\overrightarrow{FP}|,  where F = A + \lambda \cdot \overrightarrow{AB}
-         */
-
-        // precompute AB and AB^2
-        const cv::Point2f ab = b - a;
-        const float ab2 = ab.dot(ab);
-
-        // check distance of each point
-        for (size_t i = 0; i < trans_cloud.size(); ++i) {
-            const cv::Point2f p(trans_cloud.at(i).x, trans_cloud.at(i).y);
-            const cv::Point2f ap = p - a;
-            const float lambda = ap.dot(ab) / ab2;
-
-            float dist;
-            if (lambda < 0) {
-                // A is nearest point
-                dist = cv::norm(ap);
-            } else if (lambda > 1) {
-                // B is nearest point
-                dist = cv::norm(p - b);
-            } else {
-                // F is nearest point
-                cv::Point2f f = a + lambda * ab;
-                dist = cv::norm(p - f);
-            }
+        point_cell_[i] = res.first->second;
+    }
 
-            if (dist < opt_.path_width()/2.0) {
-                is_point_obs[i] = true;
+    // 2) join neighbouring cells (8-neighbourhood, looking at one half of it is sufficient)
+    static const int offsets[4][2] = { {1, -1}, {1, 0}, {1, 1}, {0, 1} };
+    for (const auto& cell : cells_) {
+        const int32_t cx = static_cast<int32_t>(static_cast<uint32_t>(cell.first >> 32));
+        const int32_t cy = static_cast<int32_t>(static_cast<uint32_t>(cell.first));
+
+        for (const auto& off : offsets) {
+            auto neighbour = cells_.find(cellKey(cx + off[0], cy + off[1]));
+            if (neighbour != cells_.end()) {
+                int a = findRoot(cell.second);
+                int b = findRoot(neighbour->second);
+                if (a != b) {
+                    parent_[a] = b;
+                }
             }
         }
+    }
+
+    // 3) compute the centroid of each component...
+    std::vector<int> label(parent_.size(), -1);
+    std::vector<cv::Point2f> centers;
+    std::vector<int> counts;
+    for (size_t i = 0; i < points.size(); ++i) {
+        int root = findRoot(point_cell_[i]);
+        if (label[root] < 0) {
+            label[root] = centers.size();
+            centers.push_back(cv::Point2f(0, 0));
+            counts.push_back(0);
+        }
+        point_cell_[i] = label[root];
+        centers[label[root]] += points[i];
+        ++counts[label[root]];
+    }
+    for (size_t c = 0; c < centers.size(); ++c) {
+        centers[c] *= 1.0f / counts[c];
+    }
 
-        a = b;
+    // ... and the radius of the circle around it that encloses all points of the component.
+    std::vector<float> radius(centers.size(), 0.0f);
+    for (size_t i = 0; i < points.size(); ++i) {
+        int c = point_cell_[i];
+        radius[c] = std::max<float>(radius[c], cv::norm(points[i] - centers[c]));
     }
 
-    list<cv::Point2f> obstacle_points;
-    for (size_t i = 0; i < trans_cloud.size(); ++i) {
-        if (is_point_obs[i]) {
-            cv::Point2f p(trans_cloud.at(i).x, trans_cloud.at(i).y);
-            obstacle_points.push_back(p);
+    observed_obstacles.reserve(centers.size());
+    for (size_t c = 0; c < centers.size(); ++c) {
+        // ignore clusters, that are too small
+        if (counts[c] < min_number_of_points) {
+            continue;
         }
+
+        Obstacle obstacle;
+        obstacle.center = centers[c];
+        obstacle.radius = radius[c];
+        observed_obstacles.push_back(obstacle);
     }
 
-    return obstacle_points;
+    return observed_obstacles;
 }
 
 std::list<std::list<cv::Point2f> > PathLookout::clusterPointsAlongAxis(std::list<cv::Point2f> points,
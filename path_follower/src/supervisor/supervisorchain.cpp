@@ -1,40 +1,132 @@
 #include <path_follower/supervisor/supervisorchain.h>
 
+#include <algorithm>
+#include <sstream>
+#include <ros/ros.h>
+
 using namespace std;
 
+namespace {
+//! Module name, that is used for ros console output
+const std::string MODULE = "supervisor_chain";
+}
+
+SupervisorChain::SupervisorChain()
+{
+}
+
 void SupervisorChain::addSupervisor(Supervisor::Ptr supervisor)
 {
-    ROS_INFO("Use Supervisor '%s'", supervisor->getName().c_str());
-    supervisors_.push_back(supervisor);
+    Entry entry;
+    entry.supervisor = supervisor;
+    entry.schedule = supervisor->getSchedule();
+    entry.schedule.tick_interval = std::max(1, entry.schedule.tick_interval);
+    // make sure the supervisor is run on the first tick
+    entry.ticks_since_run = entry.schedule.tick_interval;
+    entry.new_data = true;
+    entry.timing.name = supervisor->getName();
+
+    ROS_INFO("Use Supervisor '%s' (cost: %d, every %d. tick%s)", entry.timing.name.c_str(),
+             entry.schedule.cost, entry.schedule.tick_interval,
+             entry.schedule.new_data_only ? ", only on new data" : "");
+
+    // keep supervisors sorted by cost. Insert behind those with equal cost to preserve the order of insertion.
+    auto pos = std::upper_bound(supervisors_.begin(), supervisors_.end(), entry.schedule.cost,
+                                [](int cost, const Entry &e) { return cost < e.schedule.cost; });
+    supervisors_.insert(pos, entry);
+}
+
+bool SupervisorChain::isDue(Entry &entry, const Supervisor::State &state) const
+{
+    ++entry.ticks_since_run;
+    if (entry.ticks_since_run < entry.schedule.tick_interval) {
+        return false;
+    }
+    if (entry.schedule.new_data_only && !entry.new_data && entry.last_cloud == state.obstacle_cloud) {
+        return false;
+    }
+    return true;
 }
 
 Supervisor::Result SupervisorChain::supervise(Supervisor::State &state)
 {
-    list<Supervisor::Ptr>::iterator it;
-    for (it = supervisors_.begin(); it != supervisors_.end(); ++it) {
+    const ros::WallTime chain_start = ros::WallTime::now();
+
+    Supervisor::Result result; // Constructor sets to can_continue = true.
+
+    for (Entry &entry : supervisors_) {
+        if (!isDue(entry, state)) {
+            ++entry.timing.skips;
+            continue;
+        }
+
         Supervisor::Result res;
-        (*it)->supervise(state, &res);
+
+        const ros::WallTime start = ros::WallTime::now();
+        entry.supervisor->supervise(state, &res);
+        const double duration = (ros::WallTime::now() - start).toSec();
+
+        entry.ticks_since_run = 0;
+        entry.new_data = false;
+        entry.last_cloud = state.obstacle_cloud;
+
+        Timing &t = entry.timing;
+        ++t.runs;
+        t.total += duration;
+        t.max = std::max(t.max, duration);
+
+        if (entry.schedule.time_budget > 0.0 && duration > entry.schedule.time_budget) {
+            ROS_WARN_THROTTLE_NAMED(1, MODULE, "Supervisor '%s' exceeded its time budget (%g ms, budget: %g ms).",
+                                    t.name.c_str(), duration * 1e3, entry.schedule.time_budget * 1e3);
+        }
 
         if (!res.can_continue) {
-            return res;
+            result = res;
+            break;
         }
     }
 
-    return Supervisor::Result(); // Constructor sets to can_continue = true.
+    const double chain_duration = (ros::WallTime::now() - chain_start).toSec();
+    ROS_DEBUG_STREAM_THROTTLE_NAMED(5, MODULE, "Supervision took " << chain_duration * 1e3 << " ms. " << formatTimings());
+
+    return result;
 }
 
 void SupervisorChain::notifyNewGoal()
 {
-    list<Supervisor::Ptr>::iterator it;
-    for (it = supervisors_.begin(); it != supervisors_.end(); ++it) {
-        (*it)->eventNewGoal();
+    for (Entry &entry : supervisors_) {
+        entry.supervisor->eventNewGoal();
+        // run all supervisors on the first tick of the new path
+        entry.new_data = true;
+        entry.ticks_since_run = entry.schedule.tick_interval;
     }
 }
 
 void SupervisorChain::notifyNewWaypoint()
 {
-    list<Supervisor::Ptr>::iterator it;
-    for (it = supervisors_.begin(); it != supervisors_.end(); ++it) {
-        (*it)->eventNewWaypoint();
+    for (Entry &entry : supervisors_) {
+        entry.supervisor->eventNewWaypoint();
+        entry.new_data = true;
+    }
+}
+
+std::vector<SupervisorChain::Timing> SupervisorChain::getTimings() const
+{
+    std::vector<Timing> timings;
+    timings.reserve(supervisors_.size());
+    for (const Entry &entry : supervisors_) {
+        timings.push_back(entry.timing);
+    }
+    return timings;
+}
+
+std::string SupervisorChain::formatTimings() const
+{
+    std::ostringstream out;
+    for (const Entry &entry : supervisors_) {
+        const Timing &t = entry.timing;
+        out << "'" << t.name << "': " << t.runs << " runs, " << t.skips << " skips, mean "
+            << t.mean() * 1e3 << " ms, max " << t.max * 1e3 << " ms; ";
     }
+    return out.str();
 }
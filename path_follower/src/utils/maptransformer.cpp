@@ -19,8 +19,7 @@ cv::Point2f MapTransformer::transformPointToMap(const cv::Point2f &p, std::strin
     tf::Vector3 tf_p(p.x, p.y, 0);
 
     // lookup transform from point frame to map frame.
-    tf::StampedTransform trans_to_map_frame;
-    tf_listener_->lookupTransform(map_->header.frame_id, from, ros::Time(0), trans_to_map_frame);
+    tf::Transform trans_to_map_frame = pose_tracker_->getTransform(map_->header.frame_id, from, ros::Time(0), ros::Duration(0));
 
     // transform from map frame to map cell
     tf::Transform trans_to_map_origin = trans_from_map_cell_to_map_frame_.inverse();
@@ -48,8 +47,7 @@ cv::Point2f MapTransformer::transformPointFromMap(const cv::Point2f &p, std::str
     tf_p *= map_->info.resolution;
 
     // lookup transform from map frame to desired frame.
-    tf::StampedTransform trans_from_map_frame;
-    tf_listener_->lookupTransform(to, map_->header.frame_id, ros::Time(0), trans_from_map_frame);
+    tf::Transform trans_from_map_frame = pose_tracker_->getTransform(to, map_->header.frame_id, ros::Time(0), ros::Duration(0));
 
     // finally transform the point
     tf_p = trans_from_map_frame * trans_from_map_cell_to_map_frame_ * tf_p;
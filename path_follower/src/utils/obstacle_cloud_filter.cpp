@@ -0,0 +1,92 @@
+/// HEADER
+#include <path_follower/utils/obstacle_cloud_filter.h>
+
+/// SYSTEM
+#include <pcl_ros/point_cloud.h>
+#include <tf/tf.h>
+#include <cmath>
+
+namespace {
+//! Module name, that is used for ros console output
+const std::string MODULE = "obstacle_filter";
+
+//! Combine the two cell indices into one hash key.
+inline uint64_t cellKey(int32_t ix, int32_t iy)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) | static_cast<uint32_t>(iy);
+}
+}
+
+ObstacleCloudFilter::ObstacleCloudFilter()
+{
+}
+
+bool ObstacleCloudFilter::isEnabled() const
+{
+    return opt_.enabled();
+}
+
+ObstacleCloud::Ptr ObstacleCloudFilter::filter(const ObstacleCloud::Cloud &sensor_cloud,
+                                               const tf::Transform &fixed_to_sensor,
+                                               const std::string &target_frame)
+{
+    const float min_height = opt_.min_height();
+    const float max_height = opt_.max_height();
+    const float max_range = opt_.max_range();
+    const float max_range2 = max_range * max_range;
+    const float resolution = opt_.resolution();
+    const bool crop_range = max_range > 0.0f;
+    const bool decimate = resolution > 0.0f;
+
+    const tf::Vector3 origin = fixed_to_sensor.getOrigin();
+
+    ObstacleCloud::Cloud::Ptr out(new ObstacleCloud::Cloud);
+    out->header = sensor_cloud.header;
+    out->header.frame_id = target_frame;
+    out->points.reserve(decimate ? sensor_cloud.size() / 4 : sensor_cloud.size());
+
+    occupied_cells_.clear();
+
+    for(const ObstacleCloud::ObstaclePoint& pt : sensor_cloud.points) {
+        const tf::Point p = fixed_to_sensor * tf::Point(pt.x, pt.y, pt.z);
+
+        // invalid measurements, NaN would also pass the comparisons below
+        if(!std::isfinite(p.x()) || !std::isfinite(p.y()) || !std::isfinite(p.z())) {
+            continue;
+        }
+
+        // height band
+        if(p.z() < min_height || p.z() > max_height) {
+            continue;
+        }
+
+        // range crop
+        if(crop_range) {
+            const double dx = p.x() - origin.x();
+            const double dy = p.y() - origin.y();
+            if(dx*dx + dy*dy > max_range2) {
+                continue;
+            }
+        }
+
+        // one point per cell
+        if(decimate) {
+            const int32_t ix = static_cast<int32_t>(std::floor(p.x() / resolution));
+            const int32_t iy = static_cast<int32_t>(std::floor(p.y() / resolution));
+            if(!occupied_cells_.insert(cellKey(ix, iy)).second) {
+                continue;
+            }
+        }
+
+        out->points.emplace_back(p.x(), p.y(), p.z());
+    }
+
+    out->width = out->points.size();
+    out->height = 1;
+    out->is_dense = true;
+
+    ROS_DEBUG_THROTTLE_NAMED(1, MODULE, "obstacle filter: %zu -> %zu points",
+                             sensor_cloud.size(), out->points.size());
+
+    return std::make_shared<ObstacleCloud>(out);
+}
@@ -3,12 +3,20 @@
 //TODO: add unit test for this class
 #include <path_follower/controller/robotcontroller.h>
 
+#include <atomic>
+
+namespace {
+//! Last version assigned to any path.
+std::atomic<uint64_t> last_path_version(0);
+}
+
 void Path::clear()
 {
     path_.clear();
     current_sub_path_ = path_.begin();
     next_waypoint_idx_ = 0;
     wp_distance_to_end_.clear();
+    touch();
 }
 
 void Path::reset()
@@ -16,6 +24,7 @@ void Path::reset()
     current_sub_path_ = path_.begin();
     next_waypoint_idx_ = 0;
     computeWaypointToEndDistances();
+    touch();
 }
 
 void Path::setPath(const std::vector<SubPath> &path)
@@ -24,6 +33,7 @@ void Path::setPath(const std::vector<SubPath> &path)
     current_sub_path_ = path_.begin();
     next_waypoint_idx_ = 0;
     computeWaypointToEndDistances();
+    touch();
 }
 
 void Path::registerNextWaypointCallback(NextWaypointCallback_t func)
@@ -39,6 +49,7 @@ void Path::switchToNextSubPath()
     if (current_sub_path_ != endIter) {
         ++current_sub_path_;
         next_waypoint_idx_ = 0;
+        touch();
         fireNextWaypointCallback();
         computeWaypointToEndDistances();
     }
@@ -167,4 +178,15 @@ std::string Path::getFrameId() const
 void Path::setFrameId(const std::string &frame_id)
 {
     frame_id_ = frame_id;
+    touch();
+}
+
+uint64_t Path::getVersion() const
+{
+    return version_;
+}
+
+void Path::touch()
+{
+    version_ = ++last_path_version;
 }
@@ -4,10 +4,18 @@
 /// PROJECT
 #include <path_follower/parameters/path_follower_parameters.h>
 
+/// SYSTEM
+#include <algorithm>
+
 using namespace Eigen;
 
 PoseTracker::PoseTracker(const PathFollowerParameters &opt, ros::NodeHandle& nh)
     : opt_(opt),
+      cycle_(0),
+      world_to_odom_(tf::Transform::getIdentity()),
+      world_to_odom_update_(0),
+      robot_pose_world_(Vector3d::Zero()),
+      robot_pose_odom_(Vector3d::Zero()),
       local_(false)
 {
     odom_sub_ = nh.subscribe<nav_msgs::Odometry>("odom", 1, &PoseTracker::odometryCB, this);
@@ -40,9 +48,10 @@ std::string PoseTracker::getRobotFrameId() const
 
 void PoseTracker::odometryCB(const nav_msgs::OdometryConstPtr &odom)
 {
-    odometry_ = *odom;
+    // keep the shared message instead of copying it
+    odometry_ = odom;
 
-    robot_pose_odom_msg_ = odometry_.pose.pose;
+    robot_pose_odom_msg_ = odometry_->pose.pose;
 
     robot_pose_odom_.x() = robot_pose_odom_msg_.position.x;
     robot_pose_odom_.y() = robot_pose_odom_msg_.position.y;
@@ -52,6 +61,13 @@ void PoseTracker::odometryCB(const nav_msgs::OdometryConstPtr &odom)
 
 bool PoseTracker::updateRobotPose()
 {
+    // start a new cycle, this invalidates all cached transforms
+    ++cycle_;
+
+    if (pt_opt_.extrapolate_odometry() && odometry_) {
+        return getExtrapolatedPose();
+    }
+
     if (getWorldPose(&robot_pose_world_, &robot_pose_world_msg_)) {
         return true;
     } else {
@@ -59,6 +75,51 @@ bool PoseTracker::updateRobotPose()
     }
 }
 
+bool PoseTracker::getExtrapolatedPose()
+{
+    ros::Time now = ros::Time::now();
+
+    // the correction world -> odom changes slowly, so it is only refreshed from time to time
+    if (world_to_odom_update_.isZero() || now - world_to_odom_update_ > pt_opt_.correction_interval()) {
+        if (!tryGetTransform(opt_.world_frame(), opt_.odom_frame(), ros::Time(0), ros::Duration(0), world_to_odom_)) {
+            if (world_to_odom_update_.isZero()) {
+                ROS_ERROR("error with transform robot pose: no transformation from %s to %s",
+                          opt_.world_frame().c_str(), opt_.odom_frame().c_str());
+                return false;
+            }
+            // keep the last known correction
+        } else {
+            world_to_odom_update_ = now;
+        }
+    }
+
+    // extrapolate the odometry pose using the velocity in the robot frame
+    double dt = (now - odometry_->header.stamp).toSec();
+    dt = std::max(0.0, std::min(dt, (double) pt_opt_.max_extrapolation()));
+
+    const geometry_msgs::Twist& twist = odometry_->twist.twist;
+    tf::Transform delta(tf::createQuaternionFromYaw(twist.angular.z * dt),
+                        tf::Vector3(twist.linear.x * dt, twist.linear.y * dt, 0.0));
+
+    tf::Pose odom_pose;
+    tf::poseMsgToTF(odometry_->pose.pose, odom_pose);
+    odom_pose = odom_pose * delta;
+
+    poseFromTF(odom_pose, &robot_pose_odom_, &robot_pose_odom_msg_);
+    poseFromTF(world_to_odom_ * odom_pose, &robot_pose_world_, &robot_pose_world_msg_);
+
+    return true;
+}
+
+void PoseTracker::poseFromTF(const tf::Transform &pose, Vector3d *pose_vec, geometry_msgs::Pose *pose_msg)
+{
+    pose_vec->x()  = pose.getOrigin().x();
+    pose_vec->y()  = pose.getOrigin().y();
+    (*pose_vec)(2) = tf::getYaw(pose.getRotation());
+
+    tf::poseTFToMsg(pose, *pose_msg);
+}
+
 tf::TransformListener& PoseTracker::getTransformListener()
 {
     return pose_listener_;
@@ -66,27 +127,28 @@ tf::TransformListener& PoseTracker::getTransformListener()
 
 bool PoseTracker::getWorldPose(Vector3d *pose_vec , geometry_msgs::Pose *pose_msg) const
 {
-    tf::StampedTransform transform;
-    geometry_msgs::TransformStamped msg;
+    tf::Transform transform;
 
     try {
-        pose_listener_.lookupTransform(opt_.world_frame(), opt_.robot_frame(), ros::Time(0), transform);
+        transform = getTransform(opt_.world_frame(), opt_.robot_frame(), ros::Time(0), ros::Duration(0));
 
-    } catch (tf::TransformException& ex) {
+    } catch (const std::exception& ex) {
         ROS_ERROR("error with transform robot pose: %s", ex.what());
         return false;
     }
-    tf::transformStampedTFToMsg(transform, msg);
 
-    pose_vec->x()  = msg.transform.translation.x;
-    pose_vec->y()  = msg.transform.translation.y;
-    (*pose_vec)(2) = tf::getYaw(msg.transform.rotation);
+    geometry_msgs::Transform msg;
+    tf::transformTFToMsg(transform, msg);
+
+    pose_vec->x()  = msg.translation.x;
+    pose_vec->y()  = msg.translation.y;
+    (*pose_vec)(2) = tf::getYaw(msg.rotation);
 
     if(pose_msg != nullptr) {
-        pose_msg->position.x = msg.transform.translation.x;
-        pose_msg->position.y = msg.transform.translation.y;
-        pose_msg->position.z = msg.transform.translation.z;
-        pose_msg->orientation = msg.transform.rotation;
+        pose_msg->position.x = msg.translation.x;
+        pose_msg->position.y = msg.translation.y;
+        pose_msg->position.z = msg.translation.z;
+        pose_msg->orientation = msg.rotation;
     }
     return true;
 }
@@ -106,29 +168,37 @@ bool PoseTracker::transformToLocal(const geometry_msgs::PoseStamped &global, Vec
 }
 
 
-bool PoseTracker::transformToLocal(const geometry_msgs::PoseStamped &global_org, geometry_msgs::PoseStamped &local)
+bool PoseTracker::transformToLocal(const geometry_msgs::PoseStamped &global, geometry_msgs::PoseStamped &local)
 {
-    geometry_msgs::PoseStamped global(global_org);
     try {
-        global.header.frame_id = getFixedFrameId();
-        pose_listener_.transformPose(opt_.robot_frame(),ros::Time(0),global, global.header.frame_id,local);
+        tf::Transform robot_to_fixed = getTransform(opt_.robot_frame(), getFixedFrameId(), ros::Time(0), ros::Duration(0));
+
+        tf::Pose pose;
+        tf::poseMsgToTF(global.pose, pose);
+        tf::poseTFToMsg(robot_to_fixed * pose, local.pose);
+        local.header.frame_id = opt_.robot_frame();
+        local.header.stamp = global.header.stamp;
         return true;
 
-    } catch (tf::TransformException& ex) {
+    } catch (const std::exception& ex) {
         ROS_ERROR("error with transform goal pose: %s", ex.what());
         return false;
     }
 }
 
-bool PoseTracker::transformToGlobal(const geometry_msgs::PoseStamped &local_org, geometry_msgs::PoseStamped &global)
+bool PoseTracker::transformToGlobal(const geometry_msgs::PoseStamped &local, geometry_msgs::PoseStamped &global)
 {
-    geometry_msgs::PoseStamped local(local_org);
     try {
-        local.header.frame_id=opt_.robot_frame();
-        pose_listener_.transformPose(getFixedFrameId(),ros::Time(0),local,opt_.robot_frame(),global);
+        tf::Transform fixed_to_robot = getTransform(getFixedFrameId(), opt_.robot_frame(), ros::Time(0), ros::Duration(0));
+
+        tf::Pose pose;
+        tf::poseMsgToTF(local.pose, pose);
+        tf::poseTFToMsg(fixed_to_robot * pose, global.pose);
+        global.header.frame_id = getFixedFrameId();
+        global.header.stamp = local.header.stamp;
         return true;
 
-    } catch (tf::TransformException& ex) {
+    } catch (const std::exception& ex) {
         ROS_ERROR("error with transform goal pose: %s", ex.what());
         return false;
     }
@@ -136,7 +206,10 @@ bool PoseTracker::transformToGlobal(const geometry_msgs::PoseStamped &local_org,
 
 geometry_msgs::Twist PoseTracker::getVelocity() const
 {
-    return odometry_.twist.twist;
+    if(!odometry_) {
+        return geometry_msgs::Twist();
+    }
+    return odometry_->twist.twist;
 }
 
 Eigen::Vector3d PoseTracker::getRobotPose() const
@@ -162,9 +235,46 @@ tf::Transform PoseTracker::getRelativeTransform(const std::string &frame, const
     return getTransform(getRobotFrameId(), frame, time, max_wait);
 }
 
+const PoseTracker::CachedTransform* PoseTracker::findCached(const std::string &fixed_frame, const std::string &frame,
+                                                             const ros::Time &time, bool exact) const
+{
+    // each frame pair is only looked up once per cycle
+    auto cached = transform_cache_.find(std::make_pair(fixed_frame, frame));
+    if(cached == transform_cache_.end()) {
+        return nullptr;
+    }
+
+    const CachedTransform& entry = cached->second;
+    if(entry.cycle != cycle_ || entry.time != time || (exact && !entry.exact)) {
+        return nullptr;
+    }
+    // the latest transformation changes with every tf message, updateRobotPose() does not run while the follower is idle
+    if(time.isZero() && ros::Time::now() - entry.looked_up > pt_opt_.latest_cache_lifetime()) {
+        return nullptr;
+    }
+    return &entry;
+}
+
+void PoseTracker::storeCached(const std::string &fixed_frame, const std::string &frame, const ros::Time &time,
+                              const tf::Transform &trafo, bool exact) const
+{
+    CachedTransform& entry = transform_cache_[std::make_pair(fixed_frame, frame)];
+    entry.transform = trafo;
+    entry.time = time;
+    entry.looked_up = time.isZero() ? ros::Time::now() : ros::Time();
+    entry.cycle = cycle_;
+    entry.exact = exact;
+}
+
 tf::Transform PoseTracker::getTransform(const std::string &fixed_frame, const std::string &frame, const ros::Time &time, const ros::Duration& max_wait) const
 {
+    const CachedTransform* cached = findCached(fixed_frame, frame, time, false);
+    if(cached) {
+        return cached->transform;
+    }
+
     tf::StampedTransform trafo;
+    bool exact = true;
     if(pose_listener_.waitForTransform(fixed_frame, frame, time, max_wait)) {
         pose_listener_.lookupTransform(fixed_frame, frame, time, trafo);
 
@@ -178,6 +288,49 @@ tf::Transform PoseTracker::getTransform(const std::string &fixed_frame, const st
         ROS_WARN_STREAM_THROTTLE(0.1, "cannot lookup relative transform from " << fixed_frame << " to " << frame << " at time " << latest_time
                         << ". Using latest transform");
         pose_listener_.lookupTransform(fixed_frame, frame, latest_time, trafo);
+        exact = false;
     }
+
+    storeCached(fixed_frame, frame, time, trafo, exact);
+
     return trafo;
 }
+
+bool PoseTracker::tryGetTransform(const std::string &fixed_frame, const std::string &frame, const ros::Time &time, const ros::Duration &max_wait,
+                                  tf::Transform &trafo) const
+{
+    try {
+        trafo = getTransform(fixed_frame, frame, time, max_wait);
+        return true;
+
+    } catch (const std::exception& ex) {
+        ROS_WARN_STREAM_THROTTLE(1, "cannot lookup transform from " << fixed_frame << " to " << frame << ": " << ex.what());
+        return false;
+    }
+}
+
+bool PoseTracker::tryGetExactTransform(const std::string &fixed_frame, const std::string &frame, const ros::Time &time, const ros::Duration &max_wait,
+                                       tf::Transform &trafo) const
+{
+    const CachedTransform* cached = findCached(fixed_frame, frame, time, true);
+    if(cached) {
+        trafo = cached->transform;
+        return true;
+    }
+
+    try {
+        if(!pose_listener_.waitForTransform(fixed_frame, frame, time, max_wait)) {
+            ROS_WARN_STREAM_THROTTLE(1, "cannot lookup transform from " << fixed_frame << " to " << frame << " at time " << time);
+            return false;
+        }
+        tf::StampedTransform stamped;
+        pose_listener_.lookupTransform(fixed_frame, frame, time, stamped);
+        storeCached(fixed_frame, frame, time, stamped, true);
+        trafo = stamped;
+        return true;
+
+    } catch (const tf::TransformException& ex) {
+        ROS_WARN_STREAM_THROTTLE(1, "cannot lookup transform from " << fixed_frame << " to " << frame << ": " << ex.what());
+        return false;
+    }
+}
@@ -96,6 +96,49 @@ TEST(TestPathLookout, obstacleTracker)
     ASSERT_LT(tracked2[1].time_of_last_sight(), tracked3[1].time_of_last_sight());
 }
 
+TEST(TestPathLookout, obstacleTrackerOptimalMatching)
+{
+    typedef ObstacleTracker::TrackedObstacle TrackedObstacle;
+
+    Obstacle track1;
+    track1.center = cv::Point2f(0,0);
+    track1.radius = 0.3;
+
+    Obstacle track2;
+    track2.center = cv::Point2f(1.5,0);
+    track2.radius = 0.3;
+
+    ObstacleTracker tracker;
+    tracker.setMaxDist(1);
+    tracker.update({track1, track2});
+
+    const std::vector<TrackedObstacle> tracked0 = tracker.getTrackedObstacles();
+    ASSERT_EQ(2, tracked0.size());
+    // all obstacles of one observation are seen at the same time
+    ASSERT_EQ(tracked0[0].time_of_first_sight(), tracked0[1].time_of_first_sight());
+
+    // obs1 is closest to track1, but only track2 is left for it, if obs2 is matched with track1.
+    // Matching obs1 with track1 first (greedy) would leave obs2 and track2 unmatched.
+    Obstacle obs1;
+    obs1.center = cv::Point2f(0.6,0);
+    obs1.radius = 0.3;
+
+    Obstacle obs2;
+    obs2.center = cv::Point2f(-0.7,0);
+    obs2.radius = 0.3;
+
+    tracker.update({obs1, obs2});
+    const std::vector<TrackedObstacle> tracked1 = tracker.getTrackedObstacles();
+
+    // both observations are matched, no new obstacle is added
+    ASSERT_EQ(2, tracked1.size());
+    ASSERT_EQ(tracked0[0].id(), tracked1[0].id());
+    ASSERT_EQ(tracked0[1].id(), tracked1[1].id());
+    ASSERT_EQ(tracked1[0].obstacle(), obs2);
+    ASSERT_EQ(tracked1[1].obstacle(), obs1);
+    ASSERT_EQ(tracked1[0].time_of_last_sight(), tracked1[1].time_of_last_sight());
+}
+
 
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv){
@@ -119,6 +119,24 @@ TEST_F(TestPath, testClear)
     ASSERT_TRUE(path_.empty());
 }
 
+TEST_F(TestPath, testVersion)
+{
+    const uint64_t version = path_.getVersion();
+
+    // moving along the sub path keeps the version
+    path_.switchToNextWaypoint();
+    ASSERT_EQ(version, path_.getVersion());
+
+    path_.switchToNextSubPath();
+    const uint64_t next_version = path_.getVersion();
+    ASSERT_NE(version, next_version);
+
+    // a new path never has the version of an existing one
+    Path other("map");
+    ASSERT_NE(version, other.getVersion());
+    ASSERT_NE(next_version, other.getVersion());
+}
+
 //TODO: test waypoint callback
 
 TEST_F(TestPath, testSubPathCount)
@@ -91,6 +91,58 @@ TEST(TestPathLookout, clusterPoints)
     }
 }
 
+TEST(TestPathLookout, gridClustering)
+{
+    vector<cv::Point2f> points;
+
+    // one obstacle spread over two neighbouring cells
+    points.push_back(cv::Point2f(0.2, 0.2));
+    points.push_back(cv::Point2f(0.8, 0.3));
+    points.push_back(cv::Point2f(1.2, 0.4));
+    points.push_back(cv::Point2f(0.6, 0.9));
+
+    // a second obstacle far away
+    points.push_back(cv::Point2f(10.0, 10.0));
+    points.push_back(cv::Point2f(10.6, 10.0));
+    points.push_back(cv::Point2f(10.3, 10.3));
+
+    // too few points to be an obstacle
+    points.push_back(cv::Point2f(5.5, 5.5));
+
+    // diagonal neighbour cells are combined, although the points are more than the cell size apart
+    points.push_back(cv::Point2f(20.1, 20.1));
+    points.push_back(cv::Point2f(21.9, 21.9));
+
+    // cells that are not neighbours are not combined
+    points.push_back(cv::Point2f(30.5, 30.5));
+    points.push_back(cv::Point2f(32.5, 30.5));
+
+    PathLookout::GridClustering clustering;
+    vector<Obstacle> obstacles = clustering.cluster(points, 1.0f, 2);
+
+    // sort by x for comparison
+    sort(obstacles.begin(), obstacles.end(), [](const Obstacle& a, const Obstacle& b) {
+        return a.center.x < b.center.x;
+    });
+
+    ASSERT_EQ(3u, obstacles.size());
+
+    EXPECT_NEAR(0.7, obstacles[0].center.x, 1e-5);
+    EXPECT_NEAR(0.45, obstacles[0].center.y, 1e-5);
+    EXPECT_NEAR(cv::norm(cv::Point2f(0.2, 0.2) - obstacles[0].center), obstacles[0].radius, 1e-5);
+
+    EXPECT_NEAR(10.3, obstacles[1].center.x, 1e-5);
+    EXPECT_NEAR(10.1, obstacles[1].center.y, 1e-5);
+    EXPECT_NEAR(cv::norm(cv::Point2f(10.0, 10.0) - obstacles[1].center), obstacles[1].radius, 1e-5);
+
+    EXPECT_NEAR(21.0, obstacles[2].center.x, 1e-5);
+    EXPECT_NEAR(21.0, obstacles[2].center.y, 1e-5);
+
+    // the buffers are reused, a second call gives the same result
+    ASSERT_EQ(3u, clustering.cluster(points, 1.0f, 2).size());
+    ASSERT_TRUE(clustering.cluster(vector<cv::Point2f>(), 1.0f, 2).empty());
+}
+
 
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv){
@@ -0,0 +1,402 @@
+#ifndef PATH_MSGS_TILED_MAP_H
+#define PATH_MSGS_TILED_MAP_H
+
+/// PROJECT
+#include <path_msgs/TiledMap.h>
+
+/// SYSTEM
+#include <nav_msgs/OccupancyGrid.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace path_msgs
+{
+
+/**
+ * @brief Helpers shared by TiledMapEncoder and TiledMapStore
+ */
+namespace tiled_map
+{
+
+inline bool sameGeometry(const nav_msgs::MapMetaData &a, const nav_msgs::MapMetaData &b)
+{
+    return a.width == b.width && a.height == b.height && a.resolution == b.resolution &&
+            a.origin.position.x == b.origin.position.x && a.origin.position.y == b.origin.position.y &&
+            a.origin.orientation.z == b.origin.orientation.z && a.origin.orientation.w == b.origin.orientation.w;
+}
+
+inline unsigned tileCount(unsigned size, unsigned tile_size)
+{
+    return (size + tile_size - 1) / tile_size;
+}
+
+/**
+ * @brief Appends the (count, value) run length encoding of data to out
+ */
+inline void encodeRle(const uint8_t* data, std::size_t n, std::vector<uint8_t>& out)
+{
+    std::size_t i = 0;
+    while(i < n) {
+        const uint8_t value = data[i];
+        std::size_t run = 1;
+        while(run < 255 && i + run < n && data[i + run] == value) {
+            ++run;
+        }
+        out.push_back(run);
+        out.push_back(value);
+        i += run;
+    }
+}
+
+/**
+ * @brief Decodes exactly n bytes, returns false if the encoding does not match n
+ */
+inline bool decodeRle(const std::vector<uint8_t>& in, uint8_t* data, std::size_t n)
+{
+    std::size_t pos = 0;
+    for(std::size_t i = 0; i + 1 < in.size(); i += 2) {
+        const std::size_t run = in[i];
+        if(pos + run > n) {
+            return false;
+        }
+        std::memset(data + pos, in[i + 1], run);
+        pos += run;
+    }
+    return pos == n && in.size() % 2 == 0;
+}
+
+}
+
+/**
+ * @brief Producer side of the tiled map transport, encodes the tiles that changed since the last call
+ *
+ * The encoder keeps a copy of the last map. Changed tiles are sent raw, run length encoded or as run length encoded xor delta to
+ * the previous version, whatever is smallest. Every keyframe_interval encoded maps, and whenever the map geometry changes, all tiles are sent
+ * so receivers that missed a message or joined late can recover.
+ */
+class TiledMapEncoder
+{
+public:
+    TiledMapEncoder(unsigned tile_size = 64, unsigned keyframe_interval = 50)
+        : tile_size_(std::max(tile_size, 1u)), keyframe_interval_(keyframe_interval),
+          since_keyframe_(0), sequence_(0), has_map_(false)
+    {
+    }
+
+    /**
+     * @brief The next message will be a keyframe
+     */
+    void forceKeyframe()
+    {
+        has_map_ = false;
+    }
+
+    /**
+     * @brief Encodes map into msg, returns false if nothing changed and there is nothing to send
+     */
+    bool encode(const nav_msgs::OccupancyGrid& map, TiledMap& msg)
+    {
+        const unsigned w = map.info.width;
+        const unsigned h = map.info.height;
+        const unsigned tiles_x = tiled_map::tileCount(w, tile_size_);
+        const unsigned tiles_y = tiled_map::tileCount(h, tile_size_);
+
+        const bool keyframe = !has_map_ || !tiled_map::sameGeometry(map.info, info_) ||
+                (keyframe_interval_ > 0 && since_keyframe_ + 1 >= keyframe_interval_);
+
+        if(keyframe) {
+            versions_.assign(tiles_x * tiles_y, 0);
+            since_keyframe_ = 0;
+        } else {
+            ++since_keyframe_;
+        }
+
+        msg.header = map.header;
+        msg.info = map.info;
+        msg.tile_size = tile_size_;
+        msg.sequence = sequence_;
+        msg.keyframe = keyframe;
+        msg.tiles.clear();
+
+        const uint8_t* cur = reinterpret_cast<const uint8_t*>(map.data.data());
+        const uint8_t* prev = reinterpret_cast<const uint8_t*>(prev_.data());
+
+        for(unsigned ty = 0; ty < tiles_y; ++ty) {
+            for(unsigned tx = 0; tx < tiles_x; ++tx) {
+                const unsigned x0 = tx * tile_size_;
+                const unsigned y0 = ty * tile_size_;
+                const unsigned tw = std::min(tile_size_, w - x0);
+                const unsigned th = std::min(tile_size_, h - y0);
+
+                bool changed = keyframe;
+                for(unsigned y = y0; y < y0 + th && !changed; ++y) {
+                    changed = std::memcmp(cur + y * w + x0, prev + y * w + x0, tw) != 0;
+                }
+                if(!changed) {
+                    continue;
+                }
+
+                const unsigned index = ty * tiles_x + tx;
+
+                tile_.resize(tw * th);
+                for(unsigned y = 0; y < th; ++y) {
+                    std::memcpy(&tile_[y * tw], cur + (y0 + y) * w + x0, tw);
+                }
+
+                msg.tiles.push_back(MapTile());
+                MapTile& out = msg.tiles.back();
+                out.index = index;
+                out.base_version = versions_[index];
+                out.version = keyframe ? 0 : versions_[index] + 1;
+                versions_[index] = out.version;
+
+                out.encoding = MapTile::ENCODING_RLE;
+                tiled_map::encodeRle(tile_.data(), tile_.size(), out.data);
+
+                if(!keyframe) {
+                    delta_.resize(tw * th);
+                    for(unsigned y = 0; y < th; ++y) {
+                        const uint8_t* c = cur + (y0 + y) * w + x0;
+                        const uint8_t* p = prev + (y0 + y) * w + x0;
+                        uint8_t* d = &delta_[y * tw];
+                        for(unsigned x = 0; x < tw; ++x) {
+                            d[x] = c[x] ^ p[x];
+                        }
+                    }
+                    encoded_.clear();
+                    tiled_map::encodeRle(delta_.data(), delta_.size(), encoded_);
+                    if(encoded_.size() < out.data.size()) {
+                        out.encoding = MapTile::ENCODING_DELTA_RLE;
+                        out.data.swap(encoded_);
+                    }
+                }
+
+                if(out.data.size() >= tile_.size()) {
+                    out.encoding = MapTile::ENCODING_RAW;
+                    out.data.assign(tile_.begin(), tile_.end());
+                }
+            }
+        }
+
+        prev_.assign(map.data.begin(), map.data.end());
+        info_ = map.info;
+        has_map_ = true;
+
+        if(!keyframe && msg.tiles.empty()) {
+            return false;
+        }
+        ++sequence_;
+        return true;
+    }
+
+private:
+    unsigned tile_size_;
+    unsigned keyframe_interval_;
+    unsigned since_keyframe_;
+    uint32_t sequence_;
+
+    bool has_map_;
+    nav_msgs::MapMetaData info_;
+    std::vector<int8_t> prev_;
+    std::vector<uint32_t> versions_;
+
+    std::vector<uint8_t> tile_;
+    std::vector<uint8_t> delta_;
+    std::vector<uint8_t> encoded_;
+};
+
+/**
+ * @brief Receiver side of the tiled map transport, keeps the full map and the tiles that changed since the last clearChanged()
+ */
+class TiledMapStore
+{
+public:
+    TiledMapStore()
+        : valid_(false), sequence_(0), tile_size_(0), tiles_x_(0), tiles_y_(0), geometry_changed_(false)
+    {
+    }
+
+    /**
+     * @brief Applies a message, the cost is linear in the size of the transported tiles.
+     *
+     * Returns false if the message does not fit the stored map (e.g. a message was missed),
+     * the store is then invalid until the next keyframe.
+     */
+    bool apply(const TiledMap& msg)
+    {
+        if(msg.keyframe) {
+            if(msg.tile_size == 0) {
+                return false;
+            }
+            const bool same = valid_ && tiled_map::sameGeometry(msg.info, info_) && msg.tile_size == tile_size_;
+
+            info_ = msg.info;
+            tile_size_ = msg.tile_size;
+            tiles_x_ = tiled_map::tileCount(info_.width, tile_size_);
+            tiles_y_ = tiled_map::tileCount(info_.height, tile_size_);
+            data_.resize(info_.width * info_.height);
+            versions_.assign(tiles_x_ * tiles_y_, 0);
+            geometry_changed_ = geometry_changed_ || !same;
+            valid_ = true;
+
+        } else if(!valid_ || msg.sequence != sequence_ + 1 ||
+                  !tiled_map::sameGeometry(msg.info, info_) || msg.tile_size != tile_size_) {
+            valid_ = false;
+            return false;
+        }
+
+        header_ = msg.header;
+        sequence_ = msg.sequence;
+
+        for(std::vector<MapTile>::const_iterator it = msg.tiles.begin(); it != msg.tiles.end(); ++it) {
+            if(!applyTile(*it)) {
+                valid_ = false;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool valid() const
+    {
+        return valid_;
+    }
+
+    const std_msgs::Header& header() const
+    {
+        return header_;
+    }
+
+    const nav_msgs::MapMetaData& info() const
+    {
+        return info_;
+    }
+
+    /**
+     * @brief The map cells in the layout of nav_msgs::OccupancyGrid::data
+     */
+    const std::vector<int8_t>& data() const
+    {
+        return data_;
+    }
+
+    /**
+     * @brief Cell rectangle of a tile
+     */
+    void tileRect(unsigned index, unsigned& x0, unsigned& y0, unsigned& w, unsigned& h) const
+    {
+        x0 = (index % tiles_x_) * tile_size_;
+        y0 = (index / tiles_x_) * tile_size_;
+        w = std::min(tile_size_, info_.width - x0);
+        h = std::min(tile_size_, info_.height - y0);
+    }
+
+    /**
+     * @brief Indices of the tiles changed since the last clearChanged(), without duplicates
+     */
+    const std::vector<uint32_t>& changedTiles() const
+    {
+        return changed_;
+    }
+
+    /**
+     * @brief True if the map was replaced with a different geometry since the last clearChanged(), all tiles have to be read then
+     */
+    bool geometryChanged() const
+    {
+        return geometry_changed_;
+    }
+
+    void clearChanged()
+    {
+        for(std::vector<uint32_t>::const_iterator it = changed_.begin(); it != changed_.end(); ++it) {
+            changed_flags_[*it] = false;
+        }
+        changed_.clear();
+        geometry_changed_ = false;
+    }
+
+private:
+    bool applyTile(const MapTile& tile)
+    {
+        if(tile.index >= versions_.size()) {
+            return false;
+        }
+
+        unsigned x0, y0, tw, th;
+        tileRect(tile.index, x0, y0, tw, th);
+        const std::size_t n = tw * th;
+
+        buffer_.resize(n);
+        switch(tile.encoding) {
+        case MapTile::ENCODING_RAW:
+            if(tile.data.size() != n) {
+                return false;
+            }
+            std::copy(tile.data.begin(), tile.data.end(), buffer_.begin());
+            break;
+        case MapTile::ENCODING_RLE:
+        case MapTile::ENCODING_DELTA_RLE:
+            if(!tiled_map::decodeRle(tile.data, buffer_.data(), n)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+
+        const bool delta = tile.encoding == MapTile::ENCODING_DELTA_RLE;
+        if(delta && tile.base_version != versions_[tile.index]) {
+            return false;
+        }
+
+        uint8_t* map = reinterpret_cast<uint8_t*>(data_.data());
+        for(unsigned y = 0; y < th; ++y) {
+            uint8_t* row = map + (y0 + y) * info_.width + x0;
+            const uint8_t* src = &buffer_[y * tw];
+            if(delta) {
+                for(unsigned x = 0; x < tw; ++x) {
+                    row[x] ^= src[x];
+                }
+            } else {
+                std::memcpy(row, src, tw);
+            }
+        }
+        versions_[tile.index] = tile.version;
+
+        if(changed_flags_.size() != versions_.size()) {
+            changed_flags_.assign(versions_.size(), false);
+            changed_.clear();
+        }
+        if(!changed_flags_[tile.index]) {
+            changed_flags_[tile.index] = true;
+            changed_.push_back(tile.index);
+        }
+
+        return true;
+    }
+
+private:
+    bool valid_;
+    uint32_t sequence_;
+    std_msgs::Header header_;
+    nav_msgs::MapMetaData info_;
+    unsigned tile_size_;
+    unsigned tiles_x_;
+    unsigned tiles_y_;
+
+    std::vector<int8_t> data_;
+    std::vector<uint32_t> versions_;
+
+    std::vector<uint32_t> changed_;
+    std::vector<bool> changed_flags_;
+    bool geometry_changed_;
+
+    std::vector<uint8_t> buffer_;
+};
+
+}
+
+#endif // PATH_MSGS_TILED_MAP_H
@@ -0,0 +1,216 @@
+/**
+ * Test of the tiled map transport (TiledMapEncoder / TiledMapStore).
+ */
+#include <gtest/gtest.h>
+#include <path_msgs/tiled_map.h>
+
+using namespace path_msgs;
+
+namespace
+{
+
+nav_msgs::OccupancyGrid createMap(unsigned width, unsigned height)
+{
+    nav_msgs::OccupancyGrid map;
+    map.info.width = width;
+    map.info.height = height;
+    map.info.resolution = 0.05;
+    map.info.origin.orientation.w = 1.0;
+    map.data.assign(width * height, -1);
+    return map;
+}
+
+//! Marks a rectangle as free space with an obstacle line, so runs of different values are encoded
+void paint(nav_msgs::OccupancyGrid& map, unsigned x0, unsigned y0, unsigned w, unsigned h)
+{
+    for(unsigned y = y0; y < y0 + h && y < map.info.height; ++y) {
+        for(unsigned x = x0; x < x0 + w && x < map.info.width; ++x) {
+            map.data[y * map.info.width + x] = (x + y) % 7 == 0 ? 100 : 0;
+        }
+    }
+}
+
+//! Encodes map and returns the message, fails if there is nothing to send
+TiledMap encode(TiledMapEncoder& encoder, const nav_msgs::OccupancyGrid& map)
+{
+    TiledMap msg;
+    EXPECT_TRUE(encoder.encode(map, msg));
+    return msg;
+}
+
+}
+
+TEST(TestTiledMap, roundTrip)
+{
+    TiledMapEncoder encoder(16, 0);
+    TiledMapStore store;
+
+    nav_msgs::OccupancyGrid map = createMap(60, 40);
+    paint(map, 5, 5, 10, 10);
+
+    TiledMap msg = encode(encoder, map);
+    ASSERT_TRUE(msg.keyframe);
+    ASSERT_EQ(4u * 3u, msg.tiles.size());
+    ASSERT_TRUE(store.apply(msg));
+    ASSERT_TRUE(store.valid());
+    ASSERT_TRUE(store.geometryChanged());
+    ASSERT_EQ(map.data, store.data());
+    store.clearChanged();
+
+    // a change inside of tile 1 only sends that tile
+    paint(map, 20, 2, 5, 5);
+    msg = encode(encoder, map);
+    ASSERT_FALSE(msg.keyframe);
+    ASSERT_EQ(1u, msg.tiles.size());
+    ASSERT_EQ(1u, msg.tiles[0].index);
+    ASSERT_TRUE(store.apply(msg));
+    ASSERT_EQ(map.data, store.data());
+    ASSERT_FALSE(store.geometryChanged());
+    ASSERT_EQ(std::vector<uint32_t>(1, 1), store.changedTiles());
+    store.clearChanged();
+
+    // nothing changed, nothing to send
+    TiledMap empty;
+    ASSERT_FALSE(encoder.encode(map, empty));
+
+    // many updates of different sizes
+    for(unsigned step = 0; step < 20; ++step) {
+        paint(map, (step * 7) % 60, (step * 5) % 40, 3 + step % 9, 2 + step % 4);
+        map.data[(step * 131) % map.data.size()] = 50;
+        msg = encode(encoder, map);
+        ASSERT_TRUE(store.apply(msg));
+        ASSERT_EQ(map.data, store.data());
+    }
+}
+
+TEST(TestTiledMap, missedMessage)
+{
+    TiledMapEncoder encoder(16, 0);
+    TiledMapStore store;
+
+    nav_msgs::OccupancyGrid map = createMap(40, 40);
+    ASSERT_TRUE(store.apply(encode(encoder, map)));
+
+    paint(map, 0, 0, 8, 8);
+    encode(encoder, map); // lost
+
+    paint(map, 30, 30, 8, 8);
+    ASSERT_FALSE(store.apply(encode(encoder, map)));
+    ASSERT_FALSE(store.valid());
+
+    // deltas are rejected until the next keyframe, even if they follow the rejected message
+    paint(map, 20, 0, 4, 4);
+    ASSERT_FALSE(store.apply(encode(encoder, map)));
+    ASSERT_FALSE(store.valid());
+
+    encoder.forceKeyframe();
+    paint(map, 0, 20, 4, 4);
+    TiledMap keyframe = encode(encoder, map);
+    ASSERT_TRUE(keyframe.keyframe);
+    ASSERT_TRUE(store.apply(keyframe));
+    ASSERT_TRUE(store.valid());
+    ASSERT_EQ(map.data, store.data());
+}
+
+TEST(TestTiledMap, wrongBaseVersion)
+{
+    TiledMapEncoder encoder(16, 0);
+    TiledMapStore store;
+
+    nav_msgs::OccupancyGrid map = createMap(32, 32);
+    paint(map, 0, 0, 16, 16);
+    ASSERT_TRUE(store.apply(encode(encoder, map)));
+
+    // a single changed cell in a busy tile is cheapest as xor delta
+    map.data[3 * 32 + 3] = 42;
+    TiledMap msg = encode(encoder, map);
+    ASSERT_EQ(1u, msg.tiles.size());
+    ASSERT_EQ(MapTile::ENCODING_DELTA_RLE, msg.tiles[0].encoding);
+
+    TiledMapStore store_copy = store;
+    ASSERT_TRUE(store_copy.apply(msg));
+    ASSERT_EQ(map.data, store_copy.data());
+
+    msg.tiles[0].base_version += 1;
+    ASSERT_FALSE(store.apply(msg));
+    ASSERT_FALSE(store.valid());
+}
+
+TEST(TestTiledMap, borderTiles)
+{
+    // 3 x 2 tiles, the last column is 5 cells wide and the last row 3 cells high
+    TiledMapEncoder encoder(16, 0);
+    TiledMapStore store;
+
+    nav_msgs::OccupancyGrid map = createMap(37, 19);
+    paint(map, 0, 0, 37, 19);
+
+    TiledMap msg = encode(encoder, map);
+    ASSERT_EQ(6u, msg.tiles.size());
+    ASSERT_TRUE(store.apply(msg));
+    ASSERT_EQ(map.data, store.data());
+
+    unsigned x0, y0, w, h;
+    store.tileRect(5, x0, y0, w, h);
+    ASSERT_EQ(32u, x0);
+    ASSERT_EQ(16u, y0);
+    ASSERT_EQ(5u, w);
+    ASSERT_EQ(3u, h);
+
+    // change only the corner cell
+    map.data[18 * 37 + 36] = 100;
+    msg = encode(encoder, map);
+    ASSERT_EQ(1u, msg.tiles.size());
+    ASSERT_EQ(5u, msg.tiles[0].index);
+    ASSERT_TRUE(store.apply(msg));
+    ASSERT_EQ(map.data, store.data());
+
+    // a raw border tile must have exactly the size of the clipped tile
+    map.data[17 * 37 + 35] = 100;
+    msg = encode(encoder, map);
+    ASSERT_EQ(1u, msg.tiles.size());
+    msg.tiles[0].encoding = MapTile::ENCODING_RAW;
+    msg.tiles[0].data.assign(16 * 16, 0);
+    ASSERT_FALSE(store.apply(msg));
+    ASSERT_FALSE(store.valid());
+}
+
+TEST(TestTiledMap, malformedRle)
+{
+    uint8_t data[8];
+
+    std::vector<uint8_t> rle;
+    tiled_map::encodeRle(reinterpret_cast<const uint8_t*>("aaabbbbc"), 8, rle);
+    ASSERT_TRUE(tiled_map::decodeRle(rle, data, 8));
+    ASSERT_EQ(0, std::memcmp(data, "aaabbbbc", 8));
+
+    // odd length
+    std::vector<uint8_t> odd(rle);
+    odd.push_back(1);
+    ASSERT_FALSE(tiled_map::decodeRle(odd, data, 8));
+
+    // too short and too long
+    ASSERT_FALSE(tiled_map::decodeRle(rle, data, 9));
+    ASSERT_FALSE(tiled_map::decodeRle(rle, data, 7));
+
+    // a malformed tile invalidates the store
+    TiledMapEncoder encoder(16, 0);
+    TiledMapStore store;
+    nav_msgs::OccupancyGrid map = createMap(16, 16);
+    ASSERT_TRUE(store.apply(encode(encoder, map)));
+
+    map.data[0] = 0;
+    TiledMap msg = encode(encoder, map);
+    ASSERT_EQ(1u, msg.tiles.size());
+    msg.tiles[0].encoding = MapTile::ENCODING_RLE;
+    msg.tiles[0].data.assign(3, 1);
+    ASSERT_FALSE(store.apply(msg));
+    ASSERT_FALSE(store.valid());
+}
+
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -17,11 +17,30 @@
 
 using namespace lib_path;
 
+namespace
+{
+/// Map data
+/// use_unknown:  -1: unknown -> 0,  0:100 probabilities -> 1 - 100
+/// otherwise:    -1: unknown -> -1, 0:100 probabilities -> 0 - 100
+void convertMapCells(const int8_t* src, uint8_t* dst, std::size_t n, bool use_unknown)
+{
+    if(use_unknown) {
+        for(std::size_t i = 0; i < n; ++i) {
+            dst[i] = std::min(100, src[i] + 1);
+        }
+    } else {
+        for(std::size_t i = 0; i < n; ++i) {
+            dst[i] = src[i];
+        }
+    }
+}
+}
+
 Planner::Planner()
     : nh_priv("~"),
       is_cost_map_(false),
       server_(nh, "plan_path", boost::bind(&Planner::execute, this, _1), false),
-      map_info(NULL), map_rotation_yaw_(0.0), thread_running(false)
+      map_info(NULL), map_rotation_yaw_(0.0), tiled_map_use_unknown_(true), thread_running(false)
 {
     std::string target_topic = "/goal";
     nh_priv.param("target_topic", target_topic, target_topic);
@@ -32,7 +51,17 @@ Planner::Planner()
     nh_priv.param("use_map_topic", use_map_topic_, false);
     nh_priv.param("use_map_service", use_map_service_, !use_map_topic_);
 
-    if(use_map_topic_) {
+    nh_priv.param("use_tiled_map", use_tiled_map_, false);
+
+    if(use_map_topic_ && use_tiled_map_) {
+        std::string map_topic = nh_priv.param("tiled_map_topic", std::string("map_tiles"));
+        // every message has to be applied, a missed message invalidates the map until the next keyframe
+        map_sub = nh.subscribe<path_msgs::TiledMap>
+                (map_topic, 10, boost::bind(&Planner::updateTiledMapCallback, this, _1));
+
+        ROS_INFO_STREAM("using tiled map topic " << map_topic);
+
+    } else if(use_map_topic_) {
         std::string map_topic = nh_priv.param("map_topic", std::string("map"));
         map_sub = nh.subscribe<nav_msgs::OccupancyGrid>
                 (map_topic, 1, boost::bind(&Planner::updateMapCallback, this, _1));
@@ -152,18 +181,19 @@ void Planner::updateMapCallback (const nav_msgs::OccupancyGridConstPtr &map)
     pending_map = map;
 }
 
-void Planner::updateMap (const nav_msgs::OccupancyGrid &map, bool is_cost_map)
+void Planner::updateTiledMapCallback (const path_msgs::TiledMapConstPtr &map)
 {
-    boost::lock_guard<boost::mutex> lock(map_mutex);
-
-    is_cost_map_ = is_cost_map;
-
-    unsigned w = map.info.width;
-    unsigned h = map.info.height;
+    boost::lock_guard<boost::mutex> lock(tile_mutex_);
+    if(!tile_store_.apply(*map)) {
+        ROS_WARN_STREAM_THROTTLE(5.0, "tiled map is out of sync, waiting for the next keyframe");
+    }
+}
 
+bool Planner::prepareMapInfo (const nav_msgs::MapMetaData &info)
+{
     bool replace = map_info == NULL ||
-            map_info->getWidth() != w ||
-            map_info->getHeight() != h;
+            map_info->getWidth() != info.width ||
+            map_info->getHeight() != info.height;
 
     if(replace){
         if(map_info != NULL) {
@@ -172,19 +202,95 @@ void Planner::updateMap (const nav_msgs::OccupancyGrid &map, bool is_cost_map)
 
 
         if(use_collision_gridmap_) {
-            map_info = new lib_path::CollisionGridMap2d(map.info.width, map.info.height, tf::getYaw(map.info.origin.orientation), map.info.resolution, size_forward, size_backward, size_width);
+            map_info = new lib_path::CollisionGridMap2d(info.width, info.height, tf::getYaw(info.origin.orientation), info.resolution, size_forward, size_backward, size_width);
         } else {
             tf::Quaternion orientation;
-            tf::quaternionMsgToTF(map.info.origin.orientation, orientation);
+            tf::quaternionMsgToTF(info.origin.orientation, orientation);
             if(orientation != tf::Quaternion(0., 0., 0., 1.0)) {
                 map_rotation_yaw_ = tf::getYaw(orientation);
-                map_info = new lib_path::RotatedGridMap2d(map.info.width, map.info.height, map_rotation_yaw_, map.info.resolution);
+                map_info = new lib_path::RotatedGridMap2d(info.width, info.height, map_rotation_yaw_, info.resolution);
             } else {
-                map_info = new lib_path::SimpleGridMap2d(map.info.width, map.info.height, map.info.resolution);
+                map_info = new lib_path::SimpleGridMap2d(info.width, info.height, info.resolution);
             }
         }
     }
 
+    return replace;
+}
+
+bool Planner::updateMapFromTiles ()
+{
+    boost::lock_guard<boost::mutex> tile_lock(tile_mutex_);
+    boost::lock_guard<boost::mutex> lock(map_mutex);
+
+    if(!tile_store_.valid()) {
+        if(map_info == NULL || tiled_map_data_.size() != map_info->getWidth() * map_info->getHeight()) {
+            ROS_ERROR("no synchronized tiled map received yet");
+            return false;
+        }
+
+        // planning modified map_info (obstacles), reset it from the last synchronized map
+        ROS_WARN_STREAM_THROTTLE(5.0, "tiled map is out of sync, planning on the last synchronized map");
+        map_info->set(tiled_map_data_, map_info->getWidth(), map_info->getHeight());
+        return true;
+    }
+
+    is_cost_map_ = false;
+
+    const nav_msgs::MapMetaData& info = tile_store_.info();
+    unsigned w = info.width;
+    unsigned h = info.height;
+
+    bool replace = prepareMapInfo(info);
+
+    bool use_unknown;
+    nh_priv.param("use_unknown_cells", use_unknown, true);
+
+    const int8_t* src = tile_store_.data().data();
+
+    if(replace || tile_store_.geometryChanged() || tiled_map_data_.size() != w*h || use_unknown != tiled_map_use_unknown_) {
+        tiled_map_data_.resize(w*h);
+        convertMapCells(src, tiled_map_data_.data(), w*h, use_unknown);
+        tiled_map_use_unknown_ = use_unknown;
+
+    } else {
+        // only the tiles that changed since the last planning request
+        const std::vector<uint32_t>& changed = tile_store_.changedTiles();
+        for(std::vector<uint32_t>::const_iterator it = changed.begin(); it != changed.end(); ++it) {
+            unsigned x0, y0, tw, th;
+            tile_store_.tileRect(*it, x0, y0, tw, th);
+            for(unsigned y = y0; y < y0 + th; ++y) {
+                convertMapCells(src + y*w + x0, &tiled_map_data_[y*w + x0], tw, use_unknown);
+            }
+        }
+    }
+    tile_store_.clearChanged();
+
+    map_info->setLowerThreshold(50);
+    map_info->setUpperThreshold(70);
+    map_info->setNoInformationValue(-1);
+
+    // planning modifies map_info (obstacles), so it is reset from the converted map for every request
+    map_info->set(tiled_map_data_, w, h);
+    map_info->setOrigin(Point2d(info.origin.position.x, info.origin.position.y));
+
+    cost_map.header = tile_store_.header();
+    cost_map.info = info;
+
+    return true;
+}
+
+void Planner::updateMap (const nav_msgs::OccupancyGrid &map, bool is_cost_map)
+{
+    boost::lock_guard<boost::mutex> lock(map_mutex);
+
+    is_cost_map_ = is_cost_map;
+
+    unsigned w = map.info.width;
+    unsigned h = map.info.height;
+
+    prepareMapInfo(map.info);
+
     std::vector<uint8_t> data(w*h);
     int i = 0;
 
@@ -203,22 +309,7 @@ void Planner::updateMap (const nav_msgs::OccupancyGrid &map, bool is_cost_map)
         bool use_unknown;
         nh_priv.param("use_unknown_cells", use_unknown, true);
 
-        if(use_unknown) {
-            /// Map data
-            /// -1: unknown -> 0
-            /// 0:100 probabilities -> 1 - 100
-            for(std::vector<int8_t>::const_iterator it = map.data.begin(); it != map.data.end(); ++it) {
-                data[i++] = std::min(100, *it + 1);
-            }
-
-        } else {
-            /// Map data
-            /// -1: unknown -> -1
-            /// 0:100 probabilities -> 0 - 100
-            for(std::vector<int8_t>::const_iterator it = map.data.begin(); it != map.data.end(); ++it) {
-                data[i++] = *it;
-            }
-        }
+        convertMapCells(map.data.data(), data.data(), std::min<std::size_t>(map.data.size(), data.size()), use_unknown);
 
         map_info->setLowerThreshold(50);
         map_info->setUpperThreshold(70);
@@ -412,7 +503,12 @@ void Planner::execute(const path_msgs::PlanPathGoalConstPtr &goal)
 path_msgs::PathSequence Planner::findPath(const path_msgs::PlanPathGoal& request)
 {
     Stopwatch sw;
-    if(use_map_topic_ && pending_map) {
+    if(use_map_topic_ && use_tiled_map_) {
+        if(!updateMapFromTiles()) {
+            return path_msgs::PathSequence();
+        }
+
+    } else if(use_map_topic_ && pending_map) {
         updateMap(*pending_map, false);
 
     } else if(use_cost_map_service_) {
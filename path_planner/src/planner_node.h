@@ -5,6 +5,7 @@
 #include <cslibs_path_planning/common/SimpleGridMap2d.h>
 #include <cslibs_path_planning/common/Pose2d.h>
 #include <path_msgs/PlanPathAction.h>
+#include <path_msgs/tiled_map.h>
 
 /// SYSTEM
 #include <ros/ros.h>
@@ -38,6 +39,12 @@ public:
      */
     void updateMapCallback(const nav_msgs::OccupancyGridConstPtr &map);
 
+    /**
+     * @brief updateTiledMapCallback is called when using the tiled map topic, only the transported tiles are decoded
+     * @param map
+     */
+    void updateTiledMapCallback(const path_msgs::TiledMapConstPtr &map);
+
     /**
      * @brief updateGoalCallback is called when a new goal state is requested
      * @param goal
@@ -52,6 +59,20 @@ protected:
      */
     virtual void updateMap(const nav_msgs::OccupancyGrid &map, bool is_cost_map);
 
+    /**
+     * @brief updateMapFromTiles updates the map from the tile store, only the tiles changed since the last update are converted
+     *
+     * While the tile store is out of sync, map_info is reset from the last synchronized map.
+     * @return false, if no synchronized map was received yet
+     */
+    bool updateMapFromTiles();
+
+    /**
+     * @brief prepareMapInfo (re)creates map_info if the map size changed
+     * @return true, if map_info was replaced
+     */
+    bool prepareMapInfo(const nav_msgs::MapMetaData &info);
+
     /**
      * @brief execute ActionLib interface
      * @param goal
@@ -181,6 +202,7 @@ protected:
     bool is_cost_map_;
 
     bool use_map_topic_;
+    bool use_tiled_map_;
     bool use_cost_map_;
     bool use_cost_map_service_;
     bool use_map_service_;
@@ -233,6 +255,11 @@ protected:
 
     nav_msgs::OccupancyGridConstPtr pending_map;
 
+    path_msgs::TiledMapStore tile_store_;
+    std::vector<uint8_t> tiled_map_data_;
+    bool tiled_map_use_unknown_;
+    boost::mutex tile_mutex_;
+
     nav_msgs::OccupancyGrid cost_map;
     std::vector<double> gradient_x;
     std::vector<double> gradient_y;
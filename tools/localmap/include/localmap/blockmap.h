@@ -11,6 +11,14 @@ class BlockMap
 {
 public:
 
+    BlockMap():
+        useRingBuffer_(false),
+        baseLinkSize_(0),
+        ringOffset_(0,0),
+        mapVersion_(1),
+        contiguousVersion_(0)
+    {
+    }
 
     /**
      * @brief Tests if recentering is required and performs it if required
@@ -29,9 +37,9 @@ public:
      */
     bool TestSafe(const cv::Point2f &pos);
     /**
-     * @brief transforms the current map into base link coordinate system
+     * @brief transforms the robot centered window of the current map into base link coordinate system and stores it in baseLinkMap_ as outputType (CV_32F or CV_16U)
      */
-    void Transform2BaseLink(const cv::Point2d &pos, const double angle);
+    void Transform2BaseLink(const cv::Point2d &pos, const double angle, const int outputType = CV_32F);
     /**
      * @brief Converts the world to map coordinates
      */
@@ -73,6 +81,48 @@ public:
      */
     void SetPose(cv::Point3f normal, cv::Point3f pos);
 
+    /**
+     * @brief Storage row of map row y, in ring buffer mode the columns have to be wrapped with WrapX()
+     */
+    inline float* GetRow(int y)
+    {
+        y += ringOffset_.y;
+        return currentMap_.ptr<float>(y >= mapResolution_ ? y-mapResolution_ : y);
+    }
+
+    /**
+     * @brief Storage column of map column x
+     */
+    inline int WrapX(int x) const
+    {
+        x += ringOffset_.x;
+        return x >= mapResolution_ ? x-mapResolution_ : x;
+    }
+
+    /**
+     * @brief Splits a rectangle in map coordinates into at most 4 contiguous rectangles of the storage, returns the number of parts
+     */
+    int GetStorageRects(const cv::Rect &mapRect, cv::Rect storageRects[4], cv::Rect mapRects[4]) const;
+
+    /**
+     * @brief Returns the map with the origin in the top left corner. In ring buffer mode the map is copied into a contiguous image if it changed since the last call
+     */
+    const cv::Mat& GetMap();
+
+    /**
+     * @brief Deep copy of the map into target, the buffers of target are reused
+     */
+    void CopyTo(BlockMap &target) const;
+
+    /**
+     * @brief Has to be called after currentMap_ was modified through GetRow(), may be called concurrently
+     */
+    inline void SetModified()
+    {
+        __atomic_add_fetch(&mapVersion_,1,__ATOMIC_RELAXED);
+    }
+
+
     cv::Point2f center_;
     cv::Point2f origin_;
     int mapResolution_;
@@ -82,7 +132,13 @@ public:
     float mapNotVisibleLevel_;
     float mapBaseLevel_;
     float heightScale_;
+    /// Recentering only moves the ring offset and clears the newly exposed blocks instead of shifting the map
+    bool useRingBuffer_;
+
+    /// size of the base link window in pixels, <= 0 uses the full map
+    int baseLinkSize_;
 
+    /// Map storage, in ring buffer mode map pixel x,y is stored at WrapX(x),y+ringOffset_.y
     cv::Mat currentMap_;
     cv::Mat baseLinkMap_;
 
@@ -101,8 +157,31 @@ private:
     float blockStep_;
     int safeBlocks_;
 
+    /// shifted map in normal mode, contiguous copy of the map in ring buffer mode
     cv::Mat tempMap_;
 
+    cv::Point2i ringOffset_;
+
+    /// incremented on every modification, tempMap_ is only updated if its version is outdated
+    unsigned int mapVersion_;
+    unsigned int contiguousVersion_;
+
+    /**
+     * @brief Set map rectangle to val, wraps around in ring buffer mode
+     */
+    void SetRectTo(const cv::Rect &mapRect, float val);
+
+    /**
+     * @brief Moves the ring offset by shiftPixels and clears the map strips that became visible
+     */
+    void ShiftRing(const cv::Point2i &shiftPixels);
+
+    /**
+     * @brief Nearest neighbour warp of the map with the inverse affine transform, converts to T and sets pixels outside of the map to 0
+     */
+    template <typename T>
+    void WarpMap(const cv::Mat &invAffine, cv::Mat &result);
+
 };
 
 
@@ -10,6 +10,11 @@
 #include "sensor_msgs/CameraInfo.h"
 
 #include <tf/transform_listener.h>
+#include <ros/callback_queue.h>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <boost/thread/shared_mutex.hpp>
 
 #include "rgbd2dem2.h"
 #include <tf/transform_broadcaster.h>
@@ -46,12 +51,23 @@ public:
 
     DE_Localmap();
 
-    void imageCallback(const sensor_msgs::ImageConstPtr& depth);
+    /**
+     * @brief Projects the depth image of camera cameraIdx into the map, callbacks of different cameras run concurrently
+     */
+    void imageCallback(const sensor_msgs::ImageConstPtr& depth, const int cameraIdx);
     /**
      * @brief Convert a point from world to map coordinates
      */
     cv::Point2f ConvertPoint(cv::Point2f &p);
-    void ci_callback(const sensor_msgs::CameraInfoConstPtr& info);
+    void ci_callback(const sensor_msgs::CameraInfoConstPtr& info, const int cameraIdx);
+    /**
+     * @brief Publishes a snapshot of the latest map, runs on the publish thread
+     */
+    void publishTimerCallback(const ros::TimerEvent &event);
+    /**
+     * @brief Publishes the elevation image, point cloud and assign image of map
+     */
+    void PublishMaps(BlockMap &map, const cv::Mat &assignImage, const std_msgs::Header &header, const cv::Point2d &robotPos, const double robotYaw);
     /**
      * @brief Lookup a tf transform
      */
@@ -59,53 +75,68 @@ public:
     /**
      * @brief Setup up transform matrices
      */
-    void SetupMatrices(tf::Transform &transform);
+    void SetupMatrices(ZImageProc &proc, tf::Transform &transform);
 
     /**
      * @brief Updates the local map with the current depth images, assigning the current height for all valid pixels in the current depth image
      */
-    void UpdateLocalMapOverwrite(cv::Mat &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax);
+    void UpdateLocalMapOverwrite(BlockMap &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax);
     /**
      * @brief Updates the local map with the current depth images, assigning the maximum of local map and current height values
      */
-    void UpdateLocalMapMax(cv::Mat &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax);
+    void UpdateLocalMapMax(BlockMap &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax);
+
+    int GetNumCameras() const {return cameras_.size();}
 
 
 private:
-    ros::NodeHandle nodeG_;
-    ros::NodeHandle nodeP_;
 
+    /**
+     * @brief Input state of one depth camera
+     */
+    struct CameraInput
+    {
+        std::string name;
 
+        ros::Subscriber depthSub;
+        ros::Subscriber cameraInfoSub;
 
-    ros::Subscriber depthSub_;
+        sensor_msgs::CameraInfo camInfo;
+        std::atomic<bool> hasCamInfo;
+        bool hasCam2Base;
+        /// cached, the camera is assumed to be fixed on the robot
+        tf::StampedTransform cam2Base;
 
-    ros::Subscriber cameraInfoSub_;
+        ZImageProc proc;
+        cv::Mat zImg,assign;
+
+        int numRegistered;
+        double totalRegisterTime;
+    };
+
+    ros::NodeHandle nodeG_;
+    ros::NodeHandle nodeP_;
+
+    std::vector<std::shared_ptr<CameraInput> > cameras_;
 
     ros::Publisher zImagePub_;
     ros::Publisher assignImagePub_;
 #ifdef ELEVATION_CLOUD_DEBUG
     ros::Publisher imageCloud_pub_;
     ros::Publisher debugImagePub_;
+    /// reused between publishes, only written by PublishMaps
+    sensor_msgs::PointCloud2 cloudMsg_;
+    int cloudStride_;
 
 #endif
 
     tf::TransformListener tf_listener;
 
 
-    sensor_msgs::CameraInfo camInfo_;
-    bool hasCamInfo_;
-    bool hasCam2Base_;
-
     std::string baseFrame_;
     std::string mapFrame_;
     std::string localMapFrame_;
 
-    tf::StampedTransform cam2Base_;
-
-
-    int numRegistered_;
-    double totalRegisterTime_;
-
 
     int mapResolution_;
     float mapSize_;
@@ -132,14 +163,35 @@ private:
 
     double mapScale_,mapOffset_, mapZeroLevel_,mapNotVisibleLevel_;
     float mapZeroLevelf_;
+    /// settings shared by the processors of all cameras
     ZImageProc proc_;
 
-    cv::Mat cZImg_,cAssign_;
     //CVAlignedMat::ptr acZImg_,acAssign_;
     BlockMap blockMap_;
 
     bool initBlockMap_;
 
+    /// rate of the decoupled publish thread, <= 0 publishes after every depth image
+    double publishRate_;
+    /// shared while the cameras project into blockMap_, exclusive for recentering and the snapshots that are published
+    boost::shared_mutex mapMutex_;
+    /// protects the publish state and the snapshot publishMap_, locked before mapMutex_
+    std::mutex publishMutex_;
+    BlockMap publishMap_;
+    cv::Mat publishAssign_;
+    std_msgs::Header publishHeader_;
+    cv::Point2d publishRobotPos_;
+    double publishRobotYaw_;
+    /// camera of the latest depth image, the publish thread only publishes the assign image of this camera
+    int publishCamera_;
+    unsigned int numIngested_;
+    unsigned int numPublished_;
+
+    ros::NodeHandle publishNode_;
+    ros::CallbackQueue publishQueue_;
+    ros::Timer publishTimer_;
+    std::shared_ptr<ros::AsyncSpinner> publishSpinner_;
+
 };
 
 
@@ -3,7 +3,11 @@
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+#include <algorithm>
 #include "utils_depth_image.h"
+#include "zimage_kernels.h"
+#include <model_based_planner/workerpool.h>
 
 
 /// Transposing the image can speed up processing, but also coordinates have to be adjusted accordingly
@@ -25,16 +29,30 @@ public:
     float minYVal_;
     float minAssignValue_;
     float minDepthThreshold_;
+    /// meters per unit of raw CV_16U depth images
+    float depthScale16U_;
 
 
-    ZImageProc()
+    ZImageProc():
+        numThreads_(1)
     {
         minDepthThreshold_ = 0.4f;
         minAssignValue_ = 0.5;
+        depthScale16U_ = 0.001f;
 
 
     }
 
+    /**
+     * @brief Number of threads for the projection including the calling thread, <= 0 uses one thread per core
+     */
+    void SetNumThreads(int numThreads)
+    {
+        workerPool_ = WorkerPool::Create(numThreads);
+        numThreads_ = workerPool_->GetNumThreads();
+        if (numThreads_ < 2) workerPool_.reset();
+    }
+
 
     /**
      * @brief Set camera parameters
@@ -56,479 +74,371 @@ public:
 
 
     /**
-     * @brief Uses an inverse bilinear interpolation to interpolate the z values of neighbouring pixels (without min max calculation)
+     * @brief Uses the mean over all nearest neighbour pixels
      */
-    void ProcessDepthImage(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, const float scale, const float baseLevel, const float zeroLevel, const float minVisX = 0.0f)
+    void ProcessDepthImageNN(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, cv::Vec4i &minMax, const float scale, const float baseLevel, const float zeroLevel, const float minVisX = 0.0f)
     {
+        ProcessParallel(inD,zImg,assignVal,minMax,SM_NN);
+    }
 
-        int resolutionX = zImg.cols;
-        int resolutionY = zImg.rows;
-
-        float resolutionXf_ = (float) (resolutionX-1);
-        float resolutionYf_ = (float) (resolutionY-1);
-
-
-
-        UtilsDepthImage::SetToZero(zImg);//.setTo(0);
-        UtilsDepthImage::SetToZero(assignVal);//.setTo(0);
-
-        float *zImgRes = zImg.ptr<float>();
-        float *assignRes = assignVal.ptr<float>();
-
-        float posX,posY,posZ;
-        float flposX,flposY;
-
-        float wtl,wbl,wtr,wbr;
-
-        float wl,wr,wb,wt;
-        int idxFTL,idxFTLY,stepF = assignVal.cols;
-
-
-        int xl,yl;
+    /**
+     * @brief Only uses the nearest neighbour with highest z-value
+     */
+    void ProcessDepthImageMaxNN(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, cv::Vec4i &minMax, const float scale, const float baseLevel, const float zeroLevel, const float minVisX = 0.0f)
+    {
+        ProcessParallel(inD,zImg,assignVal,minMax,SM_MAX);
+    }
 
-        const float *ptrD;
+    /**
+     * @brief Uses an inverse bilinear interpolation to interpolate the z values of neighbouring pixels
+     */
+    void ProcessDepthImage(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, cv::Vec4i &minMax, const float scale, const float baseLevel, const float zeroLevel, const float minVisX = 0.0f)
+    {
+        ProcessParallel(inD,zImg,assignVal,minMax,SM_INTERP);
+    }
 
-        float tx,ty,tz;
 
-        float rx,ry,rz;
+private:
 
-        float oz;
+    enum SPLAT_MODE { SM_INTERP, SM_NN, SM_MAX};
 
-        for  (yl = 0; yl < inD.rows;++yl)
+    /**
+     * @brief Elevation image and projection buffers of one row band
+     */
+    struct BandBuffer
+    {
+        BandBuffer():
+            fillValue(0)
         {
-            ptrD = inD.ptr<float>(yl);
-
-            for  (xl = 0; xl < inD.cols;++xl)
-            {
-                oz = ptrD[xl];
-                tx = ((float(xl)-cx)*fxi)*oz;
-                ty = ((float(yl)-cy)*fyi)*oz;
-                tz = oz;
-
-                rx = tx*r11+ty*r12+tz*r13+t1;
-                ry = tx*r21+ty*r22+tz*r23+t2;
-                rz = tx*r31+ty*r32+tz*r33+t3;
-
-                if (std::isnan(tx)) continue;
-
-
-#ifndef TRANSPOSE_TRANSFORM
-
-                // normal
-
-                posX = (rx-minXVal_) * pixelResolution_;
-                posY = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
-
-#else
-
-                // Transposed
-                posY = (rx-minXVal_) * pixelResolution_;
-                posX = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
-#endif
-
-                flposX = floor(posX);
-                flposY = floor(posY);
-
-                if (flposX < minVisX) continue;
-                if (flposY < 0) continue;
-                if (flposX >= resolutionXf_) continue;
-                if (flposY >= resolutionYf_) continue;
-
-                wr = posX-flposX;
-                wl = 1.0f-wr;
-                wb = posY-flposY;
-                wt = 1.0f-wb;
-
-                wtl = wl*wt;
-                wtr = wr*wt;
-                wbl = wl*wb;
-                wbr = wr*wb;
-
-                idxFTL = (int)flposY*stepF+ (int)flposX;
-                idxFTLY = idxFTL+stepF;
-
-
-
-                zImgRes[idxFTL  ] += posZ*wtl;
-                assignRes[idxFTL] += wtl;
-
-                zImgRes[idxFTL+1  ] += posZ*wtr;
-                assignRes[idxFTL+1] += wtr;
+            touched = cv::Vec4i(0,0,-1,-1);
+        }
 
-                zImgRes[idxFTLY  ] += posZ*wbl;
-                assignRes[idxFTLY] += wbl;
+        cv::Mat zImg;
+        cv::Mat assign;
+        float fillValue;
+        /// inclusive rectangle x0,y0,x1,y1 that was written since the last reset
+        cv::Vec4i touched;
+        cv::Vec4i minMax;
+        std::vector<float> posX,posY,posZ;
+    };
 
-                zImgRes[idxFTLY+1  ] += posZ*wbr;
-                assignRes[idxFTLY+1] += wbr;
+    int numThreads_;
+    WorkerPool::Ptr workerPool_;
+    std::vector<BandBuffer> bands_;
+    std::vector<float> colFactor_;
 
-            }
 
+    /**
+     * @brief Prepares the band image with the size and type of zImg, only resets the rectangle written in the last frame
+     */
+    static void ResetBand(BandBuffer &band, const cv::Mat &zImg, const float fillValue)
+    {
+        if (band.zImg.size() != zImg.size() || band.fillValue != fillValue)
+        {
+            band.zImg.create(zImg.size(),CV_32F);
+            band.assign.create(zImg.size(),CV_32F);
+            band.zImg.setTo(fillValue);
+            UtilsDepthImage::SetToZero(band.assign);
+            band.fillValue = fillValue;
         }
-
-
-        for (yl = 0; yl < resolutionY;++yl)
+        else if (band.touched[2] >= band.touched[0] && band.touched[3] >= band.touched[1])
         {
-            zImgRes = zImg.ptr<float>(yl);
-            assignRes = assignVal.ptr<float>(yl);
-
-            for (xl = 0; xl < resolutionX;++xl)
-            {
-                if (assignRes[xl] >= minAssignValue_)
-                {
-
-                    zImgRes[xl] = (zImgRes[xl]/ assignRes[xl])*scale+baseLevel;
-
-                }
-                else
-                {
-                    zImgRes[xl] = zeroLevel;
-
-                }
-
-
-            }
+            const cv::Rect rect(band.touched[0],band.touched[1],band.touched[2]-band.touched[0]+1,band.touched[3]-band.touched[1]+1);
+            band.zImg(rect).setTo(fillValue);
+            band.assign(rect).setTo(0);
         }
 
-
-
-
+        band.touched = cv::Vec4i(0,0,-1,-1);
     }
 
-
     /**
-     * @brief Uses the mean over all nearest neighbour pixels
+     * @brief Rectangle that may be written for the given minMax, including the right and bottom neighbours of the interpolation
      */
-    void ProcessDepthImageNN(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, cv::Vec4i &minMax, const float scale, const float baseLevel, const float zeroLevel, const float minVisX = 0.0f)
+    static cv::Vec4i GetTouched(const cv::Vec4i &minMax, const cv::Size &size)
     {
-        int resolutionX = zImg.cols-1;
-        int resolutionY = zImg.rows-1;
-
-        minMax[0] = resolutionX;
-        minMax[1] = resolutionY;
-        minMax[2] = 0;
-        minMax[3] = 0;
-
-
-        UtilsDepthImage::SetToZero(zImg);//.setTo(0);
-        UtilsDepthImage::SetToZero(assignVal);//.setTo(0);
-
-
-        float *zImgRes = zImg.ptr<float>();
-        float *assignRes = assignVal.ptr<float>();
-
-        float posX,posY,posZ;
-
-        int idxFTL,step = assignVal.cols;
-
-        int xl,yl;
-
-        const float *ptrD;
-
-        float tx,ty,tz;
-
-        float rx,ry,rz;
-
-        float oz;
-        int flPosXi;
-        int flPosYi;
-
-
-        for  (yl = 0; yl < inD.rows;++yl)
-        {
-            ptrD = inD.ptr<float>(yl);
-
-            for  (xl = 0; xl < inD.cols;++xl)
-            {
-                oz = ptrD[xl];
-                if (oz < minDepthThreshold_) continue;
-
-                tx = ((float(xl)-cx)*fxi)*oz;
-                ty = ((float(yl)-cy)*fyi)*oz;
-                tz = oz;
-
-                rx = tx*r11+ty*r12+tz*r13+t1;
-                ry = tx*r21+ty*r22+tz*r23+t2;
-                rz = tx*r31+ty*r32+tz*r33+t3;
+        if (minMax[2] <= minMax[0] || minMax[3] <= minMax[1]) return cv::Vec4i(0,0,-1,-1);
+        return cv::Vec4i(minMax[0],minMax[1],std::min(minMax[2],size.width-1),std::min(minMax[3],size.height-1));
+    }
 
-                if (std::isnan(tx)) continue;
+    /**
+     * @brief Transform of depth image row yl into elevation image coordinates
+     */
+    inline ZImageKernels::RowTransform GetRowTransform(const int yl, const float depthScale) const
+    {
+        const float by = (float(yl)-cy)*fyi;
 
+        ZImageKernels::RowTransform t;
+        t.colFactor = &colFactor_[0];
+        t.depthScale = depthScale;
+        t.minDepth = minDepthThreshold_;
 
 #ifndef TRANSPOSE_TRANSFORM
-
-                // normal
-
-                posX = (rx-minXVal_) * pixelResolution_;
-                posY = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
-
+        t.ax = r11*pixelResolution_; t.bx = (by*r12+r13)*pixelResolution_; t.cx = (t1-minXVal_)*pixelResolution_;
+        t.ay = r21*pixelResolution_; t.by = (by*r22+r23)*pixelResolution_; t.cy = (t2-minYVal_)*pixelResolution_;
 #else
-
-                // Transposed
-                posY = (rx-minXVal_) * pixelResolution_;
-                posX = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
+        t.ay = r11*pixelResolution_; t.by = (by*r12+r13)*pixelResolution_; t.cy = (t1-minXVal_)*pixelResolution_;
+        t.ax = r21*pixelResolution_; t.bx = (by*r22+r23)*pixelResolution_; t.cx = (t2-minYVal_)*pixelResolution_;
 #endif
+        t.az = r31; t.bz = by*r32+r33; t.cz = t3;
 
-
-                flPosXi = (int)round(posX);
-                flPosYi = (int)round(posY);
-
-                if (flPosXi < 0) continue;
-                if (flPosYi < 0) continue;
-                if (flPosXi > resolutionX) continue;
-                if (flPosYi > resolutionY) continue;
-                if (flPosXi < minMax[0] ) minMax[0] = flPosXi;
-                if (flPosXi+1 > minMax[2] ) minMax[2] = flPosXi+1;
-                if (flPosYi < minMax[1] ) minMax[1] = flPosYi;
-                if (flPosYi+1 > minMax[3] ) minMax[3] = flPosYi+1;
-
-                idxFTL = flPosYi*step+ flPosXi;
-                zImgRes[idxFTL  ] += posZ;
-                assignRes[idxFTL] ++;
-
-
-            }
-
-        }
-
-
-
+        return t;
     }
 
     /**
-     * @brief Only uses the nearest neighbour with highest z-value
+     * @brief Projects the depth image rows startRow..endRow-1 into zImg and assignVal
      */
-    void ProcessDepthImageMaxNN(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, cv::Vec4i &minMax, const float scale, const float baseLevel, const float zeroLevel, const float minVisX = 0.0f)
+    void ProcessBand(const cv::Mat &inD, const int startRow, const int endRow, cv::Mat &zImg, cv::Mat &assignVal, BandBuffer &band, const SPLAT_MODE mode)
     {
-        int resolutionX = zImg.cols-1;
-        int resolutionY = zImg.rows-1;
-
-
-        minMax[0] = resolutionX;
-        minMax[1] = resolutionY;
+        const ZImageKernels::Kernels &kernels = ZImageKernels::SelectKernels();
+        const bool is16U = inD.type() == CV_16U;
+        const ZImageKernels::ProjectRowFunc projectRow = is16U ? kernels.projectRow16U : kernels.projectRow32F;
+        const float depthScale = is16U ? depthScale16U_ : 1.0f;
+
+        const int cols = inD.cols;
+        band.posX.resize(cols);
+        band.posY.resize(cols);
+        band.posZ.resize(cols);
+
+        cv::Vec4i &minMax = band.minMax;
+        minMax[0] = zImg.cols-1;
+        minMax[1] = zImg.rows-1;
         minMax[2] = 0;
         minMax[3] = 0;
 
+        for (int yl = startRow; yl < endRow;++yl)
+        {
+            const ZImageKernels::RowTransform t = GetRowTransform(yl,depthScale);
+            projectRow(inD.ptr(yl),cols,t,&band.posX[0],&band.posY[0],&band.posZ[0]);
+
+            switch (mode) {
+            case SM_NN: SplatNN(band,cols,zImg,assignVal); break;
+            case SM_MAX: SplatMaxNN(band,cols,zImg,assignVal); break;
+            default: SplatInterp(band,cols,zImg,assignVal); break;
+            }
+        }
 
+        band.touched = GetTouched(minMax,zImg.size());
+    }
 
-        zImg.setTo(-10);
-        UtilsDepthImage::SetToZero(assignVal);//.setTo(0);
+    static inline void UpdateMinMax(cv::Vec4i &minMax, const int flPosXi, const int flPosYi)
+    {
+        if (flPosXi < minMax[0] ) minMax[0] = flPosXi;
+        if (flPosXi+1 > minMax[2] ) minMax[2] = flPosXi+1;
+        if (flPosYi < minMax[1] ) minMax[1] = flPosYi;
+        if (flPosYi+1 > minMax[3] ) minMax[3] = flPosYi+1;
+    }
 
+    static void SplatNN(BandBuffer &band, const int cols, cv::Mat &zImg, cv::Mat &assignVal)
+    {
+        const int resolutionX = zImg.cols-1;
+        const int resolutionY = zImg.rows-1;
+        const int step = assignVal.cols;
 
         float *zImgRes = zImg.ptr<float>();
         float *assignRes = assignVal.ptr<float>();
 
-        float posX,posY,posZ;
-
-        int idxFTL,step = assignVal.cols;
-
-
-        int xl,yl;
+        for (int xl = 0; xl < cols;++xl)
+        {
+            const int flPosXi = (int)round(band.posX[xl]);
+            const int flPosYi = (int)round(band.posY[xl]);
+
+            if (flPosXi < 0) continue;
+            if (flPosYi < 0) continue;
+            if (flPosXi > resolutionX) continue;
+            if (flPosYi > resolutionY) continue;
+            UpdateMinMax(band.minMax,flPosXi,flPosYi);
+
+            const int idxFTL = flPosYi*step+ flPosXi;
+            zImgRes[idxFTL  ] += band.posZ[xl];
+            assignRes[idxFTL] ++;
+        }
+    }
 
-        const float *ptrD;
+    static void SplatMaxNN(BandBuffer &band, const int cols, cv::Mat &zImg, cv::Mat &assignVal)
+    {
+        const int resolutionX = zImg.cols-1;
+        const int resolutionY = zImg.rows-1;
+        const int step = assignVal.cols;
 
-        float tx,ty,tz;
+        float *zImgRes = zImg.ptr<float>();
+        float *assignRes = assignVal.ptr<float>();
 
-        float rx,ry,rz;
+        for (int xl = 0; xl < cols;++xl)
+        {
+            const int flPosXi = (int)round(band.posX[xl]);
+            const int flPosYi = (int)round(band.posY[xl]);
+
+            if (flPosXi < 0) continue;
+            if (flPosYi < 0) continue;
+            if (flPosXi > resolutionX) continue;
+            if (flPosYi > resolutionY) continue;
+            UpdateMinMax(band.minMax,flPosXi,flPosYi);
+
+            const int idxFTL = flPosYi*step+ flPosXi;
+            zImgRes[idxFTL  ] = std::max(band.posZ[xl],zImgRes[idxFTL  ]);
+            assignRes[idxFTL]  = 1;
+        }
+    }
 
-        float oz;
-        int flPosXi;
-        int flPosYi;
+    static void SplatInterp(BandBuffer &band, const int cols, cv::Mat &zImg, cv::Mat &assignVal)
+    {
+        const int resolutionX = zImg.cols-1;
+        const int resolutionY = zImg.rows-1;
+        const int step = assignVal.cols;
 
+        float *zImgRes = zImg.ptr<float>();
+        float *assignRes = assignVal.ptr<float>();
 
-        for  (yl = 0; yl < inD.rows;++yl)
+        for (int xl = 0; xl < cols;++xl)
         {
-            ptrD = inD.ptr<float>(yl);
-
-            for  (xl = 0; xl < inD.cols;++xl)
-            {
-                oz = ptrD[xl];
-                if (oz < minDepthThreshold_) continue;
+            const float posX = band.posX[xl];
+            const float posY = band.posY[xl];
+            const float posZ = band.posZ[xl];
 
-                tx = ((float(xl)-cx)*fxi)*oz;
-                ty = ((float(yl)-cy)*fyi)*oz;
-                tz = oz;
+            const float flposX = floor(posX);
+            const float flposY = floor(posY);
 
-                rx = tx*r11+ty*r12+tz*r13+t1;
-                ry = tx*r21+ty*r22+tz*r23+t2;
-                rz = tx*r31+ty*r32+tz*r33+t3;
+            const int flPosXi = (int)flposX;
+            const int flPosYi = (int)flposY;
 
-                if (std::isnan(tx)) continue;
+            if (flPosXi < 0) continue;
+            if (flPosYi < 0) continue;
+            if (flPosXi >= resolutionX) continue;
+            if (flPosYi >= resolutionY) continue;
 
+            const float wr = posX-flposX;
+            const float wl = 1.0f-wr;
+            const float wb = posY-flposY;
+            const float wt = 1.0f-wb;
 
-#ifndef TRANSPOSE_TRANSFORM
-
-                // normal
+            const float wtl = wl*wt;
+            const float wtr = wr*wt;
+            const float wbl = wl*wb;
+            const float wbr = wr*wb;
 
-                posX = (rx-minXVal_) * pixelResolution_;
-                posY = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
+            const int idxFTL = flPosYi*step+ flPosXi;
+            const int idxFTLY = idxFTL+step;
 
-#else
+            UpdateMinMax(band.minMax,flPosXi,flPosYi);
 
-                // Transposed
-                posY = (rx-minXVal_) * pixelResolution_;
-                posX = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
-#endif
+            zImgRes[idxFTL  ] += posZ*wtl;
+            assignRes[idxFTL] += wtl;
 
+            zImgRes[idxFTL+1  ] += posZ*wtr;
+            assignRes[idxFTL+1] += wtr;
 
-                flPosXi = (int)round(posX);
-                flPosYi = (int)round(posY);
+            zImgRes[idxFTLY  ] += posZ*wbl;
+            assignRes[idxFTLY] += wbl;
 
-                if (flPosXi < 0) continue;
-                if (flPosYi < 0) continue;
-                if (flPosXi > resolutionX) continue;
-                if (flPosYi > resolutionY) continue;
-                if (flPosXi < minMax[0] ) minMax[0] = flPosXi;
-                if (flPosXi+1 > minMax[2] ) minMax[2] = flPosXi+1;
-                if (flPosYi < minMax[1] ) minMax[1] = flPosYi;
-                if (flPosYi+1 > minMax[3] ) minMax[3] = flPosYi+1;
+            zImgRes[idxFTLY+1  ] += posZ*wbr;
+            assignRes[idxFTLY+1] += wbr;
+        }
+    }
 
-                idxFTL = flPosYi*step+ flPosXi;
-                zImgRes[idxFTL  ] = std::max(posZ,zImgRes[idxFTL  ]);
-                assignRes[idxFTL]  = 1;
+    /**
+     * @brief Adds (mean modes) or takes the maximum (max mode) of the band images in the rows startRow..endRow-1 of rect
+     */
+    void MergeBands(const int numBands, const cv::Vec4i &rect, const int startRow, const int endRow, cv::Mat &zImg, cv::Mat &assignVal, const SPLAT_MODE mode)
+    {
+        for (int bl = 1; bl < numBands;++bl)
+        {
+            const BandBuffer &band = bands_[bl];
+            const int x0 = std::max(rect[0],band.touched[0]);
+            const int x1 = std::min(rect[2],band.touched[2]);
+            const int y0 = std::max(startRow,band.touched[1]);
+            const int y1 = std::min(endRow-1,band.touched[3]);
 
+            for (int yl = y0; yl <= y1;++yl)
+            {
+                const float *bZ = band.zImg.ptr<float>(yl);
+                const float *bA = band.assign.ptr<float>(yl);
+                float *zP = zImg.ptr<float>(yl);
+                float *aP = assignVal.ptr<float>(yl);
 
+                if (mode == SM_MAX)
+                {
+                    for (int xl = x0; xl <= x1;++xl)
+                    {
+                        zP[xl] = std::max(zP[xl],bZ[xl]);
+                        aP[xl] = std::max(aP[xl],bA[xl]);
+                    }
+                }
+                else
+                {
+                    for (int xl = x0; xl <= x1;++xl)
+                    {
+                        zP[xl] += bZ[xl];
+                        aP[xl] += bA[xl];
+                    }
+                }
             }
-
         }
-
-
     }
 
     /**
-     * @brief Uses an inverse bilinear interpolation to interpolate the z values of neighbouring pixels
+     * @brief Splits the depth image into row bands, each band is projected into its own elevation image by one thread and the results are merged
+     *
+     * The first band writes directly into zImg and assignVal. Accepts raw CV_16U depth (scaled by depthScale16U_) and CV_32F depth in meters.
      */
-    void ProcessDepthImage(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, cv::Vec4i &minMax, const float scale, const float baseLevel, const float zeroLevel, const float minVisX = 0.0f)
+    void ProcessParallel(const cv::Mat &inD, cv::Mat &zImg, cv::Mat &assignVal, cv::Vec4i &minMax, const SPLAT_MODE mode)
     {
-        int resolutionX = zImg.cols-1;
-        int resolutionY = zImg.rows-1;
-
-        minMax[0] = resolutionX;
-        minMax[1] = resolutionY;
-        minMax[2] = 0;
-        minMax[3] = 0;
-
-        UtilsDepthImage::SetToZero(zImg);//.setTo(0);
-        UtilsDepthImage::SetToZero(assignVal);//.setTo(0);
-
-
-        float *zImgRes = zImg.ptr<float>();
-        float *assignRes = assignVal.ptr<float>();
-
-        float posX,posY,posZ;
-        float flposX,flposY;
-
-        float wtl,wbl,wtr,wbr;
-
-        float wl,wr,wb,wt;
-        int idxFTL,idxFTLY,step = assignVal.cols;
-
-
-        int xl,yl;
-
-        const float *ptrD;
+        CV_Assert(inD.type() == CV_16U || inD.type() == CV_32F);
 
-        float tx,ty,tz;
+        const float fillValue = mode == SM_MAX ? -10.0f : 0.0f;
 
-        float rx,ry,rz;
+        zImg.setTo(fillValue);
+        UtilsDepthImage::SetToZero(assignVal);
 
-        float oz;
-        int flPosXi;
-        int flPosYi;
+        colFactor_.resize(inD.cols);
+        for (int xl = 0; xl < inD.cols;++xl) colFactor_[xl] = (float(xl)-cx)*fxi;
 
+        const int numBands = std::max(1,std::min(numThreads_,inD.rows));
+        if ((int)bands_.size() < numBands) bands_.resize(numBands);
 
-        for  (yl = 0; yl < inD.rows;++yl)
+        auto processBand = [&](int bl)
         {
-            ptrD = inD.ptr<float>(yl);
+            const int startRow = (inD.rows*bl)/numBands;
+            const int endRow = (inD.rows*(bl+1))/numBands;
 
-            for  (xl = 0; xl < inD.cols;++xl)
+            if (bl == 0)
             {
-                oz = ptrD[xl];
-                if (oz < minDepthThreshold_) continue;
-
-                tx = ((float(xl)-cx)*fxi)*oz;
-                ty = ((float(yl)-cy)*fyi)*oz;
-                tz = oz;
-
-                rx = tx*r11+ty*r12+tz*r13+t1;
-                ry = tx*r21+ty*r22+tz*r23+t2;
-                rz = tx*r31+ty*r32+tz*r33+t3;
-
-                if (std::isnan(tx)) continue;
-
-
-
-#ifndef TRANSPOSE_TRANSFORM
-
-                // normal
-                posX = (rx-minXVal_) * pixelResolution_;
-                posY = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
-
-#else
-
-                // Transposed
-                posY = (rx-minXVal_) * pixelResolution_;
-                posX = (ry-minYVal_) * pixelResolution_;
-                posZ = rz;
-#endif
-
-                flposX = floor(posX);
-                flposY = floor(posY);
-
-                wr = posX-flposX;
-                wl = 1.0f-wr;
-                wb = posY-flposY;
-                wt = 1.0f-wb;
-
-                wtl = wl*wt;
-                wtr = wr*wt;
-                wbl = wl*wb;
-                wbr = wr*wb;
-
-                flPosXi = (int)flposX;
-                flPosYi = (int)flposY;
-
-                if (flPosXi < 0) continue;
-                if (flPosYi < 0) continue;
-                if (flPosXi >= resolutionX) continue;
-                if (flPosYi >= resolutionY) continue;
-
-
-                idxFTL = flPosYi*step+ flPosXi;
-                idxFTLY = idxFTL+step;
-
-                if (flPosXi < minMax[0] ) minMax[0] = flPosXi;
-                if (flPosXi+1 > minMax[2] ) minMax[2] = flPosXi+1;
-                if (flPosYi < minMax[1] ) minMax[1] = flPosYi;
-                if (flPosYi+1 > minMax[3] ) minMax[3] = flPosYi+1;
-
-
-                zImgRes[idxFTL  ] += posZ*wtl;
-                assignRes[idxFTL] += wtl;
-
-                zImgRes[idxFTL+1  ] += posZ*wtr;
-                assignRes[idxFTL+1] += wtr;
-
-                zImgRes[idxFTLY  ] += posZ*wbl;
-                assignRes[idxFTLY] += wbl;
-
-                zImgRes[idxFTLY+1  ] += posZ*wbr;
-                assignRes[idxFTLY+1] += wbr;
-
+                ProcessBand(inD,startRow,endRow,zImg,assignVal,bands_[0],mode);
             }
+            else
+            {
+                ResetBand(bands_[bl],zImg,fillValue);
+                ProcessBand(inD,startRow,endRow,bands_[bl].zImg,bands_[bl].assign,bands_[bl],mode);
+            }
+        };
 
-        }
-
+        if (workerPool_ && numBands > 1) workerPool_->ParallelFor(numBands,processBand);
+        else for (int bl = 0; bl < numBands;++bl) processBand(bl);
 
-    }
+        minMax = bands_[0].minMax;
+        for (int bl = 1; bl < numBands;++bl)
+        {
+            const cv::Vec4i &bMinMax = bands_[bl].minMax;
+            minMax[0] = std::min(minMax[0],bMinMax[0]);
+            minMax[1] = std::min(minMax[1],bMinMax[1]);
+            minMax[2] = std::max(minMax[2],bMinMax[2]);
+            minMax[3] = std::max(minMax[3],bMinMax[3]);
+        }
+        const cv::Vec4i rect = GetTouched(minMax,zImg.size());
 
+        if (numBands < 2 || rect[3] < rect[1]) return;
 
+        const int numRows = rect[3]-rect[1]+1;
+        const int numJobs = std::min(numBands,numRows);
+        auto mergeRows = [&](int jl)
+        {
+            const int startRow = rect[1]+(numRows*jl)/numJobs;
+            const int endRow = rect[1]+(numRows*(jl+1))/numJobs;
+            MergeBands(numBands,rect,startRow,endRow,zImg,assignVal,mode);
+        };
 
+        if (workerPool_) workerPool_->ParallelFor(numJobs,mergeRows);
+        else for (int jl = 0; jl < numJobs;++jl) mergeRows(jl);
+    }
 
 };
 
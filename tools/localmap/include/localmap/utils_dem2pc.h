@@ -2,8 +2,13 @@
 #define UTILS_DEM2PC_H
 
 
-#include "sensor_msgs/PointCloud.h"
-#include "pcl_ros/point_cloud.h"
+#include "ros/ros.h"
+#include "sensor_msgs/PointCloud2.h"
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
 
 /**
  * @brief Helper class for DEM to point cloud conversion
@@ -26,59 +31,90 @@ static float ClampIntensity(float val)
 
 }
 
-static pcl::PointCloud<pcl::PointXYZRGB> ImageToCloud(const cv::Mat &inImage, const cv::Point2f &origin, const float pixelResolution )
+/**
+ * @brief Sets up the fields of a compact x,y,z,rgb cloud (16 bytes per point), only needs to be done once per message
+ */
+static void SetupCloudFields(sensor_msgs::PointCloud2 &cloud)
 {
-    pcl::PointCloud<pcl::PointXYZRGB> res;
-    res.width = inImage.cols;
-    res.height = inImage.rows;
-    res.resize(res.width*res.height);
-    //res.
-    const float* imgPtr;
+    if (cloud.fields.size() == 4) return;
 
-    float curPosY = origin.y,curPosX = origin.x;
+    const char *names[4] = {"x","y","z","rgb"};
+    cloud.fields.resize(4);
+    for (int tl = 0; tl < 4;++tl)
+    {
+        cloud.fields[tl].name = names[tl];
+        cloud.fields[tl].offset = tl*sizeof(float);
+        cloud.fields[tl].datatype = sensor_msgs::PointField::FLOAT32;
+        cloud.fields[tl].count = 1;
+    }
 
+    cloud.height = 1;
+    cloud.point_step = 4*sizeof(float);
+    cloud.is_bigendian = false;
+    cloud.is_dense = true;
+}
 
-    for (int y = 0; y <  inImage.rows;y++)
-    {
-        curPosX = origin.x;
-        imgPtr = inImage.ptr<float>(y);
-        for (int x = 0; x <  inImage.cols;x++)
-        {
-            float val = ((*imgPtr)-10000.0f)/1000.0f;
-            pcl::PointXYZRGB tp;
-            tp.x = curPosX;
-            tp.y = curPosY;
-            tp.z = val;
+/**
+ * @brief Writes every stride-th cell of the DEM into cloud, cells with invalidLevel (the value of unassigned cells) and non finite cells are skipped.
+ *
+ * Heights are (value-heightOffset)/heightScale. The data buffer of cloud keeps the size for all cells of the DEM and is only grown,
+ * never shrunk, so it is not zero filled again on the next call. Only the first row_step bytes (width points) are valid.
+ */
+static void ImageToCloud(const cv::Mat &inImage, const cv::Point2f &origin, const float pixelResolution, const float heightOffset, const float heightScale, const float invalidLevel, const int stride, sensor_msgs::PointCloud2 &cloud)
+{
+    SetupCloudFields(cloud);
 
-            tp.r = ClampIntensity(val);
-            tp.g = ClampIntensity(val);
-            tp.b = ClampIntensity(val);
+    const int step = std::max(stride,1);
+    const size_t maxPoints = (size_t)((inImage.rows+step-1)/step)*((inImage.cols+step-1)/step);
+    if (cloud.data.size() < maxPoints*cloud.point_step) cloud.data.resize(maxPoints*cloud.point_step);
 
-            res.at(x,y) = tp;
+    const float cellSize = step/pixelResolution;
+    const float heightScaleInv = 1.0f/heightScale;
 
-            curPosX+= 1.0/pixelResolution;
-            imgPtr++;
+    float *outP = (float*)cloud.data.data();
+    float curPosY = origin.y;
 
+    for (int y = 0; y <  inImage.rows;y+=step)
+    {
+        const float* imgPtr = inImage.ptr<float>(y);
+        float curPosX = origin.x;
+        for (int x = 0; x <  inImage.cols;x+=step)
+        {
+            const float mapVal = imgPtr[x];
+            if (mapVal != invalidLevel && std::isfinite(mapVal))
+            {
+                const float val = (mapVal-heightOffset)*heightScaleInv;
+                const uint32_t gray = (uint8_t)ClampIntensity(val);
+                // opaque, as pcl::toROSMsg writes it
+                const uint32_t rgb = (0xffu << 24) | (gray << 16) | (gray << 8) | gray;
+
+                outP[0] = curPosX;
+                outP[1] = curPosY;
+                outP[2] = val;
+                memcpy(&outP[3],&rgb,sizeof(rgb));
+                outP += 4;
+            }
+
+            curPosX+= cellSize;
         }
-        curPosY+= 1.0/pixelResolution;
+        curPosY+= cellSize;
     }
 
-    return res;
-
-
-
+    const size_t numPoints = (outP-(float*)cloud.data.data())/4;
+    cloud.width = numPoints;
+    cloud.row_step = numPoints*cloud.point_step;
 }
 
-
-static void PublishCloud(ros::Time stamp, std::string demFrame, cv::Mat &dem, ros::Publisher &imageCloud_pub_, const cv::Point2f &origin, const float pixelResolution)
+/**
+ * @brief Converts and publishes the DEM, cloud is kept by the caller so its buffer is reused between calls
+ */
+static void PublishCloud(ros::Time stamp, std::string demFrame, const cv::Mat &dem, ros::Publisher &imageCloud_pub_, const cv::Point2f &origin, const float pixelResolution, const float heightOffset, const float heightScale, const float invalidLevel, const int stride, sensor_msgs::PointCloud2 &cloud)
 {
-    pcl::PointCloud<pcl::PointXYZRGB> demCloud = ImageToCloud(dem, origin, pixelResolution);
+    ImageToCloud(dem, origin, pixelResolution, heightOffset, heightScale, invalidLevel, stride, cloud);
 
-    sensor_msgs::PointCloud2 demCloudMsg;
-    pcl::toROSMsg(demCloud,demCloudMsg);
-    demCloudMsg.header.stamp = stamp;
-    demCloudMsg.header.frame_id = demFrame;
-    imageCloud_pub_.publish(demCloudMsg);
+    cloud.header.stamp = stamp;
+    cloud.header.frame_id = demFrame;
+    imageCloud_pub_.publish(cloud);
 }
 
 
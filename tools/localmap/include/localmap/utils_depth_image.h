@@ -28,27 +28,31 @@ public:
 
     }
     /**
-     * @brief Some structured light sensors produce invalid measurements in the first few columns, setting these to NAN
+     * @brief Some structured light sensors produce invalid measurements in the first few columns, setting these to NAN (0 for raw CV_16U depth)
      */
     static void RemoveLeftBorderNoise(cv::Mat &image, int numCols, int startRow)
     {
-        float *imgPtr;
-        int xl;
-        for (int yl = startRow; yl < image.rows;++yl)
-        {
-            imgPtr = image.ptr<float>(yl);
-            for (xl = 0; xl < numCols;++xl) imgPtr[xl] =NAN;
-        }
-
+        RemoveWindow(image,0,numCols,startRow,image.rows);
     }
 
     /**
-     * @brief Crop the depth image to given rectangle
+     * @brief Crop the depth image to given rectangle, the pixels are set to NAN (0 for raw CV_16U depth)
      */
     static void RemoveWindow(cv::Mat &image, int startCol, int endCol, int startRow, int endRow)
     {
-        float *imgPtr;
         int xl;
+        if (image.type() == CV_16U)
+        {
+            unsigned short *imgPtr;
+            for (int yl = startRow; yl < endRow;++yl)
+            {
+                imgPtr = image.ptr<unsigned short>(yl);
+                for (xl = startCol; xl < endCol;++xl) imgPtr[xl] = 0;
+            }
+            return;
+        }
+
+        float *imgPtr;
         for (int yl = startRow; yl < endRow;++yl)
         {
             imgPtr = image.ptr<float>(yl);
@@ -0,0 +1,55 @@
+#ifndef ZIMAGE_KERNELS_H
+#define ZIMAGE_KERNELS_H
+
+
+/**
+ * @brief SIMD kernels for projecting depth image rows into elevation image coordinates
+ *
+ * The kernels are compiled for several instruction sets (zimage_kernels_*.cpp, selected with a target attribute per function),
+ * the best one is chosen at runtime.
+ */
+namespace ZImageKernels
+{
+
+/// Position of invalid pixels, lies outside of every elevation image
+const float InvalidPos = -16.0f;
+
+/**
+ * @brief Transform of one depth image row
+ *
+ * For a pixel in column x with depth d = depthScale*value the elevation image position is
+ * pos = d*(colFactor[x]*a + b) + c, pixels with d < minDepth (or NAN) are set to InvalidPos.
+ */
+struct RowTransform
+{
+    const float *colFactor;
+    float ax, bx, cx;
+    float ay, by, cy;
+    float az, bz, cz;
+    float depthScale;
+    float minDepth;
+};
+
+typedef void (*ProjectRowFunc)(const void *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ);
+
+struct Kernels
+{
+    const char *name;
+    /// raw CV_16U depth rows
+    ProjectRowFunc projectRow16U;
+    /// CV_32F depth rows
+    ProjectRowFunc projectRow32F;
+};
+
+bool GetKernelsSSE(Kernels &kernels);
+bool GetKernelsAVX2(Kernels &kernels);
+
+/**
+ * @brief Returns the kernels for the instruction set of the current CPU, detection is only done once
+ */
+const Kernels& SelectKernels();
+
+}
+
+
+#endif // ZIMAGE_KERNELS_H
@@ -2,6 +2,9 @@
 #include "blockmap.h"
 #include <opencv2/imgproc/imgproc.hpp>
 #include "utils_depth_image.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 void BlockMap::Setup()
 {
@@ -15,6 +18,8 @@ void BlockMap::Setup()
 
     currentMap_ = cv::Mat(mapResolution_,mapResolution_,CV_32F);
     tempMap_ = cv::Mat(mapResolution_,mapResolution_,CV_32F);
+    ringOffset_ = cv::Point2i(0,0);
+    ++mapVersion_;
 
     UpdateCenter(cv::Point2f(0,0));
 
@@ -51,19 +56,19 @@ void BlockMap::SetSafeBlocksTo()
     float startVal = (curPos_.z*heightScale_)- wcPos1.x*dx1 - wcPos1.y*dy1;
 
     startVal += mapBaseLevel_;
-    cv::Mat tmat = currentMap_(drawRect);
 
     float *mapPtr;
 
-    for (int y = 0; y < tmat.rows;++y)
+    for (int y = 0; y < drawRect.height;++y)
     {
-        mapPtr = tmat.ptr<float>(y);
-        for (int x = 0; x < tmat.cols;++x)
+        mapPtr = GetRow(drawRect.y+y);
+        for (int x = 0; x < drawRect.width;++x)
         {
-            mapPtr[x] = (startVal + dx1*(float)x + dy1*(float)y);
+            mapPtr[WrapX(drawRect.x+x)] = (startVal + dx1*(float)x + dy1*(float)y);
         }
     }
 
+    ++mapVersion_;
 
 }
 
@@ -122,7 +127,148 @@ void BlockMap::SetSafeBlocksTo(const cv::Point3f &normal, const cv::Point3f &pos
 void BlockMap::SetMapTo(float val)
 {
     currentMap_.setTo(val);
+    ++mapVersion_;
+
+}
+
+void BlockMap::SetRectTo(const cv::Rect &mapRect, float val)
+{
+    cv::Rect storageRects[4],mapRects[4];
+    const int numRects = GetStorageRects(mapRect,storageRects,mapRects);
+
+    for (int tl = 0; tl < numRects;++tl)
+    {
+        currentMap_(storageRects[tl]).setTo(val);
+    }
+    ++mapVersion_;
+}
+
+int BlockMap::GetStorageRects(const cv::Rect &mapRect, cv::Rect storageRects[4], cv::Rect mapRects[4]) const
+{
+    // split each axis at the wrap position
+    int storageX[2],mapX[2],width[2];
+    int storageY[2],mapY[2],height[2];
+
+    storageX[0] = WrapX(mapRect.x);
+    mapX[0] = mapRect.x;
+    width[0] = std::min(mapRect.width,mapResolution_-storageX[0]);
+    storageX[1] = 0;
+    mapX[1] = mapRect.x+width[0];
+    width[1] = mapRect.width-width[0];
+
+    storageY[0] = mapRect.y+ringOffset_.y >= mapResolution_ ? mapRect.y+ringOffset_.y-mapResolution_ : mapRect.y+ringOffset_.y;
+    mapY[0] = mapRect.y;
+    height[0] = std::min(mapRect.height,mapResolution_-storageY[0]);
+    storageY[1] = 0;
+    mapY[1] = mapRect.y+height[0];
+    height[1] = mapRect.height-height[0];
+
+    int numRects = 0;
+    for (int yl = 0; yl < 2;++yl)
+    {
+        if (height[yl] <= 0) continue;
+        for (int xl = 0; xl < 2;++xl)
+        {
+            if (width[xl] <= 0) continue;
+            storageRects[numRects] = cv::Rect(storageX[xl],storageY[yl],width[xl],height[yl]);
+            mapRects[numRects] = cv::Rect(mapX[xl],mapY[yl],width[xl],height[yl]);
+            numRects++;
+        }
+    }
 
+    return numRects;
+}
+
+const cv::Mat& BlockMap::GetMap()
+{
+    if (ringOffset_.x == 0 && ringOffset_.y == 0) return currentMap_;
+
+    if (contiguousVersion_ != mapVersion_)
+    {
+        cv::Rect storageRects[4],mapRects[4];
+        const int numRects = GetStorageRects(cv::Rect(0,0,mapResolution_,mapResolution_),storageRects,mapRects);
+
+        for (int tl = 0; tl < numRects;++tl)
+        {
+            cv::Mat target = tempMap_(mapRects[tl]);
+            currentMap_(storageRects[tl]).copyTo(target);
+        }
+        contiguousVersion_ = mapVersion_;
+    }
+
+    return tempMap_;
+}
+
+void BlockMap::CopyTo(BlockMap &target) const
+{
+    // the target keeps its own buffers
+    cv::Mat targetMap = target.currentMap_;
+    cv::Mat targetTempMap = target.tempMap_;
+    cv::Mat targetBaseLinkMap = target.baseLinkMap_;
+    unsigned int contiguousVersion = target.contiguousVersion_;
+
+    target = *this;
+
+    currentMap_.copyTo(targetMap);
+    target.currentMap_ = targetMap;
+    if (targetTempMap.size() != currentMap_.size())
+    {
+        targetTempMap.create(currentMap_.size(),CV_32F);
+        contiguousVersion = 0;
+    }
+    target.tempMap_ = targetTempMap;
+    target.baseLinkMap_ = targetBaseLinkMap;
+    target.contiguousVersion_ = contiguousVersion;
+}
+
+void BlockMap::ShiftRing(const cv::Point2i &shiftPixels)
+{
+    ringOffset_.x = ((ringOffset_.x+shiftPixels.x) % mapResolution_ + mapResolution_) % mapResolution_;
+    ringOffset_.y = ((ringOffset_.y+shiftPixels.y) % mapResolution_ + mapResolution_) % mapResolution_;
+
+    // map pixel x now shows the old map pixel x+shiftPixels.x, the part that was outside of the old map is cleared
+    if (shiftPixels.x > 0) SetRectTo(cv::Rect(mapResolution_-shiftPixels.x,0,shiftPixels.x,mapResolution_),0);
+    if (shiftPixels.x < 0) SetRectTo(cv::Rect(0,0,-shiftPixels.x,mapResolution_),0);
+    if (shiftPixels.y > 0) SetRectTo(cv::Rect(0,mapResolution_-shiftPixels.y,mapResolution_,shiftPixels.y),0);
+    if (shiftPixels.y < 0) SetRectTo(cv::Rect(0,0,mapResolution_,-shiftPixels.y),0);
+
+    ++mapVersion_;
+}
+
+template <typename T>
+void BlockMap::WarpMap(const cv::Mat &invAffine, cv::Mat &result)
+{
+    // same fixed point arithmetic as cv::warpAffine with INTER_NEAREST
+    const int abBits = 10;
+    const int abScale = 1 << abBits;
+    const int roundDelta = abScale/2;
+
+    const double m00 = invAffine.at<double>(0,0), m01 = invAffine.at<double>(0,1), m02 = invAffine.at<double>(0,2);
+    const double m10 = invAffine.at<double>(1,0), m11 = invAffine.at<double>(1,1), m12 = invAffine.at<double>(1,2);
+
+    std::vector<int> adelta(result.cols),bdelta(result.cols);
+    for (int x = 0; x < result.cols;++x)
+    {
+        adelta[x] = cv::saturate_cast<int>(m00*x*abScale);
+        bdelta[x] = cv::saturate_cast<int>(m10*x*abScale);
+    }
+
+    const unsigned int res = mapResolution_;
+
+    for (int y = 0; y < result.rows;++y)
+    {
+        const int x0 = cv::saturate_cast<int>((m01*y + m02)*abScale) + roundDelta;
+        const int y0 = cv::saturate_cast<int>((m11*y + m12)*abScale) + roundDelta;
+        T *resPtr = result.ptr<T>(y);
+
+        for (int x = 0; x < result.cols;++x)
+        {
+            const int sx = (x0 + adelta[x]) >> abBits;
+            const int sy = (y0 + bdelta[x]) >> abBits;
+
+            resPtr[x] = ((unsigned int)sx < res && (unsigned int)sy < res) ? cv::saturate_cast<T>(GetRow(sy)[WrapX(sx)]) : 0;
+        }
+    }
 }
 
 
@@ -159,15 +305,17 @@ cv::Point2f BlockMap::RobotPos2MapPos(cv::Point2f pos)
     return pixelPos;
 }
 
-void BlockMap::Transform2BaseLink(const cv::Point2d &pos, const double angle)
+void BlockMap::Transform2BaseLink(const cv::Point2d &pos, const double angle, const int outputType)
 {
+    const int size = baseLinkSize_ > 0 ? baseLinkSize_ : mapResolution_;
+
     cv::Point2d mapPos = RobotPos2MapPos(pos);
     cv::Mat rot = cv::getRotationMatrix2D(mapPos,angle*(180.0/CV_PI),1.0);
     cv::Mat row = cv::Mat::zeros(1,3,CV_64F);
     row.at<double>(0,2) = 1.0;
     rot.push_back(row);
 
-    cv::Point2d transVec(((double)mapResolution_/2.0)-mapPos.x,((double)mapResolution_/2.0)-mapPos.y);
+    cv::Point2d transVec(((double)size/2.0)-mapPos.x,((double)size/2.0)-mapPos.y);
 
     cv::Mat trans = cv::Mat::eye(3,3,CV_64F);
     trans.at<double>(0,2) = transVec.x;
@@ -176,9 +324,13 @@ void BlockMap::Transform2BaseLink(const cv::Point2d &pos, const double angle)
     cv::Mat warpMat = trans*rot;
     cv::Mat affineMat = warpMat.rowRange(0,2);
 
-    cv::warpAffine(currentMap_,baseLinkMap_,affineMat,currentMap_.size(),CV_INTER_NN);
+    cv::Mat invAffine;
+    cv::invertAffineTransform(affineMat,invAffine);
 
-    //return baseLinkMap_;
+    // only the window is warped, the conversion to the output type is done in the same pass
+    baseLinkMap_.create(size,size,outputType);
+    if (outputType == CV_16U) WarpMap<unsigned short>(invAffine,baseLinkMap_);
+    else WarpMap<float>(invAffine,baseLinkMap_);
 }
 
 
@@ -225,11 +377,16 @@ void BlockMap::CenterMap(const cv::Point2i &newCenterBlock)
 
     if (width <= 0 || height <= 0)
     {
+        ringOffset_ = cv::Point2i(0,0);
         UtilsDepthImage::SetToZero(currentMap_);
         SetSafeBlocksTo();
         //currentMap_.setTo(0);
         //return;
     }
+    else if (useRingBuffer_)
+    {
+        ShiftRing(shiftPixels);
+    }
     else
     {
 
@@ -244,6 +401,7 @@ void BlockMap::CenterMap(const cv::Point2i &newCenterBlock)
         curImg.copyTo(targetImg);
 
         tempMap_.copyTo(currentMap_);
+        ++mapVersion_;
 
 
 
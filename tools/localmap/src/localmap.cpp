@@ -8,11 +8,6 @@ DE_Localmap::DE_Localmap() :
     nodeP_("~")
 {
 
-    depthSub_ = nodeG_.subscribe ("/depth_image", 1, &DE_Localmap::imageCallback, this);
-
-    cameraInfoSub_ = nodeG_.subscribe ("/camera_info", 1, &DE_Localmap::ci_callback, this);
-
-
 #ifdef ELEVATION_CLOUD_DEBUG
     imageCloud_pub_ =    nodeG_.advertise<sensor_msgs::PointCloud2>("/elevation_cloud",1);
 
@@ -44,6 +39,8 @@ DE_Localmap::DE_Localmap() :
     blockMap_.pixelResolution_ = pixelResolution_;
     blockMap_.numBlocks_ = numBlocks_;
 
+    nodeP_.param("ringBufferMap", blockMap_.useRingBuffer_,true);
+
 
     nodeP_.param("processMode", processMode_,(int)PM_INTERP);
     nodeP_.param("fuseMode", fuseMode_,(int)FM_OVERWRITE);
@@ -54,6 +51,7 @@ DE_Localmap::DE_Localmap() :
     nodeP_.param("mapNotVisibleLevel", mapNotVisibleLevel_,1000.0);
 
     nodeP_.param("transform2BaseLink", transform2BaseLink_,true);
+    nodeP_.param("baseLinkWindowSize", blockMap_.baseLinkSize_,0);
     nodeP_.param("useLatestTransform", useLatestTransform_,0);
 
     nodeP_.param("removeLeftImageCols", removeLeftImageCols_,-1);
@@ -72,22 +70,54 @@ DE_Localmap::DE_Localmap() :
     nodeP_.param("minDepthThreshold", tval,0.4);
     proc_.minDepthThreshold_ = tval;
 
+    nodeP_.param("depthScale16U", tval,0.001);
+    proc_.depthScale16U_ = tval;
+
+    // threads per camera
+    int numThreads;
+    nodeP_.param("numThreads", numThreads,4);
+
 
     nodeP_.param("mapFrame", mapFrame_,std::string("map"));
     nodeP_.param("baseLinkFrame", baseFrame_,std::string("base_link"));
     nodeP_.param("localMapFrame", localMapFrame_,std::string("local_map"));
 
-    numRegistered_ = 0;
-    totalRegisterTime_ = 0;
+#ifdef ELEVATION_CLOUD_DEBUG
+    // only every cloudStride-th map cell in x and y is published to the elevation cloud
+    nodeP_.param("cloudStride", cloudStride_,1);
+#endif
+
+    // each camera subscribes to <name>/depth_image and <name>/camera_info, without cameras a single camera uses /depth_image and /camera_info
+    std::vector<std::string> cameraNames;
+    nodeP_.getParam("cameras", cameraNames);
+    if (cameraNames.empty()) cameraNames.push_back("");
+
+    for (unsigned int tl = 0; tl < cameraNames.size();++tl)
+    {
+        std::shared_ptr<CameraInput> camera = std::make_shared<CameraInput>();
+        camera->name = cameraNames[tl];
+        camera->hasCamInfo = false;
+        camera->hasCam2Base = false;
+        camera->numRegistered = 0;
+        camera->totalRegisterTime = 0;
 
-    hasCamInfo_ = false;
-    hasCam2Base_ = false;
+        camera->proc = proc_;
+        camera->proc.SetNumThreads(numThreads);
 
-    cAssign_ = cv::Mat(mapResolution_,mapResolution_,CV_32F);
-    cZImg_ = cv::Mat(mapResolution_,mapResolution_,CV_32F);
+        camera->assign = cv::Mat(mapResolution_,mapResolution_,CV_32F);
+        camera->zImg = cv::Mat(mapResolution_,mapResolution_,CV_32F);
 
-    cZImg_.setTo(mapZeroLevel_);
-    cAssign_.setTo(0);
+        camera->zImg.setTo(mapZeroLevel_);
+        camera->assign.setTo(0);
+
+        const std::string depthTopic = camera->name + "/depth_image";
+        const std::string infoTopic = camera->name + "/camera_info";
+
+        camera->depthSub = nodeG_.subscribe<sensor_msgs::Image>(depthTopic, 1, boost::bind(&DE_Localmap::imageCallback, this, _1, tl));
+        camera->cameraInfoSub = nodeG_.subscribe<sensor_msgs::CameraInfo>(infoTopic, 1, boost::bind(&DE_Localmap::ci_callback, this, _1, tl));
+
+        cameras_.push_back(camera);
+    }
 
     blockMap_.mapNotVisibleLevel_ = mapNotVisibleLevel_;
     blockMap_.mapBaseLevel_ = mapOffset_;
@@ -97,6 +127,20 @@ DE_Localmap::DE_Localmap() :
 
     initBlockMap_ = true;
 
+    numIngested_ = 0;
+    numPublished_ = 0;
+    publishCamera_ = 0;
+
+    // exports with publishRate > 0 run on their own thread from a snapshot of the map, otherwise after every depth image
+    nodeP_.param("publishRate", publishRate_,0.0);
+    if (publishRate_ > 0)
+    {
+        publishNode_.setCallbackQueue(&publishQueue_);
+        publishTimer_ = publishNode_.createTimer(ros::Duration(1.0/publishRate_),&DE_Localmap::publishTimerCallback,this);
+        publishSpinner_.reset(new ros::AsyncSpinner(1,&publishQueue_));
+        publishSpinner_->start();
+    }
+
 
 
 
@@ -104,25 +148,25 @@ DE_Localmap::DE_Localmap() :
 
 
 
-void DE_Localmap::SetupMatrices(tf::Transform &transform)
+void DE_Localmap::SetupMatrices(ZImageProc &proc, tf::Transform &transform)
 {
     tf::Matrix3x3 rotMat(transform.getRotation());
 
-    proc_.r11 = rotMat[0][0];
-    proc_.r12 = rotMat[0][1];
-    proc_.r13 = rotMat[0][2];
-    proc_.r21 = rotMat[1][0];
-    proc_.r22 = rotMat[1][1];
-    proc_.r23 = rotMat[1][2];
-    proc_.r31 = rotMat[2][0];
-    proc_.r32 = rotMat[2][1];
-    proc_.r33 = rotMat[2][2];
+    proc.r11 = rotMat[0][0];
+    proc.r12 = rotMat[0][1];
+    proc.r13 = rotMat[0][2];
+    proc.r21 = rotMat[1][0];
+    proc.r22 = rotMat[1][1];
+    proc.r23 = rotMat[1][2];
+    proc.r31 = rotMat[2][0];
+    proc.r32 = rotMat[2][1];
+    proc.r33 = rotMat[2][2];
 
     tf::Vector3 nTrans = transform.getOrigin();
 
-    proc_.t1 = nTrans.x();
-    proc_.t2 = nTrans.y();
-    proc_.t3 = nTrans.z();
+    proc.t1 = nTrans.x();
+    proc.t2 = nTrans.y();
+    proc.t3 = nTrans.z();
 
 
 }
@@ -146,28 +190,31 @@ bool DE_Localmap::GetTransform(ros::Time time,std::string targetFrame, std::stri
 
 }
 
-void DE_Localmap::ci_callback(const sensor_msgs::CameraInfoConstPtr& info)
+void DE_Localmap::ci_callback(const sensor_msgs::CameraInfoConstPtr& info, const int cameraIdx)
 {
-    if (hasCamInfo_) return;
+    CameraInput &camera = *cameras_[cameraIdx];
+
+    if (camera.hasCamInfo) return;
     if (info->P.at(0) == 0) return;
-    camInfo_ = *info;
+    camera.camInfo = *info;
 
-    hasCamInfo_ = true;
+    camera.proc.SetupCam(camera.camInfo.P[0],camera.camInfo.P[5],camera.camInfo.P[2],camera.camInfo.P[6]);
 
-    proc_.SetupCam(camInfo_.P[0],camInfo_.P[5],camInfo_.P[2],camInfo_.P[6]);
+    // set last, the image callback of the camera may run concurrently
+    camera.hasCamInfo = true;
 
-    ROS_INFO_STREAM("Received camera info!");
+    ROS_INFO_STREAM("Received camera info! " << camera.name);
 
 }
 
 cv::Point2f DE_Localmap::ConvertPoint(cv::Point2f &p)
 {
-    return cv::Point2f((p.x-proc_.minXVal_) * proc_.pixelResolution_,(p.y-proc_.minYVal_) * proc_.pixelResolution_);
+    return cv::Point2f((p.x-blockMap_.origin_.x) * pixelResolution_,(p.y-blockMap_.origin_.y) * pixelResolution_);
 
 }
 
 
-void DE_Localmap::UpdateLocalMapOverwrite(cv::Mat &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax)
+void DE_Localmap::UpdateLocalMapOverwrite(BlockMap &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax)
 {
     const float *zImageP;
     float *localMapP;
@@ -181,23 +228,27 @@ void DE_Localmap::UpdateLocalMapOverwrite(cv::Mat &localMap, const cv::Mat & zIm
     for (yl = minMax[1]; yl < minMax[3];++yl)
     {
         zImageP = zImage.ptr<float>(yl);
-        localMapP = localMap.ptr<float>(yl);
+        localMapP = localMap.GetRow(yl);
         assignP = assignImage.ptr<float>(yl);
 
         for (xl = minMax[0]; xl < minMax[2];++xl)
         {
             if (assignP[xl] >= minVal)
             {
-                localMapP[xl] = (zImageP[xl]/(assignP[xl]))*mapScaleF+mapOffsetF;
+                // other cameras may update the same cells concurrently
+                float nval = (zImageP[xl]/(assignP[xl]))*mapScaleF+mapOffsetF;
+                __atomic_store(&localMapP[localMap.WrapX(xl)],&nval,__ATOMIC_RELAXED);
 
             }
 
         }
     }
 
+    localMap.SetModified();
+
 }
 
-void DE_Localmap::UpdateLocalMapMax(cv::Mat &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax)
+void DE_Localmap::UpdateLocalMapMax(BlockMap &localMap, const cv::Mat & zImage, const cv::Mat &assignImage, const cv::Vec4i &minMax)
 {
     const float *zImageP;
     float *localMapP;
@@ -212,47 +263,54 @@ void DE_Localmap::UpdateLocalMapMax(cv::Mat &localMap, const cv::Mat & zImage, c
     for (yl = minMax[1]; yl < minMax[3];++yl)
     {
         zImageP = zImage.ptr<float>(yl);
-        localMapP = localMap.ptr<float>(yl);
+        localMapP = localMap.GetRow(yl);
         assignP = assignImage.ptr<float>(yl);
 
         for (xl = minMax[0]; xl < minMax[2];++xl)
         {
             if (assignP[xl] >= minVal)
             {
-                const float nval = (zImageP[xl]/(assignP[xl]))*mapScaleF+mapOffsetF;
-                if (nval > localMapP[xl]) localMapP[xl] = nval;
+                float nval = (zImageP[xl]/(assignP[xl]))*mapScaleF+mapOffsetF;
+                float *mapVal = &localMapP[localMap.WrapX(xl)];
+
+                // lock free maximum, other cameras may update the same cells concurrently
+                float curVal;
+                __atomic_load(mapVal,&curVal,__ATOMIC_RELAXED);
+                while (nval > curVal && !__atomic_compare_exchange(mapVal,&curVal,&nval,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) {}
 
             }
 
         }
     }
 
+    localMap.SetModified();
+
 }
 
 
 
 
-void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
+void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth, const int cameraIdx)
 {
+    CameraInput &camera = *cameras_[cameraIdx];
 
-
-    if (!hasCamInfo_) return;
+    if (!camera.hasCamInfo) return;
 
     std::string cameraFrame = depth->header.frame_id;
     ros::Time timeStamp = depth->header.stamp;
     if (useLatestTransform_ == 1) timeStamp = ros::Time::now();
     if (useLatestTransform_ == 2) timeStamp = ros::Time(0);
 
-    if (!hasCam2Base_)
+    if (!camera.hasCam2Base)
     {
 
-        if (!GetTransform(ros::Time(0),baseFrame_, cameraFrame, cam2Base_)) {
+        if (!GetTransform(ros::Time(0),baseFrame_, cameraFrame, camera.cam2Base)) {
             ROS_ERROR_STREAM("Error looking up Camera to Base transform: " << cameraFrame << " to " << baseFrame_);
 
             return;
 
         }
-        hasCam2Base_ = true;
+        camera.hasCam2Base = true;
     }
 
 
@@ -266,6 +324,8 @@ void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
     }
 
 
+    cv::Point3f robotPose;
+    cv::Point3f robotNormal;
     {
         cv::Point3f pos(base2map.getOrigin().x(),base2map.getOrigin().y(),base2map.getOrigin().z());
 
@@ -282,7 +342,8 @@ void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
 
         cv::Point3f normal(tf_normal.x(),tf_normal.y(),tf_normal.z());
 
-        blockMap_.SetPose(normal,pos);
+        robotPose = pos;
+        robotNormal = normal;
 
 
     }
@@ -306,7 +367,7 @@ void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
 
 
     tf::Transform cam2map;
-    cam2map = base2map*cam2Base_;
+    cam2map = base2map*camera.cam2Base;
 
 
 
@@ -314,16 +375,24 @@ void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
     cv::Mat cvDepth = cv_bridge::toCvShare(depth,"")->image;
 
 
-    SetupMatrices(cam2map);
+    SetupMatrices(camera.proc,cam2map);
 
 
-    if (cvDepth.type() != CV_32F)
+    // raw 16 bit depth is projected directly, other types are converted to meters
+    if (cvDepth.type() != CV_32F && cvDepth.type() != CV_16U)
     {
         cv::Mat convImg;
         cvDepth.convertTo(convImg,CV_32F,1.0/1000.0,0);
         cvDepth = convImg;
     }
 
+    const bool removePixels = removeLeftImageCols_ > 0 || (removeWindowStartCol_ >= 0 && removeWindowEndCol_ >= 0 && removeWindowStartRow_ >= 0 && removeWindowEndRow_ >= 0);
+    // the shared message buffer must not be modified
+    if (removePixels && cvDepth.data == depth->data.data())
+    {
+        cvDepth = cvDepth.clone();
+    }
+
     if (removeLeftImageCols_ > 0)
     {
         UtilsDepthImage::RemoveLeftBorderNoise(cvDepth,removeLeftImageCols_,0);
@@ -337,17 +406,25 @@ void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
 
 
 
-    blockMap_.ReCenter(robotPos*(1.0));
-
-    if (initBlockMap_)
     {
-        blockMap_.SetSafeBlocksTo();
-        initBlockMap_ = false;
+        // recentering moves the map, no camera may project at the same time
+        boost::unique_lock<boost::shared_mutex> mapLock(mapMutex_);
+
+        blockMap_.SetPose(robotNormal,robotPose);
+        blockMap_.ReCenter(robotPos*(1.0));
+
+        if (initBlockMap_)
+        {
+            blockMap_.SetSafeBlocksTo();
+            initBlockMap_ = false;
+        }
     }
 
+    // the cameras project and fuse concurrently, recentering and the snapshots of the publish thread are exclusive
+    boost::shared_lock<boost::shared_mutex> mapLock(mapMutex_);
 
-    proc_.minXVal_ = blockMap_.origin_.x;
-    proc_.minYVal_ = blockMap_.origin_.y;
+    camera.proc.minXVal_ = blockMap_.origin_.x;
+    camera.proc.minYVal_ = blockMap_.origin_.y;
 
 
 
@@ -355,74 +432,153 @@ void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
 
 
     switch (processMode_) {
-    case PM_NN: proc_.ProcessDepthImageNN(cvDepth,cZImg_, cAssign_,minMax, mapScale_,mapOffset_,mapZeroLevel_);  break;
-    case PM_MAX: proc_.ProcessDepthImageMaxNN(cvDepth,cZImg_, cAssign_,minMax, mapScale_,mapOffset_,mapZeroLevel_);  break;
-    default:proc_.ProcessDepthImage(cvDepth,cZImg_, cAssign_,minMax, mapScale_,mapOffset_,mapZeroLevel_);  break;
+    case PM_NN: camera.proc.ProcessDepthImageNN(cvDepth,camera.zImg, camera.assign,minMax, mapScale_,mapOffset_,mapZeroLevel_);  break;
+    case PM_MAX: camera.proc.ProcessDepthImageMaxNN(cvDepth,camera.zImg, camera.assign,minMax, mapScale_,mapOffset_,mapZeroLevel_);  break;
+    default:camera.proc.ProcessDepthImage(cvDepth,camera.zImg, camera.assign,minMax, mapScale_,mapOffset_,mapZeroLevel_);  break;
     }
 
     switch (fuseMode_) {
-    case FM_MAX: UpdateLocalMapMax(blockMap_.currentMap_,cZImg_, cAssign_,minMax);  break;
-    default: UpdateLocalMapOverwrite(blockMap_.currentMap_,cZImg_, cAssign_,minMax);  break;
+    case FM_MAX: UpdateLocalMapMax(blockMap_,camera.zImg, camera.assign,minMax);  break;
+    default: UpdateLocalMapOverwrite(blockMap_,camera.zImg, camera.assign,minMax);  break;
     }
 
-    cv::Mat resultImg = blockMap_.currentMap_;
-    std::string resultFrameID = localMapFrame_;
+    const cv::Point2f mapOrigin = blockMap_.origin_;
 
-    if (transform2BaseLink_)
-    {
-        blockMap_.Transform2BaseLink(robotPosD,bYaw);
-        resultImg = blockMap_.baseLinkMap_;
-        resultFrameID = baseFrame_;
+    mapLock.unlock();
 
+    if (publishRate_ > 0)
+    {
+        std::lock_guard<std::mutex> publishLock(publishMutex_);
+        publishHeader_ = depth->header;
+        publishHeader_.stamp = timeStamp;
+        publishRobotPos_ = robotPosD;
+        publishRobotYaw_ = bYaw;
+        publishCamera_ = cameraIdx;
+        ++numIngested_;
     }
 
-    if (output16U_)
+
+    geometry_msgs::PoseStamped localMapPose;
+
+    localMapPose.pose.position.x = mapOrigin.x;
+    localMapPose.pose.position.y = mapOrigin.y;
+    localMapPose.pose.position.z = 0;
+
+    localMapPose.pose.orientation = tf::createQuaternionMsgFromYaw(0);
+
+    localMapPose.header.stamp = timeStamp;
+    localMapPose.header.frame_id = localMapFrame_;
+
+    tf::Transform tfPose;
+    tf::poseMsgToTF(localMapPose.pose,tfPose);
+    static tf::TransformBroadcaster br;
+    br.sendTransform(tf::StampedTransform(tfPose, timeStamp, mapFrame_, localMapFrame_));
+
+
+    if (publishRate_ <= 0)
     {
-        cv::Mat tempImg;
-        resultImg.convertTo(tempImg,CV_16U);
-        resultImg = tempImg;
+        std_msgs::Header header = depth->header;
+        header.stamp = timeStamp;
 
+        // as on the publish thread the exports run on a snapshot, only the copy blocks the ingest
+        std::lock_guard<std::mutex> publishLock(publishMutex_);
+        {
+            boost::unique_lock<boost::shared_mutex> copyLock(mapMutex_);
+            blockMap_.CopyTo(publishMap_);
+        }
+        // the assign image is only written by this camera's callback
+        PublishMaps(publishMap_,camera.assign,header,robotPosD,bYaw);
     }
 
 
-
     timeval tZend;
     gettimeofday(&tZend, NULL);
 
 
     float zImgMsElapsed = (float)(tZend.tv_sec - tZstart.tv_sec)*1000.0+ (float)(tZend.tv_usec - tZstart.tv_usec)/1000.0;
-    numRegistered_++;
-    totalRegisterTime_ += zImgMsElapsed;
-    ROS_INFO_STREAM_THROTTLE(3,"ZImage Register Time: " << zImgMsElapsed << " Number: " << numRegistered_ << " AVG: " << totalRegisterTime_/(double)numRegistered_);
+    camera.numRegistered++;
+    camera.totalRegisterTime += zImgMsElapsed;
+    ROS_INFO_STREAM_THROTTLE(3,"ZImage Register Time " << camera.name << ": " << zImgMsElapsed << " Number: " << camera.numRegistered << " AVG: " << camera.totalRegisterTime/(double)camera.numRegistered);
 
 
-    geometry_msgs::PoseStamped localMapPose;
+}
 
-    localMapPose.pose.position.x = blockMap_.origin_.x;
-    localMapPose.pose.position.y = blockMap_.origin_.y;
-    localMapPose.pose.position.z = 0;
 
-    localMapPose.pose.orientation = tf::createQuaternionMsgFromYaw(0);
+void DE_Localmap::publishTimerCallback(const ros::TimerEvent &event)
+{
+    bool publishAssign = assignImagePub_.getNumSubscribers() > 0;
+    bool hasSubscribers = publishAssign || zImagePub_.getNumSubscribers() > 0;
+#ifdef ELEVATION_CLOUD_DEBUG
+    hasSubscribers = hasSubscribers || imageCloud_pub_.getNumSubscribers() > 0;
+#endif
+    if (!hasSubscribers) return;
 
-    localMapPose.header.stamp = timeStamp;
-    localMapPose.header.frame_id = localMapFrame_;
+    std_msgs::Header header;
+    cv::Point2d robotPos;
+    double robotYaw;
 
-    tf::Transform tfPose;
-    tf::poseMsgToTF(localMapPose.pose,tfPose);
-    static tf::TransformBroadcaster br;
-    br.sendTransform(tf::StampedTransform(tfPose, timeStamp, mapFrame_, localMapFrame_));
+    {
+        std::lock_guard<std::mutex> publishLock(publishMutex_);
+        if (numIngested_ == numPublished_) return;
+        numPublished_ = numIngested_;
+
+        header = publishHeader_;
+        robotPos = publishRobotPos_;
+        robotYaw = publishRobotYaw_;
+
+        // only the copy blocks the ingest, the exports run on the snapshot
+        boost::unique_lock<boost::shared_mutex> lock(mapMutex_);
+        blockMap_.CopyTo(publishMap_);
+        // only the assign image of the camera with the latest depth image is published
+        if (publishAssign) cameras_[publishCamera_]->assign.copyTo(publishAssign_);
+        else publishAssign_ = cv::Mat();
+    }
 
+    PublishMaps(publishMap_,publishAssign_,header,robotPos,robotYaw);
+}
+
+
+void DE_Localmap::PublishMaps(BlockMap &map, const cv::Mat &assignImage, const std_msgs::Header &header, const cv::Point2d &robotPos, const double robotYaw)
+{
+    // the exported map is only computed if someone listens
+    const bool exportMap = zImagePub_.getNumSubscribers() > 0;
+
+    cv::Mat resultImg;
+    std::string resultFrameID = transform2BaseLink_ ? baseFrame_ : localMapFrame_;
+
+    if (exportMap && transform2BaseLink_)
+    {
+        // the 16 bit conversion is done during the warp
+        map.Transform2BaseLink(robotPos,robotYaw,output16U_ ? CV_16U : CV_32F);
+        resultImg = map.baseLinkMap_;
+    }
+    else if (exportMap)
+    {
+        resultImg = map.GetMap();
+
+        if (output16U_)
+        {
+            cv::Mat tempImg;
+            resultImg.convertTo(tempImg,CV_16U);
+            resultImg = tempImg;
+
+        }
+    }
 
 
 #ifdef ELEVATION_CLOUD_DEBUG
-    if (imageCloud_pub_.getNumSubscribers() > 0) UtilsDem2PC::PublishCloud(timeStamp,mapFrame_,blockMap_.currentMap_,imageCloud_pub_,blockMap_.origin_, blockMap_.pixelResolution_);
+    if (imageCloud_pub_.getNumSubscribers() > 0)
+    {
+        cv::Mat dem = map.GetMap();
+        // the block map clears cells without measurements to 0
+        UtilsDem2PC::PublishCloud(header.stamp,mapFrame_,dem,imageCloud_pub_,map.origin_, map.pixelResolution_,map.mapBaseLevel_,map.heightScale_,0.0f,cloudStride_,cloudMsg_);
+    }
 #endif
 
-    if (zImagePub_.getNumSubscribers() > 0)
+    if (exportMap)
     {
         cv_bridge::CvImage out_z_image;
-        out_z_image.header   = depth->header; // Same timestamp and tf frame as input image
-        out_z_image.header.stamp   = timeStamp; // Same timestamp and tf frame as input image
+        out_z_image.header   = header; // Same timestamp and tf frame as input image
         out_z_image.header.frame_id   = resultFrameID; // Same timestamp and tf frame as input image
         if (resultImg.type() == CV_32F)
         {
@@ -437,14 +593,13 @@ void DE_Localmap::imageCallback(const sensor_msgs::ImageConstPtr& depth)
     }
 
 
-    if (assignImagePub_.getNumSubscribers() > 0)
+    if (!assignImage.empty() && assignImagePub_.getNumSubscribers() > 0)
     {
 
         cv_bridge::CvImage out_assign_image;
-        out_assign_image.header   = depth->header; // Same timestamp and tf frame as input image
-        out_assign_image.header.stamp   = timeStamp; // Same timestamp and tf frame as input image
+        out_assign_image.header   = header; // Same timestamp and tf frame as input image
         out_assign_image.encoding = sensor_msgs::image_encodings::TYPE_32FC1; // Or whatever
-        out_assign_image.image    = cAssign_; // Your cv::Mat
+        out_assign_image.image    = assignImage; // Your cv::Mat
         assignImagePub_.publish(out_assign_image.toImageMsg());
     }
 
@@ -8,12 +8,10 @@ int main(int argc, char **argv)
     ros::init(argc, argv, "LocalMap_Node");
     DE_Localmap demNode;
 
-    ros::Rate r(60);
-    while(ros::ok())
-    {
-        ros::spinOnce();
-        r.sleep();
-    }
+    // one thread per camera, the depth images of different cameras are processed concurrently
+    ros::AsyncSpinner spinner(demNode.GetNumCameras());
+    spinner.start();
+    ros::waitForShutdown();
 
     return 0;
 }
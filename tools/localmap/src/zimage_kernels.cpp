@@ -0,0 +1,72 @@
+#include "zimage_kernels.h"
+
+#include <mutex>
+
+namespace ZImageKernels
+{
+
+namespace Scalar
+{
+
+template <typename T>
+inline void ProjectRow(const T *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    for (int xl = 0; xl < cols;++xl)
+    {
+        const float oz = (float)depthRow[xl]*t.depthScale;
+        if (!(oz >= t.minDepth))
+        {
+            posX[xl] = InvalidPos;
+            posY[xl] = InvalidPos;
+            posZ[xl] = 0;
+            continue;
+        }
+
+        const float f = t.colFactor[xl];
+        posX[xl] = oz*(f*t.ax+t.bx)+t.cx;
+        posY[xl] = oz*(f*t.ay+t.by)+t.cy;
+        posZ[xl] = oz*(f*t.az+t.bz)+t.cz;
+    }
+}
+
+void ProjectRow16U(const void *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    ProjectRow((const unsigned short*)depthRow,cols,t,posX,posY,posZ);
+}
+
+void ProjectRow32F(const void *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    ProjectRow((const float*)depthRow,cols,t,posX,posY,posZ);
+}
+
+}
+
+
+const Kernels& SelectKernels()
+{
+    static std::once_flag selected;
+    static Kernels activeKernels;
+
+    std::call_once(selected, []()
+    {
+        Kernels kernels;
+        kernels.name = "Scalar";
+        kernels.projectRow16U = &Scalar::ProjectRow16U;
+        kernels.projectRow32F = &Scalar::ProjectRow32F;
+
+        /// fall back to the next lower variant, if a variant was not compiled
+        bool found = false;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) found = GetKernelsAVX2(kernels);
+        if (!found) GetKernelsSSE(kernels);
+#endif
+        (void)found;
+
+        activeKernels = kernels;
+    });
+
+    return activeKernels;
+}
+
+}
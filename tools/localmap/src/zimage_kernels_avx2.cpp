@@ -0,0 +1,105 @@
+#include "zimage_kernels.h"
+
+/// The kernels are compiled for AVX2 by their target attribute, the translation unit itself uses the default flags
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LOCALMAP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace ZImageKernels
+{
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace AVX2
+{
+
+/**
+ * @brief Transforms 8 pixels with depth oz, invalid pixels are replaced by InvalidPos
+ */
+inline LOCALMAP_TARGET_AVX2 void Project8(__m256 oz, const float *colFactor, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    const __m256 valid = _mm256_cmp_ps(oz,_mm256_set1_ps(t.minDepth),_CMP_GE_OQ);
+    const __m256 invalid = _mm256_set1_ps(InvalidPos);
+    const __m256 f = _mm256_loadu_ps(colFactor);
+
+    const __m256 px = _mm256_add_ps(_mm256_mul_ps(oz,_mm256_add_ps(_mm256_mul_ps(f,_mm256_set1_ps(t.ax)),_mm256_set1_ps(t.bx))),_mm256_set1_ps(t.cx));
+    const __m256 py = _mm256_add_ps(_mm256_mul_ps(oz,_mm256_add_ps(_mm256_mul_ps(f,_mm256_set1_ps(t.ay)),_mm256_set1_ps(t.by))),_mm256_set1_ps(t.cy));
+    const __m256 pz = _mm256_add_ps(_mm256_mul_ps(oz,_mm256_add_ps(_mm256_mul_ps(f,_mm256_set1_ps(t.az)),_mm256_set1_ps(t.bz))),_mm256_set1_ps(t.cz));
+
+    _mm256_storeu_ps(posX,_mm256_blendv_ps(invalid,px,valid));
+    _mm256_storeu_ps(posY,_mm256_blendv_ps(invalid,py,valid));
+    _mm256_storeu_ps(posZ,_mm256_and_ps(valid,pz));
+}
+
+LOCALMAP_TARGET_AVX2 void ProjectRow16U(const void *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    const unsigned short *dP = (const unsigned short*)depthRow;
+    const __m256 scale = _mm256_set1_ps(t.depthScale);
+
+    int xl = 0;
+    for (; xl+16 <= cols; xl += 16)
+    {
+        const __m256i raw = _mm256_loadu_si256((const __m256i*)(dP+xl));
+        const __m256 lo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(raw))),scale);
+        const __m256 hi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(raw,1))),scale);
+
+        Project8(lo,t.colFactor+xl,t,posX+xl,posY+xl,posZ+xl);
+        Project8(hi,t.colFactor+xl+8,t,posX+xl+8,posY+xl+8,posZ+xl+8);
+    }
+
+    for (; xl < cols;++xl)
+    {
+        const float oz = (float)dP[xl]*t.depthScale;
+        const float f = t.colFactor[xl];
+        const bool valid = oz >= t.minDepth;
+        posX[xl] = valid ? oz*(f*t.ax+t.bx)+t.cx : InvalidPos;
+        posY[xl] = valid ? oz*(f*t.ay+t.by)+t.cy : InvalidPos;
+        posZ[xl] = valid ? oz*(f*t.az+t.bz)+t.cz : 0;
+    }
+}
+
+LOCALMAP_TARGET_AVX2 void ProjectRow32F(const void *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    const float *dP = (const float*)depthRow;
+    const __m256 scale = _mm256_set1_ps(t.depthScale);
+
+    int xl = 0;
+    for (; xl+8 <= cols; xl += 8)
+    {
+        Project8(_mm256_mul_ps(_mm256_loadu_ps(dP+xl),scale),t.colFactor+xl,t,posX+xl,posY+xl,posZ+xl);
+    }
+
+    for (; xl < cols;++xl)
+    {
+        const float oz = dP[xl]*t.depthScale;
+        const float f = t.colFactor[xl];
+        const bool valid = oz >= t.minDepth;
+        posX[xl] = valid ? oz*(f*t.ax+t.bx)+t.cx : InvalidPos;
+        posY[xl] = valid ? oz*(f*t.ay+t.by)+t.cy : InvalidPos;
+        posZ[xl] = valid ? oz*(f*t.az+t.bz)+t.cz : 0;
+    }
+}
+
+}
+
+bool GetKernelsAVX2(Kernels &kernels)
+{
+    kernels.name = "AVX2";
+    kernels.projectRow16U = &AVX2::ProjectRow16U;
+    kernels.projectRow32F = &AVX2::ProjectRow32F;
+    return true;
+}
+
+#else
+
+bool GetKernelsAVX2(Kernels &kernels)
+{
+    (void)kernels;
+    return false;
+}
+
+#endif
+
+}
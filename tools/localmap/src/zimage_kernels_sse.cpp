@@ -0,0 +1,110 @@
+#include "zimage_kernels.h"
+
+/// The kernels are compiled for SSE2 by their target attribute, the translation unit itself uses the default flags
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define LOCALMAP_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+
+namespace ZImageKernels
+{
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace SSE
+{
+
+/**
+ * @brief Transforms 4 pixels with depth oz, invalid pixels are replaced by InvalidPos
+ */
+inline LOCALMAP_TARGET_SSE2 void Project4(__m128 oz, const float *colFactor, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    const __m128 valid = _mm_cmpge_ps(oz,_mm_set1_ps(t.minDepth));
+    const __m128 invalid = _mm_set1_ps(InvalidPos);
+    const __m128 f = _mm_loadu_ps(colFactor);
+
+    __m128 px = _mm_add_ps(_mm_mul_ps(oz,_mm_add_ps(_mm_mul_ps(f,_mm_set1_ps(t.ax)),_mm_set1_ps(t.bx))),_mm_set1_ps(t.cx));
+    __m128 py = _mm_add_ps(_mm_mul_ps(oz,_mm_add_ps(_mm_mul_ps(f,_mm_set1_ps(t.ay)),_mm_set1_ps(t.by))),_mm_set1_ps(t.cy));
+    __m128 pz = _mm_add_ps(_mm_mul_ps(oz,_mm_add_ps(_mm_mul_ps(f,_mm_set1_ps(t.az)),_mm_set1_ps(t.bz))),_mm_set1_ps(t.cz));
+
+    px = _mm_or_ps(_mm_and_ps(valid,px),_mm_andnot_ps(valid,invalid));
+    py = _mm_or_ps(_mm_and_ps(valid,py),_mm_andnot_ps(valid,invalid));
+    pz = _mm_and_ps(valid,pz);
+
+    _mm_storeu_ps(posX,px);
+    _mm_storeu_ps(posY,py);
+    _mm_storeu_ps(posZ,pz);
+}
+
+LOCALMAP_TARGET_SSE2 void ProjectRow16U(const void *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    const unsigned short *dP = (const unsigned short*)depthRow;
+    const __m128 scale = _mm_set1_ps(t.depthScale);
+    const __m128i zero = _mm_setzero_si128();
+
+    int xl = 0;
+    for (; xl+8 <= cols; xl += 8)
+    {
+        const __m128i raw = _mm_loadu_si128((const __m128i*)(dP+xl));
+        const __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(raw,zero)),scale);
+        const __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(raw,zero)),scale);
+
+        Project4(lo,t.colFactor+xl,t,posX+xl,posY+xl,posZ+xl);
+        Project4(hi,t.colFactor+xl+4,t,posX+xl+4,posY+xl+4,posZ+xl+4);
+    }
+
+    for (; xl < cols;++xl)
+    {
+        const float oz = (float)dP[xl]*t.depthScale;
+        const float f = t.colFactor[xl];
+        const bool valid = oz >= t.minDepth;
+        posX[xl] = valid ? oz*(f*t.ax+t.bx)+t.cx : InvalidPos;
+        posY[xl] = valid ? oz*(f*t.ay+t.by)+t.cy : InvalidPos;
+        posZ[xl] = valid ? oz*(f*t.az+t.bz)+t.cz : 0;
+    }
+}
+
+LOCALMAP_TARGET_SSE2 void ProjectRow32F(const void *depthRow, int cols, const RowTransform &t, float *posX, float *posY, float *posZ)
+{
+    const float *dP = (const float*)depthRow;
+    const __m128 scale = _mm_set1_ps(t.depthScale);
+
+    int xl = 0;
+    for (; xl+4 <= cols; xl += 4)
+    {
+        Project4(_mm_mul_ps(_mm_loadu_ps(dP+xl),scale),t.colFactor+xl,t,posX+xl,posY+xl,posZ+xl);
+    }
+
+    for (; xl < cols;++xl)
+    {
+        const float oz = dP[xl]*t.depthScale;
+        const float f = t.colFactor[xl];
+        const bool valid = oz >= t.minDepth;
+        posX[xl] = valid ? oz*(f*t.ax+t.bx)+t.cx : InvalidPos;
+        posY[xl] = valid ? oz*(f*t.ay+t.by)+t.cy : InvalidPos;
+        posZ[xl] = valid ? oz*(f*t.az+t.bz)+t.cz : 0;
+    }
+}
+
+}
+
+bool GetKernelsSSE(Kernels &kernels)
+{
+    kernels.name = "SSE2";
+    kernels.projectRow16U = &SSE::ProjectRow16U;
+    kernels.projectRow32F = &SSE::ProjectRow32F;
+    return true;
+}
+
+#else
+
+bool GetKernelsSSE(Kernels &kernels)
+{
+    (void)kernels;
+    return false;
+}
+
+#endif
+
+}
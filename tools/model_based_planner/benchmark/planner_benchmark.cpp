@@ -0,0 +1,346 @@
+/**
+ * Offline benchmark of all model based planner variants.
+ *
+ * Loads a DEM image, the robot and map descriptions and a path from local files and runs every planner / node expander / scorer combination
+ * for a fixed number of planning cycles. Reports latency percentiles, expanded nodes and evaluated poses per second. Does not need ROS.
+ *
+ * Usage: model_based_planner_benchmark --robot robot.yaml --dem dem.png --path path.txt [options]
+ */
+
+#include <imodelbasedplanner.h>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+const char* const PlannerTypes[] = {"AStar","TreeDWA","DWA"};
+const char* const ExpanderTypes[] = {"angular_vel","angular_vel_rel","linear_angular_vel_rel"};
+const char* const ScorerTypes[] = {"goal_scorer","path_scorer","ngpath_scorer"};
+
+struct BenchmarkOptions
+{
+    BenchmarkOptions():
+        demOrigin(0,0),
+        velocity(0.5f,0),
+        numCycles(100),
+        numWarmupCycles(5),
+        numThreads(1)
+    {}
+
+    std::string robotFile;
+    std::string mapFile;
+    std::string demFile;
+    std::string pathFile;
+    std::string planners;
+    std::string expanders;
+    std::string scorers;
+
+    cv::Point2f demOrigin;
+    cv::Point2f velocity;
+    int numCycles;
+    int numWarmupCycles;
+    int numThreads;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    std::vector<double> latenciesMS;
+    long numNodes;
+    long numPoses;
+    int numValidResults;
+};
+
+
+void PrintUsage(const char *name)
+{
+    std::cout << "Usage: " << name << " --robot <robot.yaml> --dem <dem.png> --path <path.txt> [options]" << std::endl
+              << std::endl
+              << "  --robot <file>       robot description (Robot, Chassis, Wheels and Proc sections)" << std::endl
+              << "  --map <file>         elevation map description (Proc section), default: robot description" << std::endl
+              << "  --dem <file>         DEM image, 16 bit, mapBaseHeight is the ground level" << std::endl
+              << "  --path <file>        path in world coordinates, one \"x y [theta]\" pose per line, the robot starts at the first pose" << std::endl
+              << "  --origin <x,y>       world position of the DEM pixel (0,0), default 0,0" << std::endl
+              << "  --velocity <v,w>     current robot velocity, default 0.5,0" << std::endl
+              << "  --cycles <n>         measured planning cycles per combination, default 100" << std::endl
+              << "  --warmup <n>         unmeasured cycles before, default 5" << std::endl
+              << "  --threads <n>        threads for the trajectory evaluation, default 1" << std::endl
+              << "  --planners <a,b>     planner types, default AStar,TreeDWA,DWA" << std::endl
+              << "  --expanders <a,b>    node expander types, default angular_vel,angular_vel_rel,linear_angular_vel_rel" << std::endl
+              << "  --scorers <a,b>      scorer types, default goal_scorer,path_scorer,ngpath_scorer" << std::endl;
+}
+
+std::vector<std::string> SplitList(const std::string &list)
+{
+    std::vector<std::string> res;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss,item,','))
+    {
+        if (!item.empty()) res.push_back(item);
+    }
+    return res;
+}
+
+bool ParsePoint(const std::string &s, cv::Point2f &p)
+{
+    std::vector<std::string> values = SplitList(s);
+    if (values.size() != 2) return false;
+    p.x = std::atof(values[0].c_str());
+    p.y = std::atof(values[1].c_str());
+    return true;
+}
+
+bool ParseOptions(int argc, char **argv, BenchmarkOptions &opt)
+{
+    for (int tl = 1; tl < argc;++tl)
+    {
+        const std::string arg = argv[tl];
+        if (arg == "-h" || arg == "--help") return false;
+        if (tl+1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+
+        const std::string value = argv[++tl];
+
+        if (arg == "--robot") opt.robotFile = value;
+        else if (arg == "--map") opt.mapFile = value;
+        else if (arg == "--dem") opt.demFile = value;
+        else if (arg == "--path") opt.pathFile = value;
+        else if (arg == "--cycles") opt.numCycles = std::atoi(value.c_str());
+        else if (arg == "--warmup") opt.numWarmupCycles = std::atoi(value.c_str());
+        else if (arg == "--threads") opt.numThreads = std::atoi(value.c_str());
+        else if (arg == "--planners") opt.planners = value;
+        else if (arg == "--expanders") opt.expanders = value;
+        else if (arg == "--scorers") opt.scorers = value;
+        else if (arg == "--origin" && ParsePoint(value,opt.demOrigin)) continue;
+        else if (arg == "--velocity" && ParsePoint(value,opt.velocity)) continue;
+        else
+        {
+            std::cerr << "Invalid option " << arg << " " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (opt.mapFile.empty()) opt.mapFile = opt.robotFile;
+
+    return !opt.robotFile.empty() && !opt.demFile.empty() && !opt.pathFile.empty() && opt.numCycles > 0;
+}
+
+bool ReadPath(const std::string &fileName, std::vector<cv::Point3f> &path)
+{
+    std::ifstream file(fileName.c_str());
+    if (!file.is_open()) return false;
+
+    std::string line;
+    while (std::getline(file,line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream ss(line);
+        cv::Point3f p(0,0,0);
+        if (!(ss >> p.x >> p.y)) continue;
+        if (!(ss >> p.z)) p.z = std::nanf("");
+        path.push_back(p);
+    }
+
+    if (path.size() < 2) return false;
+
+    // missing orientations point to the next pose
+    for (unsigned int tl = 0; tl < path.size();++tl)
+    {
+        if (!std::isnan(path[tl].z)) continue;
+        const cv::Point3f &a = path[tl == path.size()-1 ? tl-1 : tl];
+        const cv::Point3f &b = path[tl == path.size()-1 ? tl : tl+1];
+        path[tl].z = std::atan2(b.y-a.y,b.x-a.x);
+    }
+
+    return true;
+}
+
+double Percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    const int idx = std::min((int)sorted.size()-1,(int)std::ceil(p*(double)sorted.size())-1);
+    return sorted[std::max(0,idx)];
+}
+
+/**
+ * @brief One planning cycle with the same call order as the local planner of the path follower
+ */
+void PlanCycle(IModelBasedPlanner &planner, const BenchmarkOptions &opt, const std::vector<cv::Point3f> &path)
+{
+    planner.SetDEMPos(opt.demOrigin);
+    planner.SetGoalMap(path.back());
+    planner.SetPathMap(path);
+    planner.SetRobotPose(path.front());
+    planner.SetVelocity(opt.velocity);
+    planner.Plan();
+}
+
+bool RunBenchmark(ModelBasedPlannerConfig config, const BenchmarkOptions &opt, const cv::Mat &dem, const std::vector<cv::Point3f> &path, BenchmarkResult &result)
+{
+    IModelBasedPlanner::Ptr planner = IModelBasedPlanner::Create(config);
+    if (planner == nullptr) return false;
+
+    planner->UpdateDEM(dem);
+
+    for (int tl = 0; tl < opt.numWarmupCycles;++tl) PlanCycle(*planner,opt,path);
+
+    result.latenciesMS.clear();
+    result.latenciesMS.reserve(opt.numCycles);
+    result.numNodes = 0;
+    result.numPoses = 0;
+    result.numValidResults = 0;
+
+    std::vector<TrajNode*> nodes;
+
+    for (int tl = 0; tl < opt.numCycles;++tl)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        PlanCycle(*planner,opt,path);
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        result.latenciesMS.push_back(std::chrono::duration<double,std::milli>(end-start).count());
+
+        nodes.clear();
+        planner->GetAllTrajectoryNodes(nodes);
+        result.numNodes += nodes.size();
+        result.numPoses += planner->GetPoseCount();
+
+        Trajectory *traj = planner->GetBLResultTrajectory();
+        if (traj != nullptr && traj->end_ != nullptr) result.numValidResults++;
+    }
+
+    return true;
+}
+
+void PrintResult(const BenchmarkResult &result)
+{
+    std::vector<double> sorted = result.latenciesMS;
+    std::sort(sorted.begin(),sorted.end());
+
+    double totalMS = 0;
+    for (unsigned int tl = 0; tl < sorted.size();++tl) totalMS += sorted[tl];
+    const double totalS = totalMS/1000.0;
+    const double numCycles = (double)sorted.size();
+
+    std::cout << std::left << std::setw(48) << result.name << std::right << std::fixed
+              << std::setprecision(2)
+              << std::setw(9) << Percentile(sorted,0.5)
+              << std::setw(9) << Percentile(sorted,0.9)
+              << std::setw(9) << Percentile(sorted,0.99)
+              << std::setw(9) << sorted.back()
+              << std::setprecision(0)
+              << std::setw(10) << (double)result.numNodes/numCycles
+              << std::setw(12) << (totalS > 0 ? (double)result.numNodes/totalS : 0)
+              << std::setw(12) << (totalS > 0 ? (double)result.numPoses/totalS : 0)
+              << std::setw(7) << result.numValidResults << "/" << sorted.size()
+              << std::endl;
+}
+
+}
+
+
+int main(int argc, char **argv)
+{
+    BenchmarkOptions opt;
+    if (!ParseOptions(argc,argv,opt))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    ModelBasedPlannerConfig config;
+    if (!config.ReadRobotDescription(opt.robotFile))
+    {
+        std::cerr << "Error reading robot description: " << opt.robotFile << std::endl;
+        return 1;
+    }
+    if (!config.ReadMapDescription(opt.mapFile))
+    {
+        std::cerr << "Error reading elevation map description: " << opt.mapFile << std::endl;
+        return 1;
+    }
+    config.plannerConfig_.numThreads = opt.numThreads;
+    config.Setup();
+
+    cv::Mat dem = cv::imread(opt.demFile,-1);
+    if (dem.empty() || dem.channels() != 1)
+    {
+        std::cerr << "Error reading DEM image (single channel expected): " << opt.demFile << std::endl;
+        return 1;
+    }
+
+    std::vector<cv::Point3f> path;
+    if (!ReadPath(opt.pathFile,path))
+    {
+        std::cerr << "Error reading path (at least two poses required): " << opt.pathFile << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> planners = opt.planners.empty() ? std::vector<std::string>(std::begin(PlannerTypes),std::end(PlannerTypes)) : SplitList(opt.planners);
+    std::vector<std::string> expanders = opt.expanders.empty() ? std::vector<std::string>(std::begin(ExpanderTypes),std::end(ExpanderTypes)) : SplitList(opt.expanders);
+    std::vector<std::string> scorers = opt.scorers.empty() ? std::vector<std::string>(std::begin(ScorerTypes),std::end(ScorerTypes)) : SplitList(opt.scorers);
+
+    // the planner falls back to angular_vel for unknown expander names, which would be reported under the requested name
+    for (unsigned int el = 0; el < expanders.size();++el)
+    {
+        if (std::find(std::begin(ExpanderTypes),std::end(ExpanderTypes),expanders[el]) == std::end(ExpanderTypes))
+        {
+            std::cerr << "Unknown node expander type: " << expanders[el] << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "DEM " << dem.cols << "x" << dem.rows << ", path with " << path.size() << " poses, " << opt.numCycles << " cycles, "
+              << opt.numThreads << " thread(s)" << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(48) << "planner / expander / scorer" << std::right
+              << std::setw(9) << "p50 ms" << std::setw(9) << "p90 ms" << std::setw(9) << "p99 ms" << std::setw(9) << "max ms"
+              << std::setw(10) << "nodes" << std::setw(12) << "nodes/s" << std::setw(12) << "poses/s" << std::setw(9) << "valid" << std::endl;
+
+    int numFailed = 0;
+    for (unsigned int pl = 0; pl < planners.size();++pl)
+    {
+        for (unsigned int el = 0; el < expanders.size();++el)
+        {
+            for (unsigned int sl = 0; sl < scorers.size();++sl)
+            {
+                ModelBasedPlannerConfig curConfig = config;
+                curConfig.plannerType_ = planners[pl];
+                curConfig.nodeExpanderType_ = expanders[el];
+                curConfig.scorerType_ = scorers[sl];
+
+                BenchmarkResult result;
+                result.name = planners[pl] + " / " + expanders[el] + " / " + scorers[sl];
+
+                if (!RunBenchmark(curConfig,opt,dem,path,result))
+                {
+                    std::cout << std::left << std::setw(48) << result.name << " unknown planner or scorer type" << std::endl;
+                    numFailed++;
+                    continue;
+                }
+
+                PrintResult(result);
+            }
+        }
+    }
+
+    return numFailed == 0 ? 0 : 1;
+}
@@ -14,6 +14,9 @@ struct ChassisDescriptor
 
     cv::Point2f dirX_, dirY_;
 
+    /// value range of the template including the row padding
+    short minValue_, maxValue_;
+
     CVAlignedMat::ptr image_;
 
 };
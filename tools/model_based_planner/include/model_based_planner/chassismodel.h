@@ -6,6 +6,7 @@
 #include "config_robot.h"
 #include "config_proc.h"
 #include "wheeldescriptor.h"
+#include "dempyramid.h"
 
 
 
@@ -37,6 +38,11 @@ public:
      */
     int EvaluateNP(const cv::Mat &dem,const float &startVal, const float &dx, const float &dy, const cv::Point2f &pos, const int &angleIdx, int &cx, int &cy) const;
 
+    /**
+     * @brief Conservative lower bound of the result of EvaluateNP from the DEM pyramid, false if no bound is available
+     */
+    bool GetLowerBound(const DemPyramid &pyramid,const float &startVal, const float &dx, const float &dy, const cv::Point2f &pos, const int &angleIdx, int &lowerBound) const;
+
     /**
      * @brief True if chassis testing is set
      */
@@ -45,6 +51,11 @@ public:
 
 
 private:
+    /**
+     * @brief Sets the value range of all descriptors, used for the coarse DEM tests
+     */
+    void SetTemplateBounds();
+
     ChassisConfig config_;
     std::vector<ChassisDescriptor> descriptors_;
     cv::Point2f centerPosImg_;
@@ -3,90 +3,163 @@
 
 
 #include "plannerutils.h"
+#include <stdint.h>
 
 
 
 /**
- * @brief Helper class, searches for close points on the given tree level
+ * @brief Closed Set implementation used for A* like search algorithms
+ *
+ * Poses are quantised to cells of maxDist x maxDist x maxRot per tree level, a pose is closed if another pose of the same level already fell into its cell.
+ * The cells are stored in an open addressing hash table. Each entry carries the generation it was written in, Reset() only increments the generation, so clearing is O(1).
+ * Each cell gets a consecutive state id, which is used as index of the open set (NodeHeap).
  */
-class ClosedSetLevel{
+class ClosedSet{
+
 public:
-    std::vector<cv::Point3f> entries_;
 
-    inline float GetDistance(const cv::Point3f &p1, const cv::Point3f &p2)
+    ClosedSet():
+        numHits_(0),
+        cellSizeInv_(1.0f),
+        rotSizeInv_(1.0f),
+        mask_(0),
+        generation_(1),
+        numEntries_(0)
     {
-        return (p1.x-p2.x)*(p1.x-p2.x)+ (p1.y-p2.y)*(p1.y-p2.y);
+        Resize(4096);
     }
 
-    inline bool Test(const cv::Point3f &pose)
+    void Reset()
     {
-        for (int i = 0; i < entries_.size();++i)
+        ++generation_;
+        if (generation_ == 0)
         {
-            if (GetDistance(pose,entries_[i]) < distanceSqrdThresh &&  std::abs(pose.z-entries_[i].z) < rotDiffThresh ) return true;
+            // overflow, old entries could become valid again
+            for (unsigned int tl = 0; tl < table_.size();++tl) table_[tl].generation = 0;
+            generation_ = 1;
         }
-        entries_.push_back(pose);
-        return false;
+
+        numEntries_ = 0;
+        numHits_ = 0;
     }
 
-    void Reset()
+    void Setup(float maxDist, float maxRot)
     {
-        entries_.clear();
+        cellSizeInv_ = 1.0f/maxDist;
+        rotSizeInv_ = 1.0f/maxRot;
+
+        Reset();
     }
 
-    float distanceSqrdThresh, rotDiffThresh;
+    /**
+     * @brief Returns true if the cell of the pose is already closed, otherwise the cell is closed and false is returned
+     */
+    bool Test(const int level, const cv::Point3f &pose)
+    {
+        bool isNew;
+        GetState(level,pose,isNew);
+        return !isNew;
+    }
 
-};
+    /**
+     * @brief Returns the state id of the cell of the pose, new cells get consecutive ids starting at 0 after Reset()
+     */
+    int GetState(const int level, const cv::Point3f &pose, bool &isNew)
+    {
+        const uint64_t key = GetKey(level,pose);
 
+        unsigned int idx = Hash(key);
+        while (table_[idx].generation == generation_)
+        {
+            if (table_[idx].key == key)
+            {
+                numHits_++;
+                isNew = false;
+                return table_[idx].state;
+            }
+            idx = (idx+1) & mask_;
+        }
 
-/**
- * @brief Closed Set implementation used for A* like search algorithms
- */
-class ClosedSet{
+        const int state = numEntries_;
+        table_[idx].key = key;
+        table_[idx].generation = generation_;
+        table_[idx].state = state;
+        ++numEntries_;
 
-public:
+        // keep the load factor below 0.5
+        if (numEntries_*2 > table_.size()) Resize(table_.size()*2);
 
+        isNew = true;
+        return state;
+    }
 
-    void Reset()
-    {
-        for (int tl = 0; tl < levels_.size();++tl)
-        {
+    /**
+     * @brief Number of cells, i.e. state ids, since the last Reset()
+     */
+    int GetNumStates() const {return numEntries_;}
 
-            levels_[tl].Reset();
-        }
+    int numHits_;
 
-        numHits_ = 0;
-    }
+private:
 
-    void Setup(int levels, float maxDist, float maxRot)
+    struct Entry
     {
-        if (levels_.size() != levels)
-        {
-            levels_.clear();
-            for (int tl = 0; tl < levels;++tl)
-            {
-                ClosedSetLevel entry;
+        Entry():
+            key(0),
+            generation(0),
+            state(0)
+        {}
+
+        uint64_t key;
+        unsigned int generation;
+        int state;
+    };
+
+    inline uint64_t GetKey(const int level, const cv::Point3f &pose) const
+    {
+        // orientation is wrapped to [0,2pi), so equal orientations always share a cell
+        const float twoPi = 6.28318530718f;
+        const float rot = pose.z - twoPi*std::floor(pose.z/twoPi);
 
-                entry.distanceSqrdThresh = maxDist*maxDist;
-                entry.rotDiffThresh = maxRot;
+        const uint16_t cx = (uint16_t)(int)std::floor(pose.x*cellSizeInv_);
+        const uint16_t cy = (uint16_t)(int)std::floor(pose.y*cellSizeInv_);
+        const uint16_t cr = (uint16_t)(int)std::floor(rot*rotSizeInv_);
 
-                levels_.push_back(entry);
-            }
-        }
-        else Reset();
+        return ((uint64_t)(uint16_t)level << 48) | ((uint64_t)cr << 32) | ((uint64_t)cx << 16) | (uint64_t)cy;
+    }
 
+    inline unsigned int Hash(uint64_t key) const
+    {
+        key *= 0x9E3779B97F4A7C15ull;
+        return (unsigned int)(key >> 32) & mask_;
     }
 
-    bool Test(const int level, const cv::Point3f &pose)
+    void Resize(unsigned int size)
     {
-        bool res = levels_[level].Test(pose);
-        if (res) numHits_++;
-        return res;
+        std::vector<Entry> oldTable;
+        oldTable.swap(table_);
+
+        table_.resize(size);
+        mask_ = size-1;
+
+        for (unsigned int tl = 0; tl < oldTable.size();++tl)
+        {
+            if (oldTable[tl].generation != generation_) continue;
+
+            unsigned int idx = Hash(oldTable[tl].key);
+            while (table_[idx].generation == generation_) idx = (idx+1) & mask_;
+            table_[idx] = oldTable[tl];
+        }
     }
 
-    std::vector<ClosedSetLevel> levels_;
-    int numHits_;
+    float cellSizeInv_, rotSizeInv_;
+
+    std::vector<Entry> table_;
+    unsigned int mask_;
+    unsigned int generation_;
+    unsigned int numEntries_;
 
 };
 
 
-#endif // CHASSISMODEL_H
+#endif // CLOSEDSET_H
@@ -188,6 +188,8 @@ struct ModelBasedPlannerConfig
         pc.imagePosBLMinY = (float)(n["imagePosBLMinY"]);
         pc.validThresholdFactor = (float)(n["validThresholdFactor"]);
         pc.convertImage = (int)(n["convertImage"]);
+        if (!n["descriptorCacheDir"].empty()) pc.descriptorCacheDir = (std::string)(n["descriptorCacheDir"]);
+        if (!n["useDemPyramid"].empty()) pc.useDemPyramid = (int)(n["useDemPyramid"]) != 0;
 
         pc.Setup();
 
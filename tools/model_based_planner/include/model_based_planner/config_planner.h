@@ -15,6 +15,11 @@ struct PlannerConfig
         lookAheadTime = 2.0;
         trajectoryTimeStep = 0.3;
         subSampleTimeStep = 0.03;
+        numThreads = 1;
+        useClosedSet = true;
+        closedSetDist = 1.0;
+        closedSetRot = 0.0174533;
+        poseBatchSize = 4;
     }
 
     void Setup()
@@ -27,6 +32,11 @@ struct PlannerConfig
     int maxLevel;
     int numSubSamples;
     float lookAheadTime;
+    int numThreads; // threads for the evaluation of child trajectories, 1 = single threaded, <= 0 = one per core
+    bool useClosedSet; // prune nodes that end in an already visited cell of the same level
+    float closedSetDist; // cell size of the closed set in DEM pixels
+    float closedSetRot; // orientation cell size of the closed set in rad
+    int poseBatchSize; // poses of a trajectory evaluated together before scoring, 1 = one pose at a time
 
 
     // calculated
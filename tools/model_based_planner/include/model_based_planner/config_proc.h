@@ -26,6 +26,8 @@ public:
         validThresholdFactor = 0.95;
         wheelSupportThresholdFactor = 1.2;
         convertImage = false;
+        descriptorCacheDir = "";
+        useDemPyramid = true;
 
         Setup();
 
@@ -64,6 +66,12 @@ public:
 
     bool convertImage;
 
+    /// directory of the persistent wheel / chassis descriptor cache, empty disables the cache
+    std::string descriptorCacheDir;
+
+    /// reject / accept poses with a min/max pyramid of the DEM before running the full template matching
+    bool useDemPyramid;
+
 
 //calculated
     float angleStep;
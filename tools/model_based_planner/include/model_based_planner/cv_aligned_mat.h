@@ -20,6 +20,10 @@ public:
     static CVAlignedMat::ptr Create(int width, int height, int cvType){ return std::make_shared< CVAlignedMat >(width,height,cvType) ; }
     static CVAlignedMat::ptr Create(cv::Size imgSize, int cvType){ return std::make_shared< CVAlignedMat >(imgSize,cvType) ; }
     static CVAlignedMat::ptr Create(cv::Mat input){ return std::make_shared< CVAlignedMat >(input) ; }
+    /**
+     * @brief Wraps already aligned external memory without copying, the memory is kept alive by owner and not freed by this object
+     */
+    static CVAlignedMat::ptr CreateView(cv::Mat external, std::shared_ptr<const void> owner){ return std::make_shared< CVAlignedMat >(external,owner) ; }
 
     CVAlignedMat(int width, int height, int cvType)
     {
@@ -42,6 +46,12 @@ public:
         }
     }
 
+    CVAlignedMat(const cv::Mat &external, std::shared_ptr<const void> owner):
+        mat_(external),
+        owner_(owner)
+    {
+    }
+
     void Allocate(int width, int height, int cvType)
     {
         int ByteSize = GetPixelSizeForCVTypes(cvType);
@@ -83,10 +93,12 @@ public:
 
 
     ~CVAlignedMat(){
-        _mm_free((void*)mat_.data);
+        if (owner_ == nullptr) _mm_free((void*)mat_.data);
         //std::cout << "destroyMat!!" << std::endl;
     }
     cv::Mat mat_;
+    /// set if mat_ points into memory owned by another object, e.g. a memory mapped descriptor cache
+    std::shared_ptr<const void> owner_;
 
     int GetPixelSizeForCVTypes(int cvType)
     {
@@ -0,0 +1,75 @@
+#ifndef DEMBUFFER_H
+#define DEMBUFFER_H
+
+#include "cv_aligned_mat.h"
+
+#include <memory>
+#include <cstring>
+
+
+/**
+ * @brief Double buffered, 32-byte aligned DEM storage for a single writer (the DEM callback) and a single reader (the planning thread).
+ *
+ * Write() copies or converts new elevation data into the back buffer and publishes it with an atomic swap, the reader picks up the latest published
+ * buffer with GetFront() without copying. The buffers are reused as long as the DEM size does not change, only the rows of the DEM are written, the
+ * padding at the end of each row stays zero as set by CVAlignedMat::Allocate.
+ * A buffer that is still referenced by the reader (e.g. the DEM the pose estimator is planning on) is never overwritten, a new buffer is allocated instead.
+ */
+class DemBuffer
+{
+public:
+
+    DemBuffer()
+    {
+    }
+
+    /**
+     * @brief Writes dem into the back buffer, converts it to cvType if necessary, and publishes it as the new front buffer. Called by the writer only.
+     */
+    void Write(const cv::Mat &dem, int cvType)
+    {
+        // the back buffer is not published, the only other owner can be the reader that still uses it
+        if (back_ == nullptr || back_.use_count() > 1 || back_->mat_.size() != dem.size() || back_->mat_.type() != cvType)
+        {
+            back_ = CVAlignedMat::Create(dem.size(),cvType);
+        }
+
+        cv::Mat back = back_->mat_;
+
+        if (dem.type() == cvType)
+        {
+            const size_t rowBytes = dem.cols*dem.elemSize();
+            for (int y = 0; y < dem.rows;y++)
+            {
+                memcpy(back.ptr(y),dem.ptr(y),rowBytes);
+            }
+        }
+        else
+        {
+            // size and type match, convertTo writes into the existing buffer
+            dem.convertTo(back,cvType);
+        }
+
+        back_ = std::atomic_exchange(&front_,back_);
+    }
+
+    /**
+     * @brief Returns the latest published buffer, nullptr if nothing was published yet. Called by the reader only.
+     */
+    CVAlignedMat::ptr GetFront() const
+    {
+        return std::atomic_load(&front_);
+    }
+
+private:
+    DemBuffer(const DemBuffer&) = delete;
+    DemBuffer& operator=(const DemBuffer&) = delete;
+
+    /// only accessed with std::atomic_load / std::atomic_exchange
+    CVAlignedMat::ptr front_;
+    /// owned by the writer
+    CVAlignedMat::ptr back_;
+
+};
+
+#endif // DEMBUFFER_H
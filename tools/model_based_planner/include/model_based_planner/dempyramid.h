@@ -0,0 +1,151 @@
+#ifndef DEMPYRAMID_H
+#define DEMPYRAMID_H
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <opencv2/core/core.hpp>
+
+
+/**
+ * @brief Min / max pyramid of a CV_16S DEM, used for conservative bounds of the template matching results
+ *
+ * Level i (1..numLevels) stores the minimum and maximum of each 2^i x 2^i block of the DEM. A rectangle query combines all blocks of a level
+ * that touch the rectangle, so the returned range always contains the values of the rectangle but may be wider.
+ */
+class DemPyramid
+{
+public:
+
+    DemPyramid():
+        numLevels_(0)
+    {
+    }
+
+    /**
+     * @brief Builds the pyramid, has to be called whenever the DEM changes
+     */
+    void Build(const cv::Mat &dem, int numLevels = 6)
+    {
+        numLevels_ = 0;
+        if (dem.empty() || dem.type() != CV_16S) return;
+
+        minLevels_.resize(numLevels);
+        maxLevels_.resize(numLevels);
+
+        cv::Mat srcMin = dem;
+        cv::Mat srcMax = dem;
+
+        for (int level = 0; level < numLevels;++level)
+        {
+            const int rows = (srcMin.rows+1)/2;
+            const int cols = (srcMin.cols+1)/2;
+
+            cv::Mat &dstMin = minLevels_[level];
+            cv::Mat &dstMax = maxLevels_[level];
+            dstMin.create(rows,cols,CV_16S);
+            dstMax.create(rows,cols,CV_16S);
+
+            for (int y = 0; y < rows;++y)
+            {
+                // odd sizes: the last block only covers the existing row / column
+                const int y0 = 2*y;
+                const int y1 = std::min(2*y+1,srcMin.rows-1);
+
+                const short *min0 = srcMin.ptr<short>(y0);
+                const short *min1 = srcMin.ptr<short>(y1);
+                const short *max0 = srcMax.ptr<short>(y0);
+                const short *max1 = srcMax.ptr<short>(y1);
+                short *dMin = dstMin.ptr<short>(y);
+                short *dMax = dstMax.ptr<short>(y);
+
+                for (int x = 0; x < cols;++x)
+                {
+                    const int x0 = 2*x;
+                    const int x1 = std::min(2*x+1,srcMin.cols-1);
+
+                    dMin[x] = std::min(std::min(min0[x0],min0[x1]),std::min(min1[x0],min1[x1]));
+                    dMax[x] = std::max(std::max(max0[x0],max0[x1]),std::max(max1[x0],max1[x1]));
+                }
+            }
+
+            srcMin = dstMin;
+            srcMax = dstMax;
+        }
+
+        demSize_ = dem.size();
+        numLevels_ = numLevels;
+    }
+
+    bool IsValid() const {return numLevels_ > 0;}
+
+    /**
+     * @brief Range of the DEM values inside the rectangle x,y,w,h, false if the pyramid is not built or the rectangle is not completely inside the DEM
+     */
+    inline bool GetMinMax(const int x, const int y, const int w, const int h, int &minV, int &maxV) const
+    {
+        if (numLevels_ == 0 || x < 0 || y < 0 || w <= 0 || h <= 0 || x+w > demSize_.width || y+h > demSize_.height) return false;
+
+        // blocks of at most a quarter of the rectangle size, so the rectangle touches at most 5 blocks per side
+        const int size = std::max(w,h);
+        int level = 1;
+        while (level < numLevels_ && (4 << (level+1)) <= size) ++level;
+
+        const cv::Mat &minL = minLevels_[level-1];
+        const cv::Mat &maxL = maxLevels_[level-1];
+
+        const int cx0 = x >> level;
+        const int cx1 = (x+w-1) >> level;
+        const int cy0 = y >> level;
+        const int cy1 = (y+h-1) >> level;
+
+        short resMin = SHRT_MAX;
+        short resMax = SHRT_MIN;
+
+        for (int cy = cy0; cy <= cy1;++cy)
+        {
+            const short *minP = minL.ptr<short>(cy);
+            const short *maxP = maxL.ptr<short>(cy);
+            for (int cx = cx0; cx <= cx1;++cx)
+            {
+                resMin = std::min(resMin,minP[cx]);
+                resMax = std::max(resMax,maxP[cx]);
+            }
+        }
+
+        minV = resMin;
+        maxV = resMax;
+        return true;
+    }
+
+    /**
+     * @brief Range of all values of a template including the row padding, which is read by the SIMD kernels as well
+     */
+    static void GetTemplateBounds(const cv::Mat &temp, short &minV, short &maxV)
+    {
+        minV = SHRT_MAX;
+        maxV = SHRT_MIN;
+
+        const int stepCols = temp.step/sizeof(short);
+        for (int y = 0; y < temp.rows;++y)
+        {
+            const short *tP = temp.ptr<short>(y);
+            for (int x = 0; x < stepCols;++x)
+            {
+                minV = std::min(minV,tP[x]);
+                maxV = std::max(maxV,tP[x]);
+            }
+        }
+    }
+
+private:
+
+    std::vector<cv::Mat> minLevels_;
+    std::vector<cv::Mat> maxLevels_;
+    cv::Size demSize_;
+    int numLevels_;
+
+};
+
+
+#endif // DEMPYRAMID_H
@@ -0,0 +1,66 @@
+#ifndef DESCRIPTORCACHE_H
+#define DESCRIPTORCACHE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "wheeldescriptor.h"
+#include "chassisdescriptor.h"
+#include "config_robot.h"
+#include "config_proc.h"
+
+
+/**
+ * @brief Persistent cache of rendered wheel and chassis descriptors
+ *
+ * Rendering the descriptors of all orientations is expensive, so the result is stored in one binary file per wheel / chassis type.
+ * The file name contains a hash of all parameters that influence the rendered templates. On load the file is memory mapped and
+ * the descriptor images point directly into the mapping, the template data is stored with the padded row stride and 64-byte aligned.
+ *
+ * The cache is disabled if the directory is empty. Invalid or outdated files are ignored and overwritten.
+ */
+class DescriptorCache
+{
+public:
+
+    /**
+     * @brief Hash of all parameters used by WheelModel::SetupWheel for rendering
+     */
+    static uint64_t HashWheel(const ProcConfig &procConfig, const WheelConfig &conf);
+
+    /**
+     * @brief Hash of all parameters used by ChassisModel::SetupChassis for rendering, includes size and modification time of the chassis image
+     */
+    static uint64_t HashChassis(const ProcConfig &procConfig, const ChassisConfig &conf);
+
+    static bool Load(const std::string &directory, uint64_t hash, std::vector<WheelDescriptor> &descriptors);
+    static bool Load(const std::string &directory, uint64_t hash, std::vector<ChassisDescriptor> &descriptors);
+
+    static bool Save(const std::string &directory, uint64_t hash, const std::vector<WheelDescriptor> &descriptors);
+    static bool Save(const std::string &directory, uint64_t hash, const std::vector<ChassisDescriptor> &descriptors);
+
+private:
+
+    /// Everything of a wheel or chassis descriptor except for the image data
+    struct Record
+    {
+        float centerX, centerY;
+        float jointPosX, jointPosY;
+        float dirXx, dirXy;
+        float dirYx, dirYy;
+        float numImagePixelsInv;
+        int32_t numImagePixels;
+
+        int32_t rows, cols, type, step;
+        uint64_t offset;
+    };
+
+    static std::string GetFileName(const std::string &directory, const char *kind, uint64_t hash);
+
+    static bool LoadRecords(const std::string &fileName, uint64_t hash, std::vector<Record> &records, std::vector<CVAlignedMat::ptr> &images);
+    static bool SaveRecords(const std::string &directory, const std::string &fileName, uint64_t hash, const std::vector<Record> &records, const std::vector<cv::Mat> &images);
+
+};
+
+#endif // DESCRIPTORCACHE_H
@@ -29,12 +29,14 @@ public:
 
 
     /**
-     * @brief Set the current DEM for path planning
+     * @brief Set the DEM for the next Plan() call, the DEM is copied (converted to CV_16S if necessary) into a reused aligned buffer.
+     *
+     * May be called from the thread that receives the elevation maps while another thread plans, the DEM is picked up at the start of the next Plan().
      */
     virtual void UpdateDEM(const cv::Mat &dem) = 0;
 
     /**
-     * @brief Get the current DEM
+     * @brief Get the DEM used by the last Plan() call
      */
     virtual const cv::Mat GetDem() = 0;
 
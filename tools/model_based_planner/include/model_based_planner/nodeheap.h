@@ -0,0 +1,158 @@
+#ifndef NODEHEAP_H
+#define NODEHEAP_H
+
+#include <vector>
+#include <algorithm>
+#include "plannerutils.h"
+
+
+/**
+ * @brief Indexed max-heap of trajectory nodes for the open set of A* like search algorithms
+ *
+ * Each entry belongs to a state id (e.g. a closed set cell), a state holds at most one node. Pushing a better node for an open state replaces the node
+ * and moves the entry up (decrease-key), states that were already popped are closed and ignore further nodes.
+ * The storage is allocated once with SetCapacity(), Clear() only resets the used states and keeps the memory.
+ */
+class NodeHeap
+{
+public:
+
+    NodeHeap():
+        numStates_(0)
+    {
+    }
+
+    /**
+     * @brief Preallocates the heap for state ids 0..capacity-1, larger ids are still accepted but reallocate
+     */
+    void SetCapacity(int capacity)
+    {
+        heap_.reserve(capacity);
+        if ((int)positions_.size() < capacity)
+        {
+            positions_.resize(capacity,StateUnknown);
+            nodes_.resize(capacity,nullptr);
+        }
+    }
+
+    void Clear()
+    {
+        std::fill(positions_.begin(),positions_.begin()+numStates_,(int)StateUnknown);
+        heap_.clear();
+        numStates_ = 0;
+    }
+
+    inline bool Empty() const {return heap_.empty();}
+    inline int Size() const {return heap_.size();}
+
+    /**
+     * @brief Inserts node for state. Returns false if the state is closed or already holds a node with a higher or equal score
+     */
+    bool Push(int state, TrajNode* node)
+    {
+        if (state >= (int)positions_.size()) SetCapacity(std::max(state+1,(int)positions_.size()*2));
+        numStates_ = std::max(numStates_,state+1);
+
+        const int pos = positions_[state];
+        if (pos == StateClosed) return false;
+
+        if (pos == StateUnknown)
+        {
+            heap_.push_back(Entry(node->fScore_,state));
+            positions_[state] = heap_.size()-1;
+            nodes_[state] = node;
+            SiftUp(heap_.size()-1);
+            return true;
+        }
+
+        if (node->fScore_ <= heap_[pos].fScore) return false;
+
+        heap_[pos].fScore = node->fScore_;
+        nodes_[state] = node;
+        SiftUp(pos);
+        return true;
+    }
+
+    inline TrajNode* Top() const
+    {
+        return nodes_[heap_[0].state];
+    }
+
+    /**
+     * @brief Removes and returns the node with the highest score, its state is closed
+     */
+    TrajNode* Pop()
+    {
+        const int state = heap_[0].state;
+        positions_[state] = StateClosed;
+
+        const Entry last = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty())
+        {
+            heap_[0] = last;
+            positions_[last.state] = 0;
+            SiftDown(0);
+        }
+
+        return nodes_[state];
+    }
+
+private:
+
+    enum {StateUnknown = -1, StateClosed = -2};
+
+    struct Entry
+    {
+        Entry(float score, int s):
+            fScore(score),
+            state(s)
+        {}
+
+        float fScore;
+        int state;
+    };
+
+    inline void SiftUp(int pos)
+    {
+        const Entry entry = heap_[pos];
+        while (pos > 0)
+        {
+            const int parent = (pos-1)/2;
+            if (!(heap_[parent].fScore < entry.fScore)) break;
+            heap_[pos] = heap_[parent];
+            positions_[heap_[pos].state] = pos;
+            pos = parent;
+        }
+        heap_[pos] = entry;
+        positions_[entry.state] = pos;
+    }
+
+    inline void SiftDown(int pos)
+    {
+        const Entry entry = heap_[pos];
+        const int size = heap_.size();
+        while (true)
+        {
+            int child = 2*pos+1;
+            if (child >= size) break;
+            if (child+1 < size && heap_[child].fScore < heap_[child+1].fScore) ++child;
+            if (!(entry.fScore < heap_[child].fScore)) break;
+            heap_[pos] = heap_[child];
+            positions_[heap_[pos].state] = pos;
+            pos = child;
+        }
+        heap_[pos] = entry;
+        positions_[entry.state] = pos;
+    }
+
+    std::vector<Entry> heap_;
+    /// heap position per state, or StateUnknown / StateClosed
+    std::vector<int> positions_;
+    std::vector<TrajNode*> nodes_;
+    int numStates_;
+
+};
+
+
+#endif // NODEHEAP_H
@@ -0,0 +1,268 @@
+#ifndef PATHDISTANCEFIELD_H
+#define PATHDISTANCEFIELD_H
+
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <opencv2/core/core.hpp>
+
+
+
+/**
+ * @brief Closest path segment for each cell of a grid around the robot, used to look up the distance of a pose to the reference path in O(1)
+ *
+ * The grid is aligned with the DEM pixels and covers a square around the robot. Cells on the path and on the border of the grid are initialized with their
+ * exact closest segment, the other cells get the closest segment of their neighbours in a forward and a backward sweep.
+ * A lookup computes the exact distance to the stored segments of the cell and its 8 neighbours. Poses outside of the grid use the linear search over all segments.
+ */
+class PathDistanceField
+{
+public:
+
+    PathDistanceField():
+        width_(0),
+        height_(0),
+        originX_(0),
+        originY_(0),
+        cellSize_(1),
+        cellSizeInv_(1.0f),
+        changed_(false)
+    {
+    }
+
+    /**
+     * @brief Sets the path, the field is invalid until Setup() is called. Setting the same path again keeps the field
+     */
+    void SetPath(const std::vector<cv::Point2f> &path)
+    {
+        if (path == path_) return;
+        path_ = path;
+        width_ = 0;
+        height_ = 0;
+    }
+
+    /**
+     * @brief Builds the field for a square of size 2*radius around center, with about maxCells cells per side
+     */
+    void Setup(const cv::Point2f &center, float radius, int maxCells = 128)
+    {
+        width_ = 0;
+        height_ = 0;
+        if (path_.size() < 2 || radius <= 0) return;
+
+        cellSize_ = std::max(1,(int)std::ceil(2.0f*radius/(float)maxCells));
+        cellSizeInv_ = 1.0f/(float)cellSize_;
+        originX_ = (int)std::floor(center.x - radius);
+        originY_ = (int)std::floor(center.y - radius);
+        width_ = (int)std::ceil(2.0f*radius*cellSizeInv_)+1;
+        height_ = width_;
+
+        closest_.assign(width_*height_,-1);
+        cellDist_.assign(width_*height_,std::numeric_limits<float>::max());
+
+        // cells on the path
+        for (int seg = 1; seg < (int)path_.size();++seg)
+        {
+            const cv::Point2f a = path_[seg-1];
+            const cv::Point2f d = path_[seg]-a;
+            const int numSamples = (int)std::ceil(std::sqrt(d.dot(d))*cellSizeInv_*2.0f)+1;
+
+            for (int s = 0; s <= numSamples;++s)
+            {
+                const cv::Point2f p = a + d*((float)s/(float)numSamples);
+                int cx,cy;
+                if (!GetCell(p,cx,cy)) continue;
+                Update(cx,cy,seg);
+            }
+        }
+
+        // border cells
+        for (int x = 0; x < width_;++x)
+        {
+            Update(x,0,LinearSearch(CellCenter(x,0)));
+            Update(x,height_-1,LinearSearch(CellCenter(x,height_-1)));
+        }
+        for (int y = 1; y < height_-1;++y)
+        {
+            Update(0,y,LinearSearch(CellCenter(0,y)));
+            Update(width_-1,y,LinearSearch(CellCenter(width_-1,y)));
+        }
+
+        // alternating sweeps until no cell changes
+        for (int pass = 0; pass < 4;++pass)
+        {
+            changed_ = false;
+
+            for (int y = 0; y < height_;++y)
+            {
+                for (int x = 0; x < width_;++x)
+                {
+                    Propagate(x,y,x-1,y);
+                    Propagate(x,y,x-1,y-1);
+                    Propagate(x,y,x,y-1);
+                    Propagate(x,y,x+1,y-1);
+                }
+            }
+
+            for (int y = height_-1; y >= 0;--y)
+            {
+                for (int x = width_-1; x >= 0;--x)
+                {
+                    Propagate(x,y,x+1,y);
+                    Propagate(x,y,x+1,y+1);
+                    Propagate(x,y,x,y+1);
+                    Propagate(x,y,x-1,y+1);
+                }
+            }
+
+            if (!changed_) break;
+        }
+    }
+
+    /**
+     * @brief True if all points within radius of center are looked up in the field and not by the linear search
+     */
+    bool Covers(const cv::Point2f &center, float radius) const
+    {
+        if (width_ == 0) return path_.size() < 2;
+
+        int x0,y0,x1,y1;
+        GetCell(center-cv::Point2f(radius,radius),x0,y0);
+        GetCell(center+cv::Point2f(radius,radius),x1,y1);
+        return x0 > 0 && y0 > 0 && x1 < width_-1 && y1 < height_-1;
+    }
+
+    /**
+     * @brief Minimum distance of p to the path, 0 if the path is empty
+     */
+    inline float GetMinDistance(const cv::Point2f &p) const
+    {
+        if (path_.empty()) return 0;
+
+        int cx,cy;
+        if (GetCell(p,cx,cy) && cx > 0 && cy > 0 && cx < width_-1 && cy < height_-1)
+        {
+            // the closest segment of p is the closest segment of the cell or of one of its neighbours, up to a fraction of the cell size
+            float dist = std::numeric_limits<float>::max();
+            int lastSeg = -1;
+            for (int y = cy-1; y <= cy+1;++y)
+            {
+                const int* segP = &closest_[y*width_+cx-1];
+                for (int x = 0; x < 3;++x)
+                {
+                    const int seg = segP[x];
+                    if (seg == lastSeg) continue;
+                    lastSeg = seg;
+                    dist = std::min(dist,SqDistanceToSegment(seg,p));
+                }
+            }
+            return std::sqrt(dist);
+        }
+
+        float curDis = 99999999999.0f;
+        for (unsigned int tl = 1; tl < path_.size();++tl)
+        {
+            float tdis = SqDistanceToSegment(tl,p);
+            if (tdis < curDis) curDis = tdis;
+        }
+        return std::sqrt(curDis);
+    }
+
+    static inline float SqDistancePtSegment(const cv::Point2f &a, const cv::Point2f &b, const cv::Point2f &p )
+    {
+        cv::Point2f n = b - a;
+        cv::Point2f pa = a - p;
+
+        float c = n.dot( pa );
+
+        // Closest point is a
+        if ( c > 0.0f )
+            return pa.dot(  pa );
+
+        cv::Point2f bp = p - b;
+
+        // Closest point is b
+        if ( n.dot( bp ) > 0.0f )
+            return bp.dot( bp );
+
+        // Closest point is between a and b
+        cv::Point2f e = pa - n * (c / n.dot( n ));
+
+        return e.dot( e );
+    }
+
+private:
+
+    inline float SqDistanceToSegment(int seg, const cv::Point2f &p) const
+    {
+        return SqDistancePtSegment(path_[seg-1],path_[seg],p);
+    }
+
+    inline bool GetCell(const cv::Point2f &p, int &cx, int &cy) const
+    {
+        cx = (int)std::floor((p.x-(float)originX_)*cellSizeInv_);
+        cy = (int)std::floor((p.y-(float)originY_)*cellSizeInv_);
+        return cx >= 0 && cy >= 0 && cx < width_ && cy < height_;
+    }
+
+    inline cv::Point2f CellCenter(int cx, int cy) const
+    {
+        return cv::Point2f((float)originX_+((float)cx+0.5f)*(float)cellSize_,(float)originY_+((float)cy+0.5f)*(float)cellSize_);
+    }
+
+    int LinearSearch(const cv::Point2f &p) const
+    {
+        int best = 1;
+        float curDis = std::numeric_limits<float>::max();
+        for (int tl = 1; tl < (int)path_.size();++tl)
+        {
+            const float tdis = SqDistanceToSegment(tl,p);
+            if (tdis < curDis)
+            {
+                curDis = tdis;
+                best = tl;
+            }
+        }
+        return best;
+    }
+
+    inline void Update(int cx, int cy, int seg)
+    {
+        const int idx = cy*width_+cx;
+        if (closest_[idx] == seg) return;
+
+        const float dist = SqDistanceToSegment(seg,CellCenter(cx,cy));
+        if (dist < cellDist_[idx])
+        {
+            cellDist_[idx] = dist;
+            closest_[idx] = seg;
+            changed_ = true;
+        }
+    }
+
+    inline void Propagate(int cx, int cy, int nx, int ny)
+    {
+        if (nx < 0 || ny < 0 || nx >= width_ || ny >= height_) return;
+        const int seg = closest_[ny*width_+nx];
+        if (seg > 0) Update(cx,cy,seg);
+    }
+
+    std::vector<cv::Point2f> path_;
+
+    /// index of the closest segment (end point index) per cell
+    std::vector<int> closest_;
+    /// squared distance of the cell center to its closest segment, only used during Setup()
+    std::vector<float> cellDist_;
+
+    int width_, height_;
+    int originX_, originY_;
+    int cellSize_;
+    float cellSizeInv_;
+    bool changed_;
+
+};
+
+
+#endif // PATHDISTANCEFIELD_H
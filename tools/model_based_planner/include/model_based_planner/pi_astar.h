@@ -3,13 +3,13 @@
 
 
 #include "plannertraj.h"
-#ifdef USE_CLOSED_SET
 #include "closedset.h"
-#endif
 
 
 /**
- * @brief Implementation of the A*-like planner. The closed set can be disabled of the expander parameters do not produce nodes that are close enough. This saves some computation time
+ * @brief Implementation of the A*-like planner. The closed set can be disabled (PlannerConfig::useClosedSet) if the expander parameters do not produce nodes that are close enough
+ *
+ * With the closed set, each closed set cell is one state of the open set: a better node ending in a cell that is not expanded yet replaces the open node of the cell.
  */
 template <typename TS>
 class PI_AStar : public PlannerTraj<TS>
@@ -22,6 +22,8 @@ public:
     using TB::openSet_;
     using TB::config_;
     using TB::CreateTrajectory;
+    using TB::CreateTrajectories;
+    using TB::newNodes_;
     using TB::bestScore_;
     using TB::bestNode_;
     using TB::GetStartNode;
@@ -37,7 +39,8 @@ public:
 
 
 
-    PI_AStar()
+    PI_AStar():
+        numStates_(0)
     {
 
     }
@@ -47,46 +50,55 @@ public:
         return config_.plannerConfig_.maxSearchIterations;
     }
 
-    void IterateStar(TrajNode* start)
+    /**
+     * @brief State id of a node in the open set, without closed set each node is a state of its own
+     */
+    inline int GetState(TrajNode* node)
     {
+        if (!config_.plannerConfig_.useClosedSet) return numStates_++;
+
+        bool isNew;
+        return closedSet_.GetState(node->level_,node->end_->pose,isNew);
+    }
 
-        openSet_.push(start);
+    void IterateStar(TrajNode* start)
+    {
+        numStates_ = 0;
+        openSet_.Push(GetState(start),start);
 
 
 
         for (int tl = 0; tl < config_.plannerConfig_.maxSearchIterations;++tl)
         {
-            if (openSet_.empty()) break;
-            TrajNode* curNode = openSet_.top();
-            openSet_.pop();
+            if (openSet_.Empty()) break;
+            TrajNode* curNode = openSet_.Pop();
 
             //const int numSplits = expander_.GetNumberChildren(curNode->level_);
 
             const int numSplits = expander_->Expand(curNode->level_, curNode->endCmd_,tempCmds_);
 
-            for (int i = 0; i < numSplits;++i)
+            const int numCreated = CreateTrajectories(curNode,tempCmds_,numSplits,newNodes_);
+
+            for (int i = 0; i < numCreated;++i)
             {
-                if (!NextNodeAvailable()) return;
-                TrajNode* newNode = CreateTrajectory(curNode,tempCmds_[i]);
+                TrajNode* newNode = newNodes_[i];
                 scorer_.FinalNodeScore(*newNode);
 
-#ifdef USE_CLOSED_SET
-                if (newNode->validState_ >= 0 && newNode->level_ < config_.plannerConfig_.maxLevel && !closedSet_.Test(newNode->level_,newNode->end_->pose)) openSet_.push(newNode);
-#else
-                if (newNode->validState_ >= 0 && newNode->level_ < config_.plannerConfig_.maxLevel) openSet_.push(newNode);
+                if (newNode->validState_ < 0 || newNode->level_ >= config_.plannerConfig_.maxLevel) continue;
 
-#endif
+                openSet_.Push(GetState(newNode),newNode);
 
             }
 
+            /// out of nodes
+            if (numCreated < numSplits) return;
 
         }
 
         /// TODO: test if no sub optimal paths are chosen
-        while (!openSet_.empty())
+        while (!openSet_.Empty())
         {
-            TrajNode* curNode = openSet_.top();
-            openSet_.pop();
+            TrajNode* curNode = openSet_.Pop();
 
             //leaves_.push_back(&out);
             if (curNode->fScore_ > bestScore_)
@@ -102,14 +114,13 @@ public:
 
     cv::Point2f Plan()
     {
+        TakeDEM();
 
         ClearPrioQueue();
 
         TrajNode *startNode = GetStartNode();
 
-#ifdef USE_CLOSED_SET
-        closedSet_.Setup(config_.plannerConfig_.maxLevel,1.0,0.0174533);
-#endif
+        if (config_.plannerConfig_.useClosedSet) closedSet_.Setup(config_.plannerConfig_.closedSetDist,config_.plannerConfig_.closedSetRot);
         IterateStar(startNode);
 
         FinishedPlanning();
@@ -119,9 +130,8 @@ public:
 
     }
 
-#ifdef USE_CLOSED_SET
     ClosedSet closedSet_;
-#endif
+    int numStates_;
 
 };
 
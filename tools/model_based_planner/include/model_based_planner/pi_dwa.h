@@ -19,6 +19,8 @@ public:
     typedef PlannerTraj<TS> TB;
     using TB::config_;
     using TB::CreateTrajectory;
+    using TB::CreateTrajectories;
+    using TB::newNodes_;
     using TB::bestScore_;
     using TB::GetStartNode;
     using TB::scorer_;
@@ -43,6 +45,7 @@ public:
 
     cv::Point2f Plan()
     {        
+        TakeDEM();
 
         config_.plannerConfig_.maxLevel = 1;
         TrajNode *startNode = GetStartNode();
@@ -50,11 +53,7 @@ public:
 
         const int numSplits = expander_->Expand(0,startNode->endCmd_,tempCmds_);
 
-        for (int i = 0; i < numSplits;++i)
-        {
-            CreateTrajectory(startNode,tempCmds_[i]);
-
-        }
+        CreateTrajectories(startNode,tempCmds_,numSplits,newNodes_);
 
         FinishedPlanning();
 
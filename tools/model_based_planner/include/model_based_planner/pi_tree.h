@@ -3,16 +3,12 @@
 
 
 #include "plannertraj.h"
-
-//#define USE_CLOSED_SET 1
-#ifdef USE_CLOSED_SET
 #include "closedset.h"
-#endif
 
 
 
 /**
- * @brief Depth first search implementation, The closed set can be disabled of the expander parameters do not produce nodes that are close enough. This saves some computation time.
+ * @brief Depth first search implementation, The closed set can be disabled (PlannerConfig::useClosedSet) if the expander parameters do not produce nodes that are close enough.
  */
 template <typename TS>
 class PI_Tree : public PlannerTraj< TS>
@@ -24,6 +20,7 @@ public:
     typedef PlannerTraj< TS> TB;
     using TB::config_;
     using TB::CreateTrajectory;
+    using TB::CreateTrajectories;
     using TB::bestScore_;
     using TB::GetStartNode;
     using TB::scorer_;
@@ -78,25 +75,15 @@ public:
 
         if (start->level_ >= config_.plannerConfig_.maxLevel) return;
         if (start->validState_ < 0) return;
-#ifdef USE_CLOSED_SET
-        if (closedSet_.Test(start->level_,start->end_->pose)) return;
-#endif
+        if (config_.plannerConfig_.useClosedSet && closedSet_.Test(start->level_,start->end_->pose)) return;
 
         const int numSplits = expander_->Expand(start->level_,start->endCmd_,tempCmds_);
 
-        std::vector<TrajNode*> newNodes(numSplits);
-
-
-        for (int i = 0; i < numSplits;++i)
-        {
-            TrajNode* newNode = CreateTrajectory(start, tempCmds_[i]);
+        std::vector<TrajNode*> newNodes;
 
-            newNodes[i] = newNode;
+        const int numCreated = CreateTrajectories(start,tempCmds_,numSplits,newNodes);
 
-
-
-        }
-        for (int i = 0; i < numSplits;++i)
+        for (int i = 0; i < numCreated;++i)
         {
              IterateTree(newNodes[i]);
 
@@ -110,11 +97,10 @@ public:
 
     cv::Point2f Plan()
     {
+        TakeDEM();
 
         TrajNode *startNode = GetStartNode();
-#ifdef USE_CLOSED_SET
-        closedSet_.Setup(config_.plannerConfig_.maxLevel,1.0,0.0174533);
-#endif
+        if (config_.plannerConfig_.useClosedSet) closedSet_.Setup(config_.plannerConfig_.closedSetDist,config_.plannerConfig_.closedSetRot);
 
         IterateTree(startNode);
 
@@ -125,9 +111,7 @@ public:
     }
 
 
-#ifdef USE_CLOSED_SET
     ClosedSet closedSet_;
-#endif
 
 };
 
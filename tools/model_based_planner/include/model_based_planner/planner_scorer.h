@@ -6,6 +6,7 @@
 #include <memory>
 #include <config_planner.h>
 #include "utils_math_approx.h"
+#include "pathdistancefield.h"
 
 
 
@@ -417,6 +418,7 @@ struct NodeScorer_Path_T : public NodeScorer_Goal_T
         {
             path_.clear();
             path2_.clear();
+            pathField_.SetPath(path2_);
             return;
 
         }
@@ -428,6 +430,7 @@ struct NodeScorer_Path_T : public NodeScorer_Goal_T
         {
             path2_.push_back(cv::Point2f(path[tl].x,path[tl].y));
         }
+        pathField_.SetPath(path2_);
 
 
     }
@@ -456,23 +459,26 @@ struct NodeScorer_Path_T : public NodeScorer_Goal_T
         return e.dot( e );
     }
 
-    inline float GetMinPathDistance(const cv::Point3f p3)const
+    void SetRobotPose(cv::Point3f robotPose, float goalDistanceCutoff)
     {
-        if (path2_.empty()) return 0;
-
-        cv::Point2f p(p3.x,p3.y);
-
-        float curDis = 99999999999.0f;
+        NodeScorer_Goal_T::SetRobotPose(robotPose,goalDistanceCutoff);
 
-        for (unsigned int tl = 1; tl < path2_.size();++tl)
+        // all end poses of this planning cycle are within the cutoff distance of the robot, the field is only rebuilt
+        // if the path changed or the robot left the area around the pose the field was built for
+        const cv::Point2f center(robotPose.x,robotPose.y);
+        if (!pathField_.Covers(center,goalDistanceCutoff*1.2f))
         {
-            float tdis = SqDistancePtSegment(path2_[tl-1],path2_[tl],p);
-            if (tdis < curDis) curDis = tdis;
+            pathField_.Setup(center,goalDistanceCutoff*2.4f);
         }
-        return sqrt(curDis);
+    }
 
+    inline float GetMinPathDistance(const cv::Point3f p3)const
+    {
+        return pathField_.GetMinDistance(cv::Point2f(p3.x,p3.y));
     }
 
+    PathDistanceField pathField_;
+
     inline void ScoreNode(TrajNode &current)  const
     {
         float velDiff = 0;
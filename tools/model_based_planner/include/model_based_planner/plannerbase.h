@@ -8,6 +8,8 @@
 #include "poseestimator.h"
 #include "plannerutils.h"
 #include "planner_scorer.h"
+#include "dembuffer.h"
+#include "nodeheap.h"
 
 #include <imodelbasedplanner.h>
 #include <set>
@@ -64,8 +66,17 @@ public:
 
     void UpdateDEM(const cv::Mat &dem)
     {
-        poseEstimator_.SetDem(dem);
+        demBuffer_.Write(dem,CV_16S);
     }
+    /**
+     * @brief Hands the latest DEM published by UpdateDEM() to the pose estimator, called at the start of planning
+     */
+    void TakeDEM()
+    {
+        CVAlignedMat::ptr front = demBuffer_.GetFront();
+        if (front != nullptr && front != poseEstimator_.GetDemPtr()) poseEstimator_.SetDem(front);
+    }
+
     const cv::Mat GetDem()
     {
         return poseEstimator_.GetDEM();
@@ -185,8 +196,9 @@ public:
         //leaves_.reserve(maxNumNodes);
 
         curNodeIdx_ = 0;
-        //openSet_.clear();
-        openSet_ = prio_queue();
+        // every state holds at least one node, so the number of nodes bounds the number of states
+        openSet_.SetCapacity(GetNumberNodes());
+        openSet_.Clear();
 
         tempCmds_.resize(GetNumberSplits());
     }
@@ -194,7 +206,7 @@ public:
 
     inline void ClearPrioQueue()
     {
-        openSet_ = prio_queue();
+        openSet_.Clear();
     }
 
 
@@ -264,6 +276,9 @@ protected:
     PoseEstimator poseEstimator_;
     //PlannerConfig plannerConfig_;
 
+    /// Reused aligned DEM buffers, written by UpdateDEM(), the pose estimator uses the front buffer taken by TakeDEM()
+    DemBuffer demBuffer_;
+
     cv::Point2f curVelocity_;
     cv::Point3f curRobotPose_;
 
@@ -274,8 +289,7 @@ protected:
     cv::Point3f goal_;
 
 
-    typedef std::priority_queue<TrajNode*, std::vector<TrajNode*>,CompareTNode> prio_queue;
-    prio_queue openSet_;
+    NodeHeap openSet_;
 
     //PlannerScorerConfig scorerConig_;
     float bestScore_;
@@ -4,9 +4,11 @@
 
 #include "plannerbase.h"
 #include "planner_nodeexpander.h"
+#include "workerpool.h"
 
 #include <set>
 #include <queue>
+#include <algorithm>
 
 /**
  * @brief Planner base class with templates for expander and scorer
@@ -47,6 +49,24 @@ public:
 
         expander_->SetConfig(config_.expanderConfig_,config_.procConfig_.pixelSize);
         scorer_.SetConfig(config_.scorerConfig_, config_.procConfig_.validThreshold,config_.procConfig_.notVisibleThreshold, config_.plannerConfig_.subSampleTimeStep);
+
+        SetupWorkerPool(config_.plannerConfig_.numThreads);
+    }
+
+    /**
+     * @brief Use numThreads threads for the evaluation of child trajectories, 1 disables the worker pool, <= 0 uses one thread per core
+     */
+    void SetupWorkerPool(int numThreads)
+    {
+        if (numThreads == 1)
+        {
+            workerPool_.reset();
+            return;
+        }
+        if (workerPool_ != nullptr && numThreads > 0 && workerPool_->GetNumThreads() == numThreads) return;
+
+        workerPool_ = WorkerPool::Create(numThreads);
+        if (workerPool_->GetNumThreads() < 2) workerPool_.reset();
     }
 
     void SetPlannerParameters(PlannerConfig &config)
@@ -145,15 +165,61 @@ public:
     }
 
 
+    /**
+     * @brief Create and evaluate a single child trajectory of prev
+     */
     TrajNode* CreateTrajectory(TrajNode* prev, const cv::Point2f &cmd)
     {
+        TrajNode* out = InitTrajectory(prev,cmd);
+        EvaluateTrajectory(*out);
+        FinishTrajectory(*out);
+        return out;
+    }
 
-        float curStep = config_.plannerConfig_.subSampleTimeStep;
+    /**
+     * @brief Create the child trajectories of prev for the first numCmds commands in cmds, limited by the number of available nodes.
+     * The nodes are taken from allNodes_ in the order of the commands and the best node is updated in the same order,
+     * so the result does not depend on the number of threads. Only the pose evaluation is distributed to the worker pool.
+     * @return the number of created nodes
+     */
+    int CreateTrajectories(TrajNode* prev, const std::vector<cv::Point2f> &cmds, int numCmds, std::vector<TrajNode*> &nodes)
+    {
+        numCmds = std::min(numCmds,(int)allNodes_.size()-curNodeIdx_);
+        if (numCmds <= 0) return 0;
 
-        cv::Point3f curP = prev->end_->pose;
+        nodes.resize(numCmds);
 
-        TrajNode &out = *GetNextNode();
+        for (int i = 0; i < numCmds;++i)
+        {
+            nodes[i] = InitTrajectory(prev,cmds[i]);
+        }
+
+        if (workerPool_ != nullptr)
+        {
+            workerPool_->ParallelFor(numCmds,[this,&nodes](int i){ EvaluateTrajectory(*nodes[i]); });
+        }
+        else
+        {
+            for (int i = 0; i < numCmds;++i) EvaluateTrajectory(*nodes[i]);
+        }
+
+        for (int i = 0; i < numCmds;++i)
+        {
+            FinishTrajectory(*nodes[i]);
+        }
 
+        return numCmds;
+    }
+
+
+protected:
+
+    /**
+     * @brief Take the next free node and connect it to prev
+     */
+    TrajNode* InitTrajectory(TrajNode* prev, const cv::Point2f &cmd)
+    {
+        TrajNode &out = *GetNextNode();
 
         out.SetParent(prev);
 
@@ -162,21 +228,50 @@ public:
         out.endCmd_ = cmd;
         out.validState_ = TN_VS_VALID;
 
+        return &out;
+    }
+
+    /**
+     * @brief Evaluate the poses of the trajectory, only writes to out and can be run in parallel for different nodes
+     */
+    void EvaluateTrajectory(TrajNode &out)
+    {
+        float curStep = config_.plannerConfig_.subSampleTimeStep;
+
+        const cv::Point2f cmd = out.startCmd_;
+        const cv::Point3f curP = out.start_->pose;
 
-        PoseEvalResults *prevPER = prev->end_;
+        PoseEvalResults *prevPER = out.start_;
 
         cv::Vec4f wheelAnglesRobot = poseEstimator_.robotModel_.GetWheelAnglesRobot(cmd);
 
+        const int numSubSamples = config_.plannerConfig_.numSubSamples;
+        const int batchSize = std::max(1,config_.plannerConfig_.poseBatchSize);
+        int numEvaluated = 0;
+
         int tl = 0;
-        for (tl = 0; tl < config_.plannerConfig_.numSubSamples;++tl)
+        for (tl = 0; tl < numSubSamples;++tl)
         {
             PoseEvalResults &results = out.poseResults_[tl];
-            results.SetWheelAnglesRobot(wheelAnglesRobot);
 
-            DriveModelDA::UpdatePose(curP,cmd*curStep,results.pose);
-            curStep+=config_.plannerConfig_.subSampleTimeStep;
-            results.cmd = cmd;
-            poseEstimator_.Evaluate(results);
+            if (tl == numEvaluated)
+            {
+                /// the poses only depend on the command, so the next batchSize poses are evaluated together
+                const int count = std::min(batchSize,numSubSamples-tl);
+                for (int bl = tl; bl < tl+count;++bl)
+                {
+                    PoseEvalResults &batchResults = out.poseResults_[bl];
+                    batchResults.SetWheelAnglesRobot(wheelAnglesRobot);
+
+                    DriveModelDA::UpdatePose(curP,cmd*curStep,batchResults.pose);
+                    curStep+=config_.plannerConfig_.subSampleTimeStep;
+                    batchResults.cmd = cmd;
+                }
+
+                if (count == 1) poseEstimator_.Evaluate(results);
+                else poseEstimator_.EvaluateBatch(&results,count);
+                numEvaluated += count;
+            }
             //poseEstimator_->Evaluate(out.poseResults_[tl]);
             CalculateAngleDiff(*prevPER,results);
             //poseEstimator_.CheckState(results);
@@ -200,8 +295,13 @@ public:
 
         out.SetEnd(tl > 0?tl-1:0);
         scorer_.ScoreNode(out);
-        //scorer_.FinalNodeScore(out);
+    }
 
+    /**
+     * @brief Final scoring of leaves and update of the best node, has to be called in node order
+     */
+    void FinishTrajectory(TrajNode &out)
+    {
         if (out.validState_ == TN_VS_NOTVALIDUNTILEND || out.level_ >= config_.plannerConfig_.maxLevel)
         {
 
@@ -215,14 +315,16 @@ public:
 
             }
         }
-        return &out;
     }
 
-
-protected:
     TS scorer_;
     INodeExpander::Ptr expander_;
 
+    //! Evaluates child trajectories in parallel, nullptr if only one thread is used
+    WorkerPool::Ptr workerPool_;
+    //! Children created in the last call of CreateTrajectories
+    std::vector<TrajNode*> newNodes_;
+
 };
 
 #endif // PLANNERNODES_H
@@ -24,8 +24,16 @@ public:
     cv::Mat GetDEM(){
         return dem_;
     }
+    CVAlignedMat::ptr GetDemPtr() const {
+        return demPtr_;
+    }
 
     void Evaluate(PoseEvalResults &results) const;
+
+    /**
+     * @brief Evaluates count consecutive poses with RobotModel::EvaluatePoses, uses a scratch batch per thread
+     */
+    void EvaluateBatch(PoseEvalResults *results, const int count) const;
     cv::Mat DrawDebugImage(PoseEvalResults &results);
 
     RobotModel* GetRobotModel(){return &robotModel_; }
@@ -43,8 +51,16 @@ public:
     RobotModel robotModel_;
 
 private:
+    /**
+     * @brief Rebuilds the min/max pyramid of the current DEM if enabled in the ProcConfig
+     */
+    void UpdatePyramid();
+
+    const DemPyramid* GetPyramid() const {return demPyramid_.IsValid()? &demPyramid_ : nullptr;}
+
     CVAlignedMat::ptr demPtr_;
     cv::Mat dem_;
+    DemPyramid demPyramid_;
 
 };
 
@@ -9,6 +9,49 @@
 #include "utils_math_approx.h"
 
 
+/**
+ * @brief Wheel matching results of a batch of poses stored as structure of arrays, one array per wheel
+ */
+struct PoseBatch
+{
+    PoseBatch():
+        size(0)
+    {}
+
+    void Resize(int n)
+    {
+        size = n;
+        if ((int)angleIdx.size() >= n) return;
+
+        angleIdx.resize(n);
+        robotCenter.resize(n);
+        outOfImage.resize(n);
+        order.resize(n);
+        for (int w = 0; w < 4;++w)
+        {
+            imagePos[w].resize(n);
+            zValue[w].resize(n);
+            contactPoint[w].resize(n);
+            wheelSupport[w].resize(n);
+        }
+    }
+
+    int size;
+
+    std::vector<int> angleIdx;
+    std::vector<cv::Point2f> robotCenter;
+    std::vector<unsigned char> outOfImage;
+
+    std::vector<cv::Point2i> imagePos[4];
+    std::vector<int> zValue[4];
+    std::vector<cv::Point2i> contactPoint[4];
+    std::vector<float> wheelSupport[4];
+
+    /// evaluation order of the poses for the current wheel
+    std::vector<int> order;
+};
+
+
 /**
  * @brief The robot model implementation
  */
@@ -29,9 +72,18 @@ public:
     void SetupRobot(const ProcConfig &procConfig, const RobotConfig &robotConfig,  const std::vector<WheelConfig> &wheelConfigs, const ChassisConfig &chassisConfig);
 
     /**
-     * @brief Evaluate for a given DEM and pose
+     * @brief Evaluate for a given DEM and pose. With a pyramid of the DEM, poses without wheel support and chassis tests without collision are
+     * detected on the pyramid first, the zValue of a coarsely rejected wheel and the chassis minimum of a coarsely accepted test are lower bounds
      */
-    int EvaluatePose(const cv::Mat &dem, PoseEvalResults &results) const;
+    int EvaluatePose(const cv::Mat &dem, PoseEvalResults &results, const DemPyramid *pyramid = nullptr) const;
+
+    /**
+     * @brief Evaluate count poses for a given DEM, gives the same results as EvaluatePose for each pose
+     *
+     * The wheel templates are matched wheel by wheel, the poses of one wheel are sorted by template and DEM row, so consecutive matches reuse the
+     * template and largely the same DEM rows. The DEM window of the next match is prefetched. The wheel results are also returned in batch.
+     */
+    void EvaluatePoses(const cv::Mat &dem, PoseEvalResults *results, const int count, PoseBatch &batch, const DemPyramid *pyramid = nullptr) const;
 
     /**
      * @brief Calculates the z-position of the base link
@@ -217,6 +269,40 @@ public:
 
 
 private:
+
+    /**
+     * @brief Second part of the pose evaluation after all wheels are matched: plane fit, angles and chassis test
+     */
+    int EvaluatePoseFromWheels(const cv::Mat &dem, PoseEvalResults &results, const int angleIdx, const cv::Point2f &robotCenter, const DemPyramid *pyramid) const;
+
+    /**
+     * @brief Sets the wheel results from the DEM pyramid if the pose certainly has no wheel support, wheels without a bound are evaluated on the DEM
+     */
+    bool CoarseRejectWheels(const cv::Mat &dem, const DemPyramid &pyramid, PoseEvalResults &results, const cv::Point2i *imagePos) const;
+
+    /**
+     * @brief Chassis test, skips the DEM if the pyramid bound already excludes a collision
+     */
+    inline int EvaluateChassis(const cv::Mat &dem, const DemPyramid *pyramid, const float &startVal, const float &dx, const float &dy, const cv::Point2f &pos, const int &angleIdx, int &cx, int &cy) const
+    {
+        int lowerBound;
+        if (pyramid != nullptr && chassisModel_.GetLowerBound(*pyramid,startVal,dx,dy,pos,angleIdx,lowerBound) && lowerBound >= procConfig_.mapBaseHeight)
+        {
+            cx = 0;
+            cy = 0;
+            return lowerBound;
+        }
+        return chassisModel_.EvaluateNP(dem,startVal,dx,dy,pos,angleIdx,cx,cy);
+    }
+
+    /**
+     * @brief Wheel z position in m for a zValue of the template matching
+     */
+    inline float GetWheelZPos(const int zValue) const
+    {
+        return -(float)(zValue-procConfig_.imapBaseHeight)*procConfig_.heightScaleInv;
+    }
+
     float angleStep_;
 
     cv::Point2f baseLinkPosImage_;
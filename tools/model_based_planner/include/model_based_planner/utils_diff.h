@@ -9,17 +9,106 @@
 #include <opencv2/highgui/highgui.hpp>
 
 /**
- * @brief Include SIMD functions depending on requested CPU architecture
+ * @brief SIMD functions for matching wheel and chassis templates with the DEM
+ *
+ * The functions are compiled in several instruction set variants (src/utils_diff_sse.cpp, src/utils_diff_avx2.cpp,
+ * src/utils_diff_avx512.cpp). Only the kernels carry a target attribute, the translation units use the default flags, so
+ * inline code of shared headers is never compiled for a newer instruction set. SelectKernels() picks the best variant
+ * supported by the CPU once, the inline functions below forward to it. Until then the SSE4.1 variant is used.
+ * All variants give the same results, differences are signed.
  */
+namespace Utils_DIFF
+{
 
-#ifdef USE_AVX2
-#include "utils_diff_axv.h"
-#else
-#include "utils_diff_sse.h"
-#endif
+enum InstructionSet
+{
+    IS_SSE41 = 0,
+    IS_AVX2 = 1,
+    IS_AVX512BW = 2
+};
 
+typedef int (*DiffMinPosFunc)(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp);
+typedef int (*WheelSupportFunc)(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , const int &zval);
+typedef int (*WSDiffMinPosFunc)(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , int &rxp, int &ryp, int &wsRes);
+typedef int (*TestChassisFunc)(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp);
+typedef void (*WarpChassisFunc)(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy);
 
+/**
+ * @brief Function table of one instruction set variant
+ */
+struct DiffKernels
+{
+    InstructionSet isa;
+    const char* name;
+
+    DiffMinPosFunc diffMinPos;
+    DiffMinPosFunc np_diffMinPos;
+    WheelSupportFunc calcWheelSupport;
+    WSDiffMinPosFunc ws_diffMinPos;
+    TestChassisFunc testChassis;
+    TestChassisFunc np_testChassis;
+    WarpChassisFunc warpChassis;
+};
+
+/**
+ * @brief Fill the function table of a variant, returns false if the variant was not compiled
+ */
+bool GetKernelsSSE(DiffKernels &kernels);
+bool GetKernelsAVX2(DiffKernels &kernels);
+bool GetKernelsAVX512(DiffKernels &kernels);
+
+/**
+ * @brief Best instruction set supported by the CPU and the operating system (cpuid/xgetbv)
+ */
+InstructionSet DetectInstructionSet();
+
+/**
+ * @brief Selects the kernels for this CPU, only the first call has an effect
+ */
+const DiffKernels& SelectKernels();
+
+/**
+ * @brief The currently selected kernels
+ */
+extern DiffKernels activeKernels;
+
+
+inline int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+{
+    return activeKernels.diffMinPos(input,temp,tx,ty,rxp,ryp);
+}
+
+inline int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+{
+    return activeKernels.np_diffMinPos(input,temp,tx,ty,rxp,ryp);
+}
+
+inline int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , const int &zval)
+{
+    return activeKernels.calcWheelSupport(input,temp,tx,ty,wsThresh,zval);
+}
+
+inline int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , int &rxp, int &ryp, int &wsRes)
+{
+    return activeKernels.ws_diffMinPos(input,temp,tx,ty,wsThresh,rxp,ryp,wsRes);
+}
+
+inline int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
+{
+    return activeKernels.testChassis(input,temp,sval,dx,dy,tx,ty,rxp,ryp);
+}
+
+inline int np_testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
+{
+    return activeKernels.np_testChassis(input,temp,sval,dx,dy,tx,ty,rxp,ryp);
+}
+
+inline void warpChassis(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy)
+{
+    activeKernels.warpChassis(temp,result,sval,dx,dy);
+}
 
+}
 
 
 
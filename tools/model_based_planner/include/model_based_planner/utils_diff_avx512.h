@@ -0,0 +1,187 @@
+#ifndef UTILS_DIFF_AVX512
+#define UTILS_DIFF_AVX512
+
+
+#include <immintrin.h>
+#include <climits>
+
+/// The functions are compiled for AVX-512BW by their target attribute, the translation unit itself uses the default flags
+#define MBP_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+
+
+/**
+ * @brief AVX-512BW implementation of core functions, compiled in src/utils_diff_avx512.cpp only
+ *
+ * Rows of the aligned images are only padded to 32 bytes, so each row is processed in 64 byte steps followed by an
+ * optional masked 32 byte tail. All differences are signed, as in the SSE and AVX2 variants.
+ */
+namespace Utils_DIFF
+{
+namespace AVX512
+{
+
+inline static MBP_TARGET_AVX512 __mmask32 n_tailMask(const cv::Mat &temp)
+{
+    const int tailLength = (temp.step%64)/2;
+    return tailLength > 0 ? (__mmask32)((1u << tailLength)-1u) : 0;
+}
+
+inline static MBP_TARGET_AVX512 int n_mm512_hmin_val(const __m512i &v)
+{
+    __m256i v256 = _mm256_min_epi16(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v,1));
+    __m128i v128 = _mm_min_epi16(_mm256_castsi256_si128(v256), _mm256_extracti128_si256(v256,1));
+
+    v128 = _mm_min_epi16(v128, _mm_srli_si128(v128, 8));
+    v128 = _mm_min_epi16(v128, _mm_srli_si128(v128, 4));
+    v128 = _mm_min_epi16(v128, _mm_srli_si128(v128, 2));
+
+    return (short)_mm_extract_epi16(v128,0);
+}
+
+
+static MBP_TARGET_AVX512 int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+{
+    const int numStepsTemp = temp.step/64;
+    const __mmask32 tailMask = n_tailMask(temp);
+
+    const __m512i inc = _mm512_set1_epi16(32);
+    static const short laneIdx[32] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,
+                                      16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31};
+    const __m512i startIdx = _mm512_loadu_si512(laneIdx);
+
+    __m512i bestValues = _mm512_set1_epi16(30000);
+    // x and y of the minimum are tracked separately, so large templates can not overflow the 16 bit index
+    __m512i bestX = _mm512_setzero_si512();
+    __m512i bestY = _mm512_setzero_si512();
+
+    for (int y = 0; y < temp.rows;++y)
+    {
+        const short* srcP = input.ptr<short>(ty+y)+tx;
+        const short* tmpP = temp.ptr<short>(y);
+        const __m512i curY = _mm512_set1_epi16(y);
+        __m512i curX = startIdx;
+
+        for (int x = 0; x < numStepsTemp;++x)
+        {
+            const __m512i a = _mm512_loadu_si512(srcP);
+            const __m512i b = _mm512_loadu_si512(tmpP);
+            const __m512i res =_mm512_sub_epi16(b,a);
+
+            // only a smaller value replaces the best one, so each element keeps its first minimum
+            const __mmask32 lt = _mm512_cmplt_epi16_mask(res,bestValues);
+            bestValues = _mm512_mask_mov_epi16(bestValues,lt,res);
+            bestX = _mm512_mask_mov_epi16(bestX,lt,curX);
+            bestY = _mm512_mask_mov_epi16(bestY,lt,curY);
+            curX = _mm512_add_epi16(curX,inc);
+
+            srcP += 32;
+            tmpP += 32;
+        }
+
+        if (tailMask)
+        {
+            const __m512i a = _mm512_maskz_loadu_epi16(tailMask,srcP);
+            const __m512i b = _mm512_maskz_loadu_epi16(tailMask,tmpP);
+            const __m512i res =_mm512_sub_epi16(b,a);
+
+            const __mmask32 lt = _mm512_mask_cmplt_epi16_mask(tailMask,res,bestValues);
+            bestValues = _mm512_mask_mov_epi16(bestValues,lt,res);
+            bestX = _mm512_mask_mov_epi16(bestX,lt,curX);
+            bestY = _mm512_mask_mov_epi16(bestY,lt,curY);
+        }
+    }
+
+    const int zval = n_mm512_hmin_val(bestValues);
+    const __mmask32 isMin = _mm512_cmpeq_epi16_mask(bestValues,_mm512_set1_epi16(zval));
+
+    // first occurrence of the minimum: smallest row, then smallest column within that row
+    const __m512i noPos = _mm512_set1_epi16(SHRT_MAX);
+    ryp = n_mm512_hmin_val(_mm512_mask_mov_epi16(noPos,isMin,bestY));
+    const __mmask32 isFirstRow = _mm512_mask_cmpeq_epi16_mask(isMin,bestY,_mm512_set1_epi16(ryp));
+    rxp = n_mm512_hmin_val(_mm512_mask_mov_epi16(noPos,isFirstRow,bestX));
+
+    return zval;
+}
+
+static MBP_TARGET_AVX512 int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+{
+    const int numStepsTemp = temp.step/64;
+    const __mmask32 tailMask = n_tailMask(temp);
+
+    __m512i bestValues = _mm512_set1_epi16(30000);
+
+    for (int y = 0; y < temp.rows;++y)
+    {
+        const short* srcP = input.ptr<short>(ty+y)+tx;
+        const short* tmpP = temp.ptr<short>(y);
+
+        for (int x = 0; x < numStepsTemp;++x)
+        {
+            const __m512i a = _mm512_loadu_si512(srcP);
+            const __m512i b = _mm512_loadu_si512(tmpP);
+            bestValues = _mm512_min_epi16(bestValues,_mm512_sub_epi16(b,a));
+
+            srcP += 32;
+            tmpP += 32;
+        }
+
+        if (tailMask)
+        {
+            const __m512i a = _mm512_maskz_loadu_epi16(tailMask,srcP);
+            const __m512i b = _mm512_maskz_loadu_epi16(tailMask,tmpP);
+            bestValues = _mm512_mask_min_epi16(bestValues,tailMask,bestValues,_mm512_sub_epi16(b,a));
+        }
+    }
+
+    return n_mm512_hmin_val(bestValues);
+}
+
+static MBP_TARGET_AVX512 int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , const int &zval)
+{
+    const int numStepsTemp = temp.step/64;
+    const __mmask32 tailMask = n_tailMask(temp);
+
+    const __m512i tValA = _mm512_set1_epi16(zval);
+    const __m512i cmpVal = _mm512_set1_epi16(wsThresh);
+    int supVal = 0;
+
+    for (int y = 0; y < temp.rows;++y)
+    {
+        const short* srcP = input.ptr<short>(ty+y)+tx;
+        const short* tmpP = temp.ptr<short>(y);
+
+        for (int x = 0; x < numStepsTemp;++x)
+        {
+            const __m512i a = _mm512_loadu_si512(srcP);
+            const __m512i b = _mm512_loadu_si512(tmpP);
+            const __m512i res2 = _mm512_sub_epi16(_mm512_sub_epi16(b,a),tValA);
+            supVal += __builtin_popcount((unsigned int)_mm512_cmplt_epi16_mask(res2,cmpVal));
+
+            srcP += 32;
+            tmpP += 32;
+        }
+
+        if (tailMask)
+        {
+            const __m512i a = _mm512_maskz_loadu_epi16(tailMask,srcP);
+            const __m512i b = _mm512_maskz_loadu_epi16(tailMask,tmpP);
+            const __m512i res2 = _mm512_sub_epi16(_mm512_sub_epi16(b,a),tValA);
+            supVal += __builtin_popcount((unsigned int)_mm512_mask_cmplt_epi16_mask(tailMask,res2,cmpVal));
+        }
+    }
+
+    return supVal;
+}
+
+static MBP_TARGET_AVX512 int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , int &rxp, int &ryp, int &wsRes)
+{
+    const int zval = diffMinPos(input,temp,tx,ty,rxp,ryp);
+    wsRes = calcWheelSupport(input,temp,tx,ty,wsThresh,zval);
+    return zval;
+}
+
+
+}
+}
+
+#endif // UTILS_DIFF_AVX512
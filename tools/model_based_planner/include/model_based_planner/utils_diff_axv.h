@@ -4,14 +4,24 @@
 
 #include <immintrin.h>
 
+/// The functions are compiled for AVX2 by their target attribute, the translation unit itself uses the default flags
+#define MBP_TARGET_AVX2 __attribute__((target("avx2")))
+
 
 /**
- * @brief AVX implementation of core functions
+ * @brief AVX2 implementation of core functions, compiled in src/utils_diff_avx2.cpp only
+ *
+ * All differences are signed, a negative difference means the template is below the DEM surface.
  */
 namespace Utils_DIFF
 {
+namespace AVX2
+{
 
-inline static int n_mm256_hmin_index(const __m256i &v, int &val)
+/**
+ * @brief Minimum of v and the smallest of the indices idx at which it occurs
+ */
+inline static MBP_TARGET_AVX2 int n_mm256_hmin_index(const __m256i &v, const __m256i &idx, int &val)
 {
     __m256i vmax = v;
 
@@ -22,14 +32,15 @@ inline static int n_mm256_hmin_index(const __m256i &v, int &val)
 
     const __m256i vcmp = _mm256_cmpeq_epi16(v, vmax);
 
-    uint32_t mask = _mm256_movemask_epi8(vcmp);
+    // the indices of all other elements are set to 0xffff, the smallest remaining index is the first occurrence
+    const __m256i cand = _mm256_or_si256(idx, _mm256_andnot_si256(vcmp, _mm256_set1_epi16(-1)));
+    const __m128i cand128 = _mm_min_epu16(_mm256_castsi256_si128(cand), _mm256_extracti128_si256(cand, 1));
 
-
-    val = _mm256_extract_epi16(vmax,0);
-    return  __builtin_ctz(mask) / 2;
+    val = (short)_mm256_extract_epi16(vmax,0);
+    return _mm_extract_epi16(_mm_minpos_epu16(cand128),0);
 }
 
-inline static int n_mm256_hmin_val(const __m256i &v)
+inline static MBP_TARGET_AVX2 int n_mm256_hmin_val(const __m256i &v)
 {
     __m256i vmax = v;
 
@@ -38,12 +49,22 @@ inline static int n_mm256_hmin_val(const __m256i &v)
     vmax = _mm256_min_epi16(vmax, _mm256_alignr_epi8(vmax, vmax, 8));
     vmax = _mm256_min_epi16(vmax, _mm256_permute2x128_si256(vmax, vmax, 0x01));
 
-    return _mm256_extract_epi16(vmax,0);
+    return (short)_mm256_extract_epi16(vmax,0);
 
 }
 
+/**
+ * @brief Signed version of _mm_minpos_epu16: the minimum in element 0, its index in element 1
+ */
+inline static MBP_TARGET_AVX2 __m128i n_mm_minpos_epi16(const __m128i v)
+{
+    const __m128i signBit = _mm_set1_epi16((short)0x8000);
+    const __m128i res = _mm_minpos_epu16(_mm_xor_si128(v,signBit));
+    return _mm_xor_si128(res,_mm_cvtsi32_si128(0x8000));
+}
+
 
-static int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_AVX2 int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
 {
     //int x = 0;
     const __m256i* msrcPtr = (const __m256i*)(input.ptr<short>(ty)+tx);
@@ -72,12 +93,13 @@ static int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx,
 
             //bestValues = _mm256_min_epi16(bestValues,res);
 
-            const __m256i cmp = _mm256_cmpgt_epi16(res,bestValues);
-            const __m256i p1 = _mm256_and_si256(cmp,bestValues);
-            const __m256i p2 = _mm256_andnot_si256(cmp,res);
+            // only a smaller value replaces the best one, so each element keeps its first minimum
+            const __m256i cmp = _mm256_cmpgt_epi16(bestValues,res);
+            const __m256i p1 = _mm256_and_si256(cmp,res);
+            const __m256i p2 = _mm256_andnot_si256(cmp,bestValues);
             bestValues = _mm256_add_epi16(p1,p2);
-            const __m256i i1 = _mm256_and_si256(cmp,bestIdx);
-            const __m256i i2 = _mm256_andnot_si256(cmp,curIdx);
+            const __m256i i1 = _mm256_and_si256(cmp,curIdx);
+            const __m256i i2 = _mm256_andnot_si256(cmp,bestIdx);
             bestIdx = _mm256_add_epi16(i1,i2);
             curIdx = _mm256_add_epi16(curIdx,inc);
 
@@ -90,23 +112,19 @@ static int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx,
     }
 
     int zval;
-    const int idx = n_mm256_hmin_index(bestValues,zval);
-
-    short arr[16];
-    _mm256_storeu_si256((__m256i*)arr, bestIdx);
-
-    const short resPos = arr[idx];
+    // the index runs over the whole row including the alignment padding
+    const int resPos = n_mm256_hmin_index(bestValues,bestIdx,zval);
+    const int rowLength = temp.step/2;
 
-    //const short resPos = ((short *)&bestIdx)[idx];
-    rxp = resPos%temp.cols;
-    ryp = resPos/temp.cols;
+    rxp = resPos%rowLength;
+    ryp = resPos/rowLength;
 
     return zval;
 
 
 }
 
-static int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_AVX2 int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
 {
     //int x = 0;
     const __m256i* msrcPtr = (const __m256i*)(input.ptr<short>(ty)+tx);
@@ -143,7 +161,7 @@ static int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
 }
 
 
-inline int HSumAvxI(const __m256i &val)
+inline static MBP_TARGET_AVX2 int HSumAvxI(const __m256i &val)
     {
         short tres[16];
         _mm256_storeu_si256((__m256i*) tres, val );
@@ -152,7 +170,7 @@ inline int HSumAvxI(const __m256i &val)
 
     }
 
-static int wsnp_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh, int &wsRes)
+static MBP_TARGET_AVX2 int wsnp_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh, int &wsRes)
 {
     //int x = 0;
     const __m256i* msrcPtr = (const __m256i*)(input.ptr<short>(ty)+tx);
@@ -226,7 +244,7 @@ static int wsnp_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int
 
 
 
-static int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , const int &zval)
+static MBP_TARGET_AVX2 int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , const int &zval)
 {
     //int x = 0;
     const __m256i* msrcPtr = (const __m256i*)(input.ptr<short>(ty)+tx);
@@ -275,7 +293,7 @@ static int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int
 
 }
 
-static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , int &rxp, int &ryp, int &wsRes)
+static MBP_TARGET_AVX2 int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , int &rxp, int &ryp, int &wsRes)
 {
     //int x = 0;
     const __m256i* msrcPtr = (const __m256i*)(input.ptr<short>(ty)+tx);
@@ -304,12 +322,13 @@ static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
 
             //bestValues = _mm256_min_epi16(bestValues,res);
 
-            const __m256i cmp = _mm256_cmpgt_epi16(res,bestValues);
-            const __m256i p1 = _mm256_and_si256(cmp,bestValues);
-            const __m256i p2 = _mm256_andnot_si256(cmp,res);
+            // only a smaller value replaces the best one, so each element keeps its first minimum
+            const __m256i cmp = _mm256_cmpgt_epi16(bestValues,res);
+            const __m256i p1 = _mm256_and_si256(cmp,res);
+            const __m256i p2 = _mm256_andnot_si256(cmp,bestValues);
             bestValues = _mm256_add_epi16(p1,p2);
-            const __m256i i1 = _mm256_and_si256(cmp,bestIdx);
-            const __m256i i2 = _mm256_andnot_si256(cmp,curIdx);
+            const __m256i i1 = _mm256_and_si256(cmp,curIdx);
+            const __m256i i2 = _mm256_andnot_si256(cmp,bestIdx);
             bestIdx = _mm256_add_epi16(i1,i2);
             curIdx = _mm256_add_epi16(curIdx,inc);
 
@@ -322,16 +341,12 @@ static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
     }
 
     int zval;
-    const int idx = n_mm256_hmin_index(bestValues,zval);
+    // the index runs over the whole row including the alignment padding
+    const int resPos = n_mm256_hmin_index(bestValues,bestIdx,zval);
+    const int rowLength = temp.step/2;
 
-    short arr[16];
-    _mm256_storeu_si256((__m256i*)arr, bestIdx);
-
-    const short resPos = arr[idx];
-
-    //const short resPos = ((short *)&bestIdx)[idx];
-    rxp = resPos%temp.cols;
-    ryp = resPos/temp.cols;
+    rxp = resPos%rowLength;
+    ryp = resPos/rowLength;
 
 
     msrcPtr = (const __m256i*)(input.ptr<short>(ty)+tx);
@@ -374,7 +389,7 @@ static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
 }
 
 
-static int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_AVX2 int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
 {
 
     int val = 30000;
@@ -423,10 +438,10 @@ static int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &s
             const __m256i res =_mm256_sub_epi16(mb,a);
             const __m128i lower = _mm256_extracti128_si256(res,0);
             const __m128i upper = _mm256_extracti128_si256(res,1);
-            const __m128i resl = _mm_minpos_epu16( lower);
-            const __m128i resu = _mm_minpos_epu16( upper);
+            const __m128i resl = n_mm_minpos_epi16(lower);
+            const __m128i resu = n_mm_minpos_epi16(upper);
 
-            val = _mm_extract_epi16(resl,0);
+            val = (short)_mm_extract_epi16(resl,0);
 
             if (val < tval)
             {
@@ -435,7 +450,7 @@ static int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &s
                 rxp = x+_mm_extract_epi16(resl,1);
             }
 
-            val = _mm_extract_epi16(resu,0);
+            val = (short)_mm_extract_epi16(resu,0);
 
 
             if (val < tval)
@@ -454,7 +469,7 @@ static int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &s
 
 }
 
-static int np_testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_AVX2 int np_testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
 {
 
 
@@ -519,7 +534,7 @@ static int np_testChassis(const cv::Mat &input, const cv::Mat &temp, const float
 
 
 
-static void warpChassis(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy)
+static MBP_TARGET_AVX2 void warpChassis(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy)
 {
 
 
@@ -578,7 +593,7 @@ static void warpChassis(const cv::Mat &temp, cv::Mat &result, const float &sval,
 
 
 
-static void warpChassis2(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy)
+static MBP_TARGET_AVX2 void warpChassis2(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy)
 {
 
 
@@ -631,6 +646,7 @@ static void warpChassis2(const cv::Mat &temp, cv::Mat &result, const float &sval
 
 
 }
+}
 
 
 
@@ -4,14 +4,44 @@
 
 #include <nmmintrin.h>
 
+/// The functions are compiled for SSE4.1 by their target attribute, the translation unit itself uses the default flags
+#define MBP_TARGET_SSE41 __attribute__((target("sse4.1")))
+
 
 /**
- * @brief SSE implementation of core functions
+ * @brief SSE4.1 implementation of core functions, compiled in src/utils_diff_sse.cpp only
+ *
+ * All differences are signed, a negative difference means the template is below the DEM surface.
  */
 namespace Utils_DIFF
 {
+namespace SSE
+{
+
+/**
+ * @brief Signed version of _mm_minpos_epu16: the minimum in element 0, its index in element 1
+ *
+ * Flipping the sign bit maps the signed order onto the unsigned one, the sign bit of the minimum is flipped back.
+ */
+inline static MBP_TARGET_SSE41 __m128i n_mm_minpos_epi16(const __m128i v)
+{
+    const __m128i signBit = _mm_set1_epi16((short)0x8000);
+    const __m128i res = _mm_minpos_epu16(_mm_xor_si128(v,signBit));
+    return _mm_xor_si128(res,_mm_cvtsi32_si128(0x8000));
+}
+
+/**
+ * @brief Sum of the eight 16 bit counters
+ */
+inline static MBP_TARGET_SSE41 int n_mm_hsum_epi16(const __m128i v)
+{
+    __m128i vsum = _mm_madd_epi16(v,_mm_set1_epi16(1));
+    vsum = _mm_add_epi32(vsum,_mm_srli_si128(vsum,8));
+    vsum = _mm_add_epi32(vsum,_mm_srli_si128(vsum,4));
+    return _mm_cvtsi128_si32(vsum);
+}
 
-static int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_SSE41 int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
 {
     const __m128i *srcP = (__m128i*)(input.ptr<short>(ty)+tx);
     const __m128i *curSrcP = srcP;
@@ -24,6 +54,9 @@ static int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx,
     int val = 30000;
     int tval = 30000;
     int x = 0;
+    // same result as the AVX variants if no difference is below the start value
+    rxp = 0;
+    ryp = 0;
     for (int y = 0; y < temp.rows;++y)
     {
         tmpPEnd = tmpP+numStepTemp;
@@ -32,8 +65,8 @@ static int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx,
             const __m128i a = _mm_loadu_si128((srcP));
             const __m128i b = _mm_load_si128(tmpP);
             const __m128i res =_mm_sub_epi16(b,a);
-            const __m128i res2 = _mm_minpos_epu16( res);
-            val = _mm_extract_epi16(res2,0);
+            const __m128i res2 = n_mm_minpos_epi16(res);
+            val = (short)_mm_extract_epi16(res2,0);
 
 
             if (val < tval)
@@ -60,13 +93,7 @@ static int diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx,
 }
 
 
-static inline uint32_t _mm_sum_epu8(const __m128i v)
-{
-    __m128i vsum = _mm_sad_epu8(v, _mm_setzero_si128());
-    return _mm_extract_epi16(vsum, 0) + _mm_extract_epi16(vsum, 4);
-}
-
-static int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , const int &zval)
+static MBP_TARGET_SSE41 int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , const int &zval)
 {
     const __m128i *srcP = (__m128i*)(input.ptr<short>(ty)+tx);
     const __m128i *curSrcP = srcP;
@@ -110,13 +137,13 @@ static int calcWheelSupport(const cv::Mat &input, const cv::Mat &temp, const int
     }
 
 
-    return _mm_sum_epu8(supVal);
+    return n_mm_hsum_epi16(supVal);
 
 
 }
 
 
-static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , int &rxp, int &ryp, int &wsRes)
+static MBP_TARGET_SSE41 int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &wsThresh , int &rxp, int &ryp, int &wsRes)
 {
     const __m128i *srcP = (__m128i*)(input.ptr<short>(ty)+tx);
     const __m128i *curSrcP = srcP;
@@ -129,6 +156,9 @@ static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
     int val = 30000;
     int tval = 30000;
     int x = 0;
+    // same result as the AVX variants if no difference is below the start value
+    rxp = 0;
+    ryp = 0;
     for (int y = 0; y < temp.rows;++y)
     {
         tmpPEnd = tmpP+numStepTemp;
@@ -137,8 +167,8 @@ static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
             const __m128i a = _mm_loadu_si128((srcP));
             const __m128i b = _mm_load_si128(tmpP);
             const __m128i res =_mm_sub_epi16(b,a);
-            const __m128i res2 = _mm_minpos_epu16( res);
-            val = _mm_extract_epi16(res2,0);
+            const __m128i res2 = n_mm_minpos_epi16(res);
+            val = (short)_mm_extract_epi16(res2,0);
 
 
             if (val < tval)
@@ -192,7 +222,7 @@ static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
     }
 
 
-    wsRes = _mm_sum_epu8(supVal);
+    wsRes = n_mm_hsum_epi16(supVal);
 
 
     return tval;
@@ -200,7 +230,7 @@ static int ws_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
 
 }
 
-static int get_wheel_support(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &zDiff, const int &wsThresh)
+static MBP_TARGET_SSE41 int get_wheel_support(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, const int &zDiff, const int &wsThresh)
 {
 
     const __m128i tValA = _mm_set1_epi16(zDiff);
@@ -238,13 +268,13 @@ static int get_wheel_support(const cv::Mat &input, const cv::Mat &temp, const in
 
     }
 
-    return _mm_sum_epu8(supVal);
+    return n_mm_hsum_epi16(supVal);
 
 
 }
 
 
-static int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_SSE41 int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &tx, const int &ty, int &rxp, int &ryp)
 {
     const __m128i *srcP = (__m128i*)(input.ptr<short>(ty)+tx);;
     const __m128i *tmpP = (__m128i*)(temp.ptr<short>(0));
@@ -281,8 +311,8 @@ static int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
 
 
     }
-    const __m128i res2 = _mm_minpos_epu16( bestVals);
-    int resVal = _mm_extract_epi16(res2,0);
+    const __m128i res2 = n_mm_minpos_epi16(bestVals);
+    int resVal = (short)_mm_extract_epi16(res2,0);
 
     return resVal;
 
@@ -290,7 +320,7 @@ static int np_diffMinPos(const cv::Mat &input, const cv::Mat &temp, const int &t
 }
 
 
-static int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_SSE41 int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
 {
 
 
@@ -331,9 +361,9 @@ static int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &s
             const __m128i b = _mm_load_si128((const __m128i*)(tmpP+x));
             const __m128i mb = _mm_add_epi16(b,tInc);
             const __m128i res =_mm_sub_epi16(mb,a);
-            const __m128i res2 = _mm_minpos_epu16( res);
+            const __m128i res2 = n_mm_minpos_epi16(res);
 
-            val = _mm_extract_epi16(res2,0);
+            val = (short)_mm_extract_epi16(res2,0);
 
 
             if (val < tval)
@@ -353,7 +383,7 @@ static int testChassis(const cv::Mat &input, const cv::Mat &temp, const float &s
 }
 
 
-static int np_testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
+static MBP_TARGET_SSE41 int np_testChassis(const cv::Mat &input, const cv::Mat &temp, const float &sval, const float &dx, const float &dy , const int &tx, const int &ty, int &rxp, int &ryp)
 {
 
 
@@ -416,14 +446,14 @@ static int np_testChassis(const cv::Mat &input, const cv::Mat &temp, const float
         yStart = _mm_add_ps(yStart,incrY);
     }
 
-    const __m128i res2 = _mm_minpos_epu16( bestVals);
-    return _mm_extract_epi16(res2,0);
+    const __m128i res2 = n_mm_minpos_epi16(bestVals);
+    return (short)_mm_extract_epi16(res2,0);
 
 
 }
 
 
-static void warpChassis(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy)
+static MBP_TARGET_SSE41 void warpChassis(const cv::Mat &temp, cv::Mat &result, const float &sval, const float &dx, const float &dy)
 {
 
 
@@ -477,6 +507,7 @@ static void warpChassis(const cv::Mat &temp, cv::Mat &result, const float &sval,
 }
 
 
+}
 }
 
 #endif // UTILS_DIFF_SSE
@@ -17,6 +17,9 @@ struct WheelDescriptor
     int numImagePixels_;
     float numImagePixelsInv_;
 
+    /// value range of the template including the row padding
+    short minValue_, maxValue_;
+
     CVAlignedMat::ptr image_;
 };
 
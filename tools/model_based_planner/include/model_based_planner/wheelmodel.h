@@ -5,6 +5,7 @@
 #include "config_robot.h"
 #include "config_proc.h"
 #include "poseevalresults.h"
+#include "dempyramid.h"
 
 
 #define WM_USE_WHEEL_SUPPORT 1
@@ -30,6 +31,57 @@ public:
 
     int Evaluate(const cv::Mat &dem,const cv::Point2f &pos, WheelEvalResults &results) const;
 
+    /**
+     * @brief Top left image position of the wheel template for angleIdx at pos, false if the template is not completely inside the dem
+     */
+    inline bool GetTemplatePos(const cv::Mat &dem,const cv::Point2f &pos, const int angleIdx, cv::Point2i &imagePos) const
+    {
+        const WheelDescriptor &desc = descriptors_[angleIdx];
+        imagePos = GetImagePos(pos,desc);
+
+        if (imagePos.x < 0 || imagePos.y < 0 ) return false;
+
+        const cv::Mat &wImg = desc.image_->mat_;
+        return imagePos.x + wImg.cols <= dem.cols && imagePos.y + wImg.rows <= dem.rows;
+    }
+
+    /**
+     * @brief Matches the wheel template for angleIdx at a position returned by GetTemplatePos
+     */
+    void EvaluateAt(const cv::Mat &dem,const cv::Point2i &imagePos, const int angleIdx, int &zValue, cv::Point2i &contactPoint, float &wheelSupport) const;
+
+    /**
+     * @brief Conservative lower bound of the zValue of the template for angleIdx at imagePos from the DEM pyramid, false if no bound is available
+     */
+    inline bool GetZValueLowerBound(const DemPyramid &pyramid,const cv::Point2i &imagePos, const int angleIdx, int &zLow) const
+    {
+        const WheelDescriptor &desc = descriptors_[angleIdx];
+        const cv::Mat &wImg = desc.image_->mat_;
+
+        int demMin,demMax;
+        if (!pyramid.GetMinMax(imagePos.x,imagePos.y,wImg.step/sizeof(short),wImg.rows,demMin,demMax)) return false;
+
+        // the kernels subtract in 16 bit and take the unsigned minimum, so the bound only holds if no difference overflows or is negative
+        zLow = desc.minValue_ - demMax;
+        return zLow >= 0 && desc.maxValue_ - demMin <= SHRT_MAX;
+    }
+
+    /**
+     * @brief Software prefetch of the dem rows covered by the wheel template at imagePos
+     */
+    inline void PrefetchDem(const cv::Mat &dem,const cv::Point2i &imagePos, const int angleIdx) const
+    {
+        const cv::Mat &wImg = descriptors_[angleIdx].image_->mat_;
+        const size_t rowBytes = wImg.cols*dem.elemSize();
+
+        for (int y = 0; y < wImg.rows;++y)
+        {
+            const char *row = (const char*)dem.ptr(imagePos.y+y)+imagePos.x*dem.elemSize();
+            __builtin_prefetch(row);
+            __builtin_prefetch(row+rowBytes-1);
+        }
+    }
+
 
 
     inline bool IsTurnable() const
@@ -47,6 +99,12 @@ public:
     float angleStep_;
     int wheelSupportThreshold_;
 
+private:
+    /**
+     * @brief Sets the value range of all descriptors, used for the coarse DEM tests
+     */
+    void SetTemplateBounds();
+
 
 };
 
@@ -0,0 +1,137 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+
+/**
+ * @brief Fixed pool of worker threads for parallel loops. The threads are created once and sleep between loops, the calling thread takes part in the work.
+ */
+class WorkerPool
+{
+public:
+    typedef std::shared_ptr<WorkerPool> Ptr;
+    static WorkerPool::Ptr Create(int numThreads){ return std::make_shared< WorkerPool >(numThreads) ; }
+
+    /**
+     * @brief numThreads is the total number of threads including the calling thread, <= 0 uses one thread per core
+     */
+    WorkerPool(int numThreads):
+        func_(nullptr),
+        numJobs_(0),
+        nextJob_(0),
+        busyWorkers_(0),
+        generation_(0),
+        stop_(false)
+    {
+        if (numThreads <= 0) numThreads = std::max(1u,std::thread::hardware_concurrency());
+
+        for (int tl = 1; tl < numThreads;++tl)
+        {
+            workers_.emplace_back(&WorkerPool::WorkerLoop,this);
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        startCond_.notify_all();
+
+        for (unsigned int tl = 0; tl < workers_.size();++tl) workers_[tl].join();
+    }
+
+    int GetNumThreads() const
+    {
+        return (int)workers_.size()+1;
+    }
+
+    /**
+     * @brief Calls func(i) for all i in [0,n) and returns when all calls are finished. The order of the calls is not defined.
+     */
+    void ParallelFor(int n, const std::function<void(int)> &func)
+    {
+        if (n <= 0) return;
+
+        if (workers_.empty() || n == 1)
+        {
+            for (int tl = 0; tl < n;++tl) func(tl);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            func_ = &func;
+            numJobs_ = n;
+            nextJob_ = 0;
+            busyWorkers_ = (int)workers_.size();
+            ++generation_;
+        }
+        startCond_.notify_all();
+
+        RunJobs();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneCond_.wait(lock, [this]{ return busyWorkers_ == 0; });
+        func_ = nullptr;
+    }
+
+private:
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void RunJobs()
+    {
+        for (int i = nextJob_++; i < numJobs_; i = nextJob_++)
+        {
+            (*func_)(i);
+        }
+    }
+
+    void WorkerLoop()
+    {
+        unsigned long lastGeneration = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                startCond_.wait(lock, [&]{ return stop_ || generation_ != lastGeneration; });
+                if (stop_) return;
+                lastGeneration = generation_;
+            }
+
+            RunJobs();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--busyWorkers_ == 0) doneCond_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable startCond_;
+    std::condition_variable doneCond_;
+
+    const std::function<void(int)> *func_;
+    int numJobs_;
+    std::atomic<int> nextJob_;
+    int busyWorkers_;
+    unsigned long generation_;
+    bool stop_;
+
+};
+
+#endif // WORKERPOOL_H
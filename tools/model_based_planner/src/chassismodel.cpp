@@ -6,6 +6,7 @@
 
 //#include "scaleddrawproc.h"
 #include "utils_diff.h"
+#include "descriptorcache.h"
 
 
 ChassisModel::ChassisModel()
@@ -20,6 +21,13 @@ void ChassisModel::SetupChassis(const ProcConfig& procConfig, const ChassisConfi
 
     config_ = conf;
 
+    const uint64_t cacheHash = DescriptorCache::HashChassis(procConfig,conf);
+    if (DescriptorCache::Load(procConfig.descriptorCacheDir,cacheHash,descriptors_) && (int)descriptors_.size() == procConfig.numAngleStep)
+    {
+        SetTemplateBounds();
+        return;
+    }
+
     cv::Mat orgImg = cv::imread(conf.chassisfileName,-1);
 
     if (orgImg.channels() == 3)
@@ -208,6 +216,19 @@ void ChassisModel::SetupChassis(const ProcConfig& procConfig, const ChassisConfi
 
     }
 
+    SetTemplateBounds();
+
+    DescriptorCache::Save(procConfig.descriptorCacheDir,cacheHash,descriptors_);
+
+}
+
+void ChassisModel::SetTemplateBounds()
+{
+    for (unsigned int tl = 0; tl < descriptors_.size();++tl)
+    {
+        ChassisDescriptor &desc = descriptors_[tl];
+        DemPyramid::GetTemplateBounds(desc.image_->mat_,desc.minValue_,desc.maxValue_);
+    }
 }
 
 
@@ -240,3 +261,30 @@ int ChassisModel::EvaluateNP(const cv::Mat &dem,const float &startVal, const flo
 
 }
 
+bool ChassisModel::GetLowerBound(const DemPyramid &pyramid,const float &startVal, const float &dx, const float &dy, const cv::Point2f &pos, const int &angleIdx, int &lowerBound) const
+{
+    const ChassisDescriptor &desc = GetDescriptorIdx(angleIdx);
+    const cv::Mat &cImg = desc.image_->mat_;
+
+    const cv::Point2i tPos(round(pos.x-desc.centerImg_.x),round(pos.y-desc.centerImg_.y));
+
+    // the kernels also process the row padding of the template
+    const int width = cImg.step/sizeof(short);
+
+    int demMin,demMax;
+    if (!pyramid.GetMinMax(tPos.x,tPos.y,width,cImg.rows,demMin,demMax)) return false;
+
+    // range of the plane over the template, with a margin for the rounding and the incremental float computation of the kernels
+    const float planeX = dx*(float)(width-1);
+    const float planeY = dy*(float)(cImg.rows-1);
+    const int planeMin = (int)std::floor(startVal + std::min(0.0f,planeX) + std::min(0.0f,planeY)) - 2;
+    const int planeMax = (int)std::ceil(startVal + std::max(0.0f,planeX) + std::max(0.0f,planeY)) + 2;
+
+    // all intermediate values have to fit into 16 bit and the result has to be positive (unsigned minimum)
+    const int sumMin = desc.minValue_ + planeMin;
+    const int sumMax = desc.maxValue_ + planeMax;
+    if (planeMin < SHRT_MIN || planeMax > SHRT_MAX || sumMin < SHRT_MIN || sumMax > SHRT_MAX || sumMax - demMin > SHRT_MAX) return false;
+
+    lowerBound = sumMin - demMax;
+    return lowerBound >= 0;
+}
@@ -0,0 +1,366 @@
+#include "descriptorcache.h"
+
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+
+namespace
+{
+
+const char CacheMagic[8] = {'M','B','P','D','E','S','C','\0'};
+const uint32_t CacheVersion = 1;
+/// data blocks start at multiples of this offset, the mapping itself is page aligned
+const uint64_t CacheDataAlignment = 64;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t hash;
+    uint64_t fileSize;
+};
+
+/**
+ * @brief FNV-1a hash over the bytes of the given values
+ */
+struct Hasher
+{
+    Hasher():
+        value(14695981039346656037ull)
+    {}
+
+    void Add(const void *data, size_t size)
+    {
+        const unsigned char *p = (const unsigned char*)data;
+        for (size_t tl = 0; tl < size;++tl)
+        {
+            value ^= p[tl];
+            value *= 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void Add(const T &val)
+    {
+        Add(&val,sizeof(T));
+    }
+
+    void Add(const std::string &s)
+    {
+        Add(s.data(),s.size());
+    }
+
+    void Add(const cv::Point2f &p)
+    {
+        Add(p.x);
+        Add(p.y);
+    }
+
+    uint64_t value;
+};
+
+void AddRenderParameters(Hasher &h, const ProcConfig &pc)
+{
+    h.Add(CacheVersion);
+    h.Add(pc.numAngleStep);
+    h.Add(pc.heightScale);
+    h.Add(pc.wheelGroundLevel);
+    h.Add(pc.maxHeight);
+    h.Add(pc.pixelSize);
+}
+
+/**
+ * @brief Keeps a memory mapped cache file alive as long as descriptors point into it
+ */
+struct MappedFile
+{
+    MappedFile(void *data, size_t size):
+        data_(data),
+        size_(size)
+    {}
+
+    ~MappedFile()
+    {
+        munmap(data_,size_);
+    }
+
+    void *data_;
+    size_t size_;
+};
+
+std::string ExpandHome(const std::string &path)
+{
+    if (path.empty() || path[0] != '~') return path;
+    const char *home = getenv("HOME");
+    if (home == nullptr) return path;
+    return std::string(home) + path.substr(1);
+}
+
+bool CreateDirectories(const std::string &path)
+{
+    for (size_t pos = path.find('/',1); ; pos = path.find('/',pos+1))
+    {
+        const std::string sub = path.substr(0,pos);
+        if (mkdir(sub.c_str(),0755) != 0 && errno != EEXIST) return false;
+        if (pos == std::string::npos) break;
+    }
+    return true;
+}
+
+}
+
+
+uint64_t DescriptorCache::HashWheel(const ProcConfig &procConfig, const WheelConfig &conf)
+{
+    Hasher h;
+    AddRenderParameters(h,procConfig);
+    h.Add(conf.radius);
+    h.Add(conf.width);
+    h.Add(conf.latRadius);
+    h.Add(conf.jointPosWheel);
+    return h.value;
+}
+
+uint64_t DescriptorCache::HashChassis(const ProcConfig &procConfig, const ChassisConfig &conf)
+{
+    Hasher h;
+    AddRenderParameters(h,procConfig);
+    h.Add(conf.chassisfileName);
+    h.Add(conf.chassisImageCenter);
+    h.Add(conf.chassisModelYSize);
+    h.Add(conf.chassisImageValueScale);
+    h.Add(conf.chassisImageValueOffset);
+
+    // the chassis image itself may change without changing the config
+    struct stat st;
+    if (stat(conf.chassisfileName.c_str(),&st) == 0)
+    {
+        h.Add((int64_t)st.st_size);
+        h.Add((int64_t)st.st_mtime);
+    }
+
+    return h.value;
+}
+
+std::string DescriptorCache::GetFileName(const std::string &directory, const char *kind, uint64_t hash)
+{
+    char name[64];
+    snprintf(name,sizeof(name),"/%s_%016llx.desc",kind,(unsigned long long)hash);
+    return ExpandHome(directory) + name;
+}
+
+
+bool DescriptorCache::LoadRecords(const std::string &fileName, uint64_t hash, std::vector<Record> &records, std::vector<CVAlignedMat::ptr> &images)
+{
+    const int fd = open(fileName.c_str(),O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd,&st) != 0 || (size_t)st.st_size < sizeof(CacheHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    const size_t size = st.st_size;
+    // private writable mapping, the descriptors behave like normal images and never write back to the file
+    void *data = mmap(nullptr,size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>(data,size);
+
+    const unsigned char *base = (const unsigned char*)data;
+    CacheHeader header;
+    memcpy(&header,base,sizeof(header));
+
+    if (memcmp(header.magic,CacheMagic,sizeof(CacheMagic)) != 0 || header.version != CacheVersion || header.hash != hash || header.fileSize != size) return false;
+    if (sizeof(CacheHeader) + (uint64_t)header.count*sizeof(Record) > size) return false;
+
+    records.resize(header.count);
+    if (header.count > 0) memcpy(&records[0],base+sizeof(CacheHeader),header.count*sizeof(Record));
+
+    images.resize(header.count);
+    for (unsigned int tl = 0; tl < records.size();++tl)
+    {
+        const Record &r = records[tl];
+        if (r.rows <= 0 || r.cols <= 0 || r.step % CVAlignedMat_Alignment != 0 || r.offset % CVAlignedMat_Alignment != 0) return false;
+        if (r.offset + (uint64_t)r.rows*r.step > size) return false;
+
+        cv::Mat img(r.rows,r.cols,r.type,(void*)(base+r.offset),r.step);
+        if ((int)img.elemSize()*r.cols > r.step) return false;
+
+        images[tl] = CVAlignedMat::CreateView(img,mapping);
+    }
+
+    return true;
+}
+
+bool DescriptorCache::SaveRecords(const std::string &directory, const std::string &fileName, uint64_t hash, const std::vector<Record> &records, const std::vector<cv::Mat> &images)
+{
+    if (!CreateDirectories(ExpandHome(directory))) return false;
+
+    CacheHeader header;
+    memcpy(header.magic,CacheMagic,sizeof(CacheMagic));
+    header.version = CacheVersion;
+    header.count = records.size();
+    header.hash = hash;
+
+    std::vector<Record> outRecords = records;
+
+    uint64_t offset = sizeof(CacheHeader) + records.size()*sizeof(Record);
+    for (unsigned int tl = 0; tl < outRecords.size();++tl)
+    {
+        offset = (offset + CacheDataAlignment-1) / CacheDataAlignment * CacheDataAlignment;
+        outRecords[tl].offset = offset;
+        offset += (uint64_t)images[tl].rows*images[tl].step;
+    }
+    header.fileSize = offset;
+
+    // write to a temporary file first, so concurrent processes never see a partial file
+    char suffix[32];
+    snprintf(suffix,sizeof(suffix),".tmp%d",(int)getpid());
+    const std::string tmpName = fileName + suffix;
+
+    FILE *file = fopen(tmpName.c_str(),"wb");
+    if (file == nullptr) return false;
+
+    bool ok = fwrite(&header,sizeof(header),1,file) == 1;
+    if (ok && !outRecords.empty()) ok = fwrite(&outRecords[0],sizeof(Record),outRecords.size(),file) == outRecords.size();
+
+    const char zeros[CacheDataAlignment] = {0};
+    for (unsigned int tl = 0; ok && tl < outRecords.size();++tl)
+    {
+        const long pos = ftell(file);
+        ok = fwrite(zeros,1,outRecords[tl].offset-pos,file) == outRecords[tl].offset-pos;
+        if (ok) ok = fwrite(images[tl].data,images[tl].step,images[tl].rows,file) == (size_t)images[tl].rows;
+    }
+
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(tmpName.c_str(),fileName.c_str()) != 0)
+    {
+        unlink(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+bool DescriptorCache::Load(const std::string &directory, uint64_t hash, std::vector<WheelDescriptor> &descriptors)
+{
+    if (directory.empty()) return false;
+
+    std::vector<Record> records;
+    std::vector<CVAlignedMat::ptr> images;
+    if (!LoadRecords(GetFileName(directory,"wheel",hash),hash,records,images)) return false;
+
+    descriptors.resize(records.size());
+    for (unsigned int tl = 0; tl < records.size();++tl)
+    {
+        const Record &r = records[tl];
+        WheelDescriptor &desc = descriptors[tl];
+        desc.centerImg_ = cv::Point2f(r.centerX,r.centerY);
+        desc.jointPosImg_ = cv::Point2f(r.jointPosX,r.jointPosY);
+        desc.dirX_ = cv::Point2f(r.dirXx,r.dirXy);
+        desc.dirY_ = cv::Point2f(r.dirYx,r.dirYy);
+        desc.numImagePixels_ = r.numImagePixels;
+        desc.numImagePixelsInv_ = r.numImagePixelsInv;
+        desc.image_ = images[tl];
+    }
+
+    return true;
+}
+
+bool DescriptorCache::Load(const std::string &directory, uint64_t hash, std::vector<ChassisDescriptor> &descriptors)
+{
+    if (directory.empty()) return false;
+
+    std::vector<Record> records;
+    std::vector<CVAlignedMat::ptr> images;
+    if (!LoadRecords(GetFileName(directory,"chassis",hash),hash,records,images)) return false;
+
+    descriptors.resize(records.size());
+    for (unsigned int tl = 0; tl < records.size();++tl)
+    {
+        const Record &r = records[tl];
+        ChassisDescriptor &desc = descriptors[tl];
+        desc.centerImg_ = cv::Point2f(r.centerX,r.centerY);
+        desc.dirX_ = cv::Point2f(r.dirXx,r.dirXy);
+        desc.dirY_ = cv::Point2f(r.dirYx,r.dirYy);
+        desc.image_ = images[tl];
+    }
+
+    return true;
+}
+
+bool DescriptorCache::Save(const std::string &directory, uint64_t hash, const std::vector<WheelDescriptor> &descriptors)
+{
+    if (directory.empty()) return false;
+
+    std::vector<Record> records(descriptors.size());
+    std::vector<cv::Mat> images(descriptors.size());
+
+    for (unsigned int tl = 0; tl < descriptors.size();++tl)
+    {
+        const WheelDescriptor &desc = descriptors[tl];
+        Record &r = records[tl];
+        memset(&r,0,sizeof(r));
+        r.centerX = desc.centerImg_.x;
+        r.centerY = desc.centerImg_.y;
+        r.jointPosX = desc.jointPosImg_.x;
+        r.jointPosY = desc.jointPosImg_.y;
+        r.dirXx = desc.dirX_.x;
+        r.dirXy = desc.dirX_.y;
+        r.dirYx = desc.dirY_.x;
+        r.dirYy = desc.dirY_.y;
+        r.numImagePixels = desc.numImagePixels_;
+        r.numImagePixelsInv = desc.numImagePixelsInv_;
+
+        images[tl] = desc.image_->mat_;
+        r.rows = images[tl].rows;
+        r.cols = images[tl].cols;
+        r.type = images[tl].type();
+        r.step = images[tl].step;
+    }
+
+    return SaveRecords(directory,GetFileName(directory,"wheel",hash),hash,records,images);
+}
+
+bool DescriptorCache::Save(const std::string &directory, uint64_t hash, const std::vector<ChassisDescriptor> &descriptors)
+{
+    if (directory.empty()) return false;
+
+    std::vector<Record> records(descriptors.size());
+    std::vector<cv::Mat> images(descriptors.size());
+
+    for (unsigned int tl = 0; tl < descriptors.size();++tl)
+    {
+        const ChassisDescriptor &desc = descriptors[tl];
+        Record &r = records[tl];
+        memset(&r,0,sizeof(r));
+        r.centerX = desc.centerImg_.x;
+        r.centerY = desc.centerImg_.y;
+        r.dirXx = desc.dirX_.x;
+        r.dirXy = desc.dirX_.y;
+        r.dirYx = desc.dirY_.x;
+        r.dirYy = desc.dirY_.y;
+
+        images[tl] = desc.image_->mat_;
+        r.rows = images[tl].rows;
+        r.cols = images[tl].cols;
+        r.type = images[tl].type();
+        r.step = images[tl].step;
+    }
+
+    return SaveRecords(directory,GetFileName(directory,"chassis",hash),hash,records,images);
+}
@@ -25,6 +25,7 @@ void PoseEstimator::SetDem(CVAlignedMat::ptr dem)
 
     dem_ = demPtr_->mat_;
 
+    UpdatePyramid();
 }
 void PoseEstimator::SetDem(cv::Mat dem)
 {
@@ -32,13 +33,20 @@ void PoseEstimator::SetDem(cv::Mat dem)
 
     dem_ = demPtr_->mat_;
 
+    UpdatePyramid();
+}
+
+void PoseEstimator::UpdatePyramid()
+{
+    if (robotModel_.GetProcConfig().useDemPyramid) demPyramid_.Build(dem_);
+    else demPyramid_ = DemPyramid();
 }
 
 
 void PoseEstimator::Evaluate(PoseEvalResults &results) const
 {
     //const int res = robotModel_.EvaluatePose(dem_,results);
-    robotModel_.EvaluatePose(dem_,results);
+    robotModel_.EvaluatePose(dem_,results,GetPyramid());
 
     //++poseCounter_;
 
@@ -70,6 +78,12 @@ void PoseEstimator::Evaluate(PoseEvalResults &results) const
 
 }
 
+void PoseEstimator::EvaluateBatch(PoseEvalResults *results, const int count) const
+{
+    static thread_local PoseBatch batch;
+    robotModel_.EvaluatePoses(dem_,results,count,batch,GetPyramid());
+}
+
 cv::Mat PoseEstimator::DrawDebugImage(PoseEvalResults &results)
 {
     DrawProc dp;
@@ -2,11 +2,14 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include "utils_math_approx.h"
+#include "utils_diff.h"
+#include <algorithm>
 
 
 RobotModel::RobotModel()
 {
-
+    /// choose the SIMD variant of the DEM matching functions for this CPU
+    Utils_DIFF::SelectKernels();
 }
 
 /*
@@ -60,7 +63,7 @@ float RobotModel::GetBaseLinkZ(const PoseEvalResults &results)
 }
 
 
-int RobotModel::EvaluatePose(const cv::Mat &dem, PoseEvalResults &results) const
+int RobotModel::EvaluatePose(const cv::Mat &dem, PoseEvalResults &results, const DemPyramid *pyramid) const
 {
     const cv::Point2f pos(results.pose.x,results.pose.y);
     const float angle = NormalizeAngle(results.pose.z);
@@ -68,35 +71,159 @@ int RobotModel::EvaluatePose(const cv::Mat &dem, PoseEvalResults &results) const
     const RobotDescriptor &desc = GetDescriptor(angleIdx);
     const cv::Point2f robotCenter = pos-desc.baseLinkPosImage_;
 
+    cv::Point2i imagePos[4];
+    bool outOfImage = false;
 
-    const WheelModel &wm0 = wheels_[0];
-    const WheelModel &wm1 = wheels_[1];
-    const WheelModel &wm2 = wheels_[2];
-    const WheelModel &wm3 = wheels_[3];
+    for (int w = 0; w < 4;++w)
+    {
+        WheelEvalResults &wr = results.wheelEvalResults_[w];
+        SetWheelAngle(angle,angleIdx,wheels_[w],wr);
+        if (!wheels_[w].GetTemplatePos(dem,robotCenter+desc.wheelPositionsImage_[w],wr.wheelAngleIdx,imagePos[w])) outOfImage = true;
+    }
 
+    if (outOfImage)
+    {
+        results.validState = PERS_OUTOFIMAGE;
+        return PERS_OUTOFIMAGE;
+    }
 
-    SetWheelAngle(angle,angleIdx,wm0,results.wheelEvalResults_[0]);
-    SetWheelAngle(angle,angleIdx,wm1,results.wheelEvalResults_[1]);
-    SetWheelAngle(angle,angleIdx,wm2,results.wheelEvalResults_[2]);
-    SetWheelAngle(angle,angleIdx,wm3,results.wheelEvalResults_[3]);
+    if (pyramid != nullptr && CoarseRejectWheels(dem,*pyramid,results,imagePos)) return results.validState;
 
-    //int iz0,iz1,iz2,iz3;
+    for (int w = 0; w < 4;++w)
+    {
+        WheelEvalResults &wr = results.wheelEvalResults_[w];
+        wheels_[w].EvaluateAt(dem,imagePos[w],wr.wheelAngleIdx,wr.zValue,wr.contactPoint,wr.wheelSupport);
+    }
 
-    const int wr0 = wm0.Evaluate(dem,robotCenter+desc.wheelPositionsImage_[0],results.wheelEvalResults_[0]);
-    const int wr1 = wm1.Evaluate(dem,robotCenter+desc.wheelPositionsImage_[1],results.wheelEvalResults_[1]);
-    const int wr2 = wm2.Evaluate(dem,robotCenter+desc.wheelPositionsImage_[2],results.wheelEvalResults_[2]);
-    const int wr3 = wm3.Evaluate(dem,robotCenter+desc.wheelPositionsImage_[3],results.wheelEvalResults_[3]);
+    return EvaluatePoseFromWheels(dem,results,angleIdx,robotCenter,pyramid);
+}
 
-    if (wr0 == -1 || wr1 == -1 || wr2 == -1 || wr3 == -1)
+bool RobotModel::CoarseRejectWheels(const cv::Mat &dem, const DemPyramid &pyramid, PoseEvalResults &results, const cv::Point2i *imagePos) const
+{
+    int zLow[4];
+    bool hasBound[4];
+    bool reject = false;
+
+    for (int w = 0; w < 4;++w)
     {
-        results.validState = PERS_OUTOFIMAGE;
-        return PERS_OUTOFIMAGE;
+        hasBound[w] = wheels_[w].GetZValueLowerBound(pyramid,imagePos[w],results.wheelEvalResults_[w].wheelAngleIdx,zLow[w]);
+        // the scorer rejects the pose if one wheel is below validThreshold, zPos decreases with zValue
+        if (hasBound[w] && GetWheelZPos(zLow[w]) < procConfig_.validThreshold) reject = true;
+    }
+
+    if (!reject) return false;
+
+    // wheels with a bound keep the bound as zValue, so the scorer test gives the same result as with the full evaluation
+    for (int w = 0; w < 4;++w)
+    {
+        WheelEvalResults &wr = results.wheelEvalResults_[w];
+        if (hasBound[w])
+        {
+            wr.zValue = zLow[w];
+            wr.contactPoint = cv::Point2i(0,0);
+            wr.wheelSupport = 0;
+        }
+        else
+        {
+            wheels_[w].EvaluateAt(dem,imagePos[w],wr.wheelAngleIdx,wr.zValue,wr.contactPoint,wr.wheelSupport);
+        }
+        wr.zPos = GetWheelZPos(wr.zValue);
+    }
+
+    results.validState = PERS_NOWHEELSUPPORT;
+    return true;
+}
+
+void RobotModel::EvaluatePoses(const cv::Mat &dem, PoseEvalResults *results, const int count, PoseBatch &batch, const DemPyramid *pyramid) const
+{
+    batch.Resize(count);
+
+    // template positions of all wheels
+    for (int i = 0; i < count;++i)
+    {
+        PoseEvalResults &res = results[i];
+        const float angle = NormalizeAngle(res.pose.z);
+        const int angleIdx = GetAngleIdxFast(angle);
+        const RobotDescriptor &desc = GetDescriptor(angleIdx);
+        const cv::Point2f robotCenter = cv::Point2f(res.pose.x,res.pose.y)-desc.baseLinkPosImage_;
+
+        batch.angleIdx[i] = angleIdx;
+        batch.robotCenter[i] = robotCenter;
+        batch.outOfImage[i] = 0;
+
+        for (int w = 0; w < 4;++w)
+        {
+            WheelEvalResults &wr = res.wheelEvalResults_[w];
+            SetWheelAngle(angle,angleIdx,wheels_[w],wr);
+            if (!wheels_[w].GetTemplatePos(dem,robotCenter+desc.wheelPositionsImage_[w],wr.wheelAngleIdx,batch.imagePos[w][i])) batch.outOfImage[i] = 1;
+        }
+
+        if (batch.outOfImage[i] || pyramid == nullptr) continue;
+
+        const cv::Point2i imagePos[4] = {batch.imagePos[0][i],batch.imagePos[1][i],batch.imagePos[2][i],batch.imagePos[3][i]};
+        if (CoarseRejectWheels(dem,*pyramid,res,imagePos)) batch.outOfImage[i] = 2;
+    }
+
+    // match wheel by wheel, sorted by template and dem row
+    for (int w = 0; w < 4;++w)
+    {
+        const WheelModel &wm = wheels_[w];
+        const std::vector<cv::Point2i> &imagePos = batch.imagePos[w];
+
+        int numValid = 0;
+        for (int i = 0; i < count;++i)
+        {
+            if (!batch.outOfImage[i]) batch.order[numValid++] = i;
+        }
+
+        std::sort(batch.order.begin(),batch.order.begin()+numValid,[results,w,&imagePos](const int a, const int b)
+        {
+            const int ia = results[a].wheelEvalResults_[w].wheelAngleIdx;
+            const int ib = results[b].wheelEvalResults_[w].wheelAngleIdx;
+            if (ia != ib) return ia < ib;
+            if (imagePos[a].y != imagePos[b].y) return imagePos[a].y < imagePos[b].y;
+            return imagePos[a].x < imagePos[b].x;
+        });
+
+        for (int k = 0; k < numValid;++k)
+        {
+            const int i = batch.order[k];
+            if (k+1 < numValid)
+            {
+                const int next = batch.order[k+1];
+                wm.PrefetchDem(dem,imagePos[next],results[next].wheelEvalResults_[w].wheelAngleIdx);
+            }
+
+            wm.EvaluateAt(dem,imagePos[i],results[i].wheelEvalResults_[w].wheelAngleIdx,batch.zValue[w][i],batch.contactPoint[w][i],batch.wheelSupport[w][i]);
+        }
+    }
+
+    for (int i = 0; i < count;++i)
+    {
+        PoseEvalResults &res = results[i];
+        if (batch.outOfImage[i] == 1) res.validState = PERS_OUTOFIMAGE;
+        if (batch.outOfImage[i]) continue;
+
+        for (int w = 0; w < 4;++w)
+        {
+            WheelEvalResults &wr = res.wheelEvalResults_[w];
+            wr.zValue = batch.zValue[w][i];
+            wr.contactPoint = batch.contactPoint[w][i];
+            wr.wheelSupport = batch.wheelSupport[w][i];
+        }
+
+        EvaluatePoseFromWheels(dem,res,batch.angleIdx[i],batch.robotCenter[i],pyramid);
     }
+}
+
+int RobotModel::EvaluatePoseFromWheels(const cv::Mat &dem, PoseEvalResults &results, const int angleIdx, const cv::Point2f &robotCenter, const DemPyramid *pyramid) const
+{
+    const RobotDescriptor &desc = GetDescriptor(angleIdx);
 
-    const float z0 = -(float)(results.wheelEvalResults_[0].zValue-procConfig_.imapBaseHeight)*procConfig_.heightScaleInv;
-    const float z1 = -(float)(results.wheelEvalResults_[1].zValue-procConfig_.imapBaseHeight)*procConfig_.heightScaleInv;
-    const float z2 = -(float)(results.wheelEvalResults_[2].zValue-procConfig_.imapBaseHeight)*procConfig_.heightScaleInv;
-    const float z3 = -(float)(results.wheelEvalResults_[3].zValue-procConfig_.imapBaseHeight)*procConfig_.heightScaleInv;
+    const float z0 = GetWheelZPos(results.wheelEvalResults_[0].zValue);
+    const float z1 = GetWheelZPos(results.wheelEvalResults_[1].zValue);
+    const float z2 = GetWheelZPos(results.wheelEvalResults_[2].zValue);
+    const float z3 = GetWheelZPos(results.wheelEvalResults_[3].zValue);
 
 
     const float d01 = z0-z1;
@@ -303,14 +430,14 @@ int RobotModel::EvaluatePose(const cv::Mat &dem, PoseEvalResults &results) const
 
         int cx1 = 0;
         int cy1 = 0;
-        int chassisTestA = chassisModel_.EvaluateNP(dem,startValA,dx1,dy1,robotCenter+desc.chassisPosImage_,angleIdx,cx1,cy1);
+        int chassisTestA = EvaluateChassis(dem,pyramid,startValA,dx1,dy1,robotCenter+desc.chassisPosImage_,angleIdx,cx1,cy1);
 
         int cx2 = 0;
         int cy2 = 0;
         int chassisTestB = chassisTestA;
         if (results.tipAngle < config_.chassisTestTipAngleThreshold)
         {
-            chassisTestB = chassisModel_.EvaluateNP(dem,startValB,dx2,dy2,robotCenter+desc.chassisPosImage_,angleIdx,cx2,cy2);
+            chassisTestB = EvaluateChassis(dem,pyramid,startValB,dx2,dy2,robotCenter+desc.chassisPosImage_,angleIdx,cx2,cy2);
         }
 
         results.caContactX1 = cx1;
@@ -0,0 +1,72 @@
+#include "utils_diff.h"
+
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace Utils_DIFF
+{
+
+#if defined(__x86_64__) || defined(__i386__)
+/// Read the extended control register to check which register states are saved by the operating system
+static unsigned long long ReadXCR0()
+{
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+}
+#endif
+
+InstructionSet DetectInstructionSet()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1,&eax,&ebx,&ecx,&edx)) return IS_SSE41;
+
+    const bool osxsave = (ecx & (1u << 27)) != 0;
+    const bool avx = (ecx & (1u << 28)) != 0;
+    if (!osxsave || !avx) return IS_SSE41;
+
+    const unsigned long long xcr0 = ReadXCR0();
+    /// XMM and YMM state
+    if ((xcr0 & 0x6) != 0x6) return IS_SSE41;
+
+    if (__get_cpuid_max(0,0) < 7) return IS_SSE41;
+    __cpuid_count(7,0,eax,ebx,ecx,edx);
+
+    const bool avx2 = (ebx & (1u << 5)) != 0;
+    const bool avx512f = (ebx & (1u << 16)) != 0;
+    const bool avx512bw = (ebx & (1u << 30)) != 0;
+
+    /// additionally opmask and ZMM state
+    if (avx512f && avx512bw && (xcr0 & 0xe6) == 0xe6) return IS_AVX512BW;
+    if (avx2) return IS_AVX2;
+#endif
+    return IS_SSE41;
+}
+
+const DiffKernels& SelectKernels()
+{
+    static std::once_flag selected;
+
+    std::call_once(selected, []()
+    {
+        const InstructionSet isa = DetectInstructionSet();
+
+        /// fall back to the next lower variant, if a variant was not compiled
+        DiffKernels kernels;
+        bool found = false;
+        if (isa >= IS_AVX512BW) found = GetKernelsAVX512(kernels);
+        if (!found && isa >= IS_AVX2) found = GetKernelsAVX2(kernels);
+        if (!found) GetKernelsSSE(kernels);
+
+        activeKernels = kernels;
+    });
+
+    return activeKernels;
+}
+
+}
@@ -0,0 +1,23 @@
+#include "utils_diff.h"
+#include "utils_diff_axv.h"
+
+/// The kernels are compiled for AVX2 by their target attribute (MBP_TARGET_AVX2)
+
+namespace Utils_DIFF
+{
+
+bool GetKernelsAVX2(DiffKernels &kernels)
+{
+    kernels.isa = IS_AVX2;
+    kernels.name = "AVX2";
+    kernels.diffMinPos = &AVX2::diffMinPos;
+    kernels.np_diffMinPos = &AVX2::np_diffMinPos;
+    kernels.calcWheelSupport = &AVX2::calcWheelSupport;
+    kernels.ws_diffMinPos = &AVX2::ws_diffMinPos;
+    kernels.testChassis = &AVX2::testChassis;
+    kernels.np_testChassis = &AVX2::np_testChassis;
+    kernels.warpChassis = &AVX2::warpChassis;
+    return true;
+}
+
+}
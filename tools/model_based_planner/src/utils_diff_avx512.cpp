@@ -0,0 +1,37 @@
+#include "utils_diff.h"
+
+/// The kernels are compiled for AVX-512BW by their target attribute (MBP_TARGET_AVX512), MBP_NO_AVX512 is defined if the compiler does not support it
+
+#ifndef MBP_NO_AVX512
+#include "utils_diff_avx512.h"
+#endif
+
+namespace Utils_DIFF
+{
+
+#ifndef MBP_NO_AVX512
+
+bool GetKernelsAVX512(DiffKernels &kernels)
+{
+    // the chassis functions have no AVX-512 variant, use the AVX2 ones (AVX-512BW implies AVX2)
+    if (!GetKernelsAVX2(kernels)) return false;
+
+    kernels.isa = IS_AVX512BW;
+    kernels.name = "AVX-512BW";
+    kernels.diffMinPos = &AVX512::diffMinPos;
+    kernels.np_diffMinPos = &AVX512::np_diffMinPos;
+    kernels.calcWheelSupport = &AVX512::calcWheelSupport;
+    kernels.ws_diffMinPos = &AVX512::ws_diffMinPos;
+    return true;
+}
+
+#else
+
+bool GetKernelsAVX512(DiffKernels &/*kernels*/)
+{
+    return false;
+}
+
+#endif
+
+}
@@ -0,0 +1,36 @@
+#include "utils_diff.h"
+#include "utils_diff_sse.h"
+
+/// The kernels are compiled for SSE4.1 by their target attribute (MBP_TARGET_SSE41)
+
+namespace Utils_DIFF
+{
+
+/// SSE4.1 is the baseline, the table is constant initialized so it can be used before SelectKernels() is called
+DiffKernels activeKernels = {
+    IS_SSE41,
+    "SSE4.1",
+    &SSE::diffMinPos,
+    &SSE::np_diffMinPos,
+    &SSE::calcWheelSupport,
+    &SSE::ws_diffMinPos,
+    &SSE::testChassis,
+    &SSE::np_testChassis,
+    &SSE::warpChassis
+};
+
+bool GetKernelsSSE(DiffKernels &kernels)
+{
+    kernels.isa = IS_SSE41;
+    kernels.name = "SSE4.1";
+    kernels.diffMinPos = &SSE::diffMinPos;
+    kernels.np_diffMinPos = &SSE::np_diffMinPos;
+    kernels.calcWheelSupport = &SSE::calcWheelSupport;
+    kernels.ws_diffMinPos = &SSE::ws_diffMinPos;
+    kernels.testChassis = &SSE::testChassis;
+    kernels.np_testChassis = &SSE::np_testChassis;
+    kernels.warpChassis = &SSE::warpChassis;
+    return true;
+}
+
+}
@@ -1,6 +1,7 @@
 #include "wheelmodel.h"
 #include "wheelrender.h"
 #include "utils_diff.h"
+#include "descriptorcache.h"
 
 WheelModel::WheelModel()
 {
@@ -10,23 +11,23 @@ WheelModel::WheelModel()
 
 int WheelModel::Evaluate(const cv::Mat &dem,const cv::Point2f &pos, WheelEvalResults &results) const
 {
-    const WheelDescriptor &desc = descriptors_[results.wheelAngleIdx];
+    cv::Point2i imagePos;
+    if (!GetTemplatePos(dem,pos,results.wheelAngleIdx,imagePos)) return -1;
 
-    const cv::Point2i imagePos = GetImagePos(pos,desc);
-
-    if (imagePos.x < 0 || imagePos.y < 0 ) return -1;
+    EvaluateAt(dem,imagePos,results.wheelAngleIdx,results.zValue,results.contactPoint,results.wheelSupport);
+    return 0;
+}
 
+void WheelModel::EvaluateAt(const cv::Mat &dem,const cv::Point2i &imagePos, const int angleIdx, int &zValue, cv::Point2i &contactPoint, float &wheelSupport) const
+{
+    const WheelDescriptor &desc = descriptors_[angleIdx];
     const cv::Mat &wImg = desc.image_->mat_;
 
-    if (imagePos.x + wImg.cols > dem.cols || imagePos.y + wImg.rows > dem.rows ) return -1;
+    //zValue = Utils_DIFF::diffMinPos(dem,wImg,imagePos.x,imagePos.y,contactPoint.x,contactPoint.y);
+    zValue = Utils_DIFF::np_diffMinPos(dem,wImg,imagePos.x,imagePos.y,contactPoint.x,contactPoint.y);
 
-    //results.zValue = Utils_DIFF::diffMinPos(dem,wImg,imagePos.x,imagePos.y,results.contactPoint.x,results.contactPoint.y);
-    results.zValue = Utils_DIFF::np_diffMinPos(dem,wImg,imagePos.x,imagePos.y,results.contactPoint.x,results.contactPoint.y);
-
-
-    const int wsPixels = Utils_DIFF::calcWheelSupport(dem,wImg,imagePos.x,imagePos.y,wheelSupportThreshold_,results.zValue);
-    results.wheelSupport = (float)wsPixels*desc.numImagePixelsInv_;
-    return 0;
+    const int wsPixels = Utils_DIFF::calcWheelSupport(dem,wImg,imagePos.x,imagePos.y,wheelSupportThreshold_,zValue);
+    wheelSupport = (float)wsPixels*desc.numImagePixelsInv_;
 }
 
 /*
@@ -129,6 +130,14 @@ void WheelModel::SetupWheel(const ProcConfig& pc, const WheelConfig &conf)
 
     descriptors_.clear();
 
+    const uint64_t cacheHash = DescriptorCache::HashWheel(pc,config_);
+    if (DescriptorCache::Load(pc.descriptorCacheDir,cacheHash,descriptors_) && (int)descriptors_.size() == pc.numAngleStep)
+    {
+        SetTemplateBounds();
+        return;
+    }
+    descriptors_.clear();
+
 
     for (int tl = 0; tl < pc.numAngleStep;++tl)
     {
@@ -142,8 +151,19 @@ void WheelModel::SetupWheel(const ProcConfig& pc, const WheelConfig &conf)
 
     }
 
+    SetTemplateBounds();
+
+    DescriptorCache::Save(pc.descriptorCacheDir,cacheHash,descriptors_);
 
+}
 
+void WheelModel::SetTemplateBounds()
+{
+    for (unsigned int tl = 0; tl < descriptors_.size();++tl)
+    {
+        WheelDescriptor &desc = descriptors_[tl];
+        DemPyramid::GetTemplateBounds(desc.image_->mat_,desc.minValue_,desc.maxValue_);
+    }
 }
 
 
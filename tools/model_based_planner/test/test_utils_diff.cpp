@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "utils_diff.h"
+#include "cv_aligned_mat.h"
+
+using namespace Utils_DIFF;
+
+namespace
+{
+
+const int mapBaseHeight = 10000;
+const int wheelGroundLevel = 20000;
+const int maxHeight = 30000;
+
+//! All compiled variants the CPU supports
+std::vector<DiffKernels> availableKernels()
+{
+    const InstructionSet isa = DetectInstructionSet();
+
+    std::vector<DiffKernels> res;
+    DiffKernels kernels;
+    if (GetKernelsSSE(kernels)) res.push_back(kernels);
+    if (isa >= IS_AVX2 && GetKernelsAVX2(kernels)) res.push_back(kernels);
+    if (isa >= IS_AVX512BW && GetKernelsAVX512(kernels)) res.push_back(kernels);
+    return res;
+}
+
+//! Wheel template as WheelRender creates it: wheel pixels above the ground level, masked pixels and the row padding at maxHeight
+CVAlignedMat::ptr randomWheel(std::mt19937 &rng, int cols, int rows)
+{
+    std::uniform_int_distribution<int> height(wheelGroundLevel, wheelGroundLevel+300);
+    std::uniform_int_distribution<int> masked(0, 9);
+
+    CVAlignedMat::ptr wheel = CVAlignedMat::Create(cols,rows,CV_16S);
+    for (int y = 0; y < rows; ++y)
+    {
+        short* p = wheel->mat_.ptr<short>(y);
+        for (int x = 0; x < (int)wheel->mat_.step/2; ++x)
+        {
+            p[x] = (x >= cols || masked(rng) == 0) ? maxHeight : height(rng);
+        }
+    }
+    return wheel;
+}
+
+//! DEM around the base height with few values and some cells above the wheel, so that ties and negative differences occur
+CVAlignedMat::ptr randomDem(std::mt19937 &rng, int cols, int rows)
+{
+    std::uniform_int_distribution<int> height(mapBaseHeight-20, mapBaseHeight+20);
+    std::uniform_int_distribution<int> special(0, 99);
+
+    CVAlignedMat::ptr dem = CVAlignedMat::Create(cols,rows,CV_16S);
+    for (int y = 0; y < rows; ++y)
+    {
+        short* p = dem->mat_.ptr<short>(y);
+        for (int x = 0; x < (int)dem->mat_.step/2; ++x)
+        {
+            const int s = special(rng);
+            if (s == 0) p[x] = 0;
+            else if (s < 3) p[x] = wheelGroundLevel+1000+s;
+            else p[x] = height(rng);
+        }
+    }
+    return dem;
+}
+
+struct Reference
+{
+    int zval, rxp, ryp;
+};
+
+//! Scalar reference: signed minimum over the whole template row including the padding, first occurrence in row major order
+Reference referenceMinPos(const cv::Mat &dem, const cv::Mat &wheel, int tx, int ty)
+{
+    Reference ref = {30000, 0, 0};
+    for (int y = 0; y < wheel.rows; ++y)
+    {
+        const short* srcP = dem.ptr<short>(ty+y)+tx;
+        const short* tmpP = wheel.ptr<short>(y);
+        for (int x = 0; x < (int)wheel.step/2; ++x)
+        {
+            const int diff = (short)(tmpP[x]-srcP[x]);
+            if (diff < ref.zval)
+            {
+                ref.zval = diff;
+                ref.rxp = x;
+                ref.ryp = y;
+            }
+        }
+    }
+    return ref;
+}
+
+int referenceWheelSupport(const cv::Mat &dem, const cv::Mat &wheel, int tx, int ty, int wsThresh, int zval)
+{
+    int support = 0;
+    for (int y = 0; y < wheel.rows; ++y)
+    {
+        const short* srcP = dem.ptr<short>(ty+y)+tx;
+        const short* tmpP = wheel.ptr<short>(y);
+        for (int x = 0; x < (int)wheel.step/2; ++x)
+        {
+            if ((short)(tmpP[x]-srcP[x]-zval) < wsThresh) ++support;
+        }
+    }
+    return support;
+}
+
+}
+
+TEST(TestUtilsDiff, variantsAgree)
+{
+    const std::vector<DiffKernels> kernels = availableKernels();
+    ASSERT_FALSE(kernels.empty());
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> wheelCols(1, 70);
+    std::uniform_int_distribution<int> wheelRows(1, 40);
+    std::uniform_int_distribution<int> wsThreshDist(0, 400);
+
+    const int demCols = 160;
+    const int demRows = 100;
+
+    for (int i = 0; i < 500; ++i)
+    {
+        CVAlignedMat::ptr wheel = randomWheel(rng,wheelCols(rng),wheelRows(rng));
+        CVAlignedMat::ptr dem = randomDem(rng,demCols,demRows);
+        const cv::Mat &w = wheel->mat_;
+        const cv::Mat &d = dem->mat_;
+
+        // the kernels read the whole padded template row from the DEM
+        std::uniform_int_distribution<int> txDist(0, demCols-(int)w.step/2);
+        std::uniform_int_distribution<int> tyDist(0, demRows-w.rows);
+        const int tx = txDist(rng);
+        const int ty = tyDist(rng);
+        const int wsThresh = wsThreshDist(rng);
+
+        const Reference ref = referenceMinPos(d,w,tx,ty);
+        const int refSupport = referenceWheelSupport(d,w,tx,ty,wsThresh,ref.zval);
+
+        for (const DiffKernels &k : kernels)
+        {
+            SCOPED_TRACE(k.name);
+
+            int rxp = -1, ryp = -1;
+            EXPECT_EQ(ref.zval, k.diffMinPos(d,w,tx,ty,rxp,ryp));
+            EXPECT_EQ(ref.rxp, rxp);
+            EXPECT_EQ(ref.ryp, ryp);
+
+            EXPECT_EQ(ref.zval, k.np_diffMinPos(d,w,tx,ty,rxp,ryp));
+
+            int wsRes = -1;
+            rxp = -1;
+            ryp = -1;
+            EXPECT_EQ(ref.zval, k.ws_diffMinPos(d,w,tx,ty,wsThresh,rxp,ryp,wsRes));
+            EXPECT_EQ(ref.rxp, rxp);
+            EXPECT_EQ(ref.ryp, ryp);
+            EXPECT_EQ(refSupport, wsRes);
+
+            EXPECT_EQ(refSupport, k.calcWheelSupport(d,w,tx,ty,wsThresh,ref.zval));
+        }
+    }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -8,14 +8,19 @@
 #include <ros/ros.h>
 #include <nav_msgs/OccupancyGrid.h>
 #include <nav_msgs/GetMap.h>
+#include <path_msgs/tiled_map.h>
 #include <opencv2/opencv.hpp>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 class ROIMapNode
 {
 public:
 
     ROIMapNode(ros::NodeHandle &nh)
-        : running_avg_(0), running_avg_ticks_(0)
+        : has_box_(false), running_avg_(0), running_avg_ticks_(0)
     {
         std::string map_topic ("map/hector");
         std::string map_service ("/dynamic_map/hector");
@@ -29,8 +34,21 @@ public:
         nh.param("padding", padding_, 0.0);
         nh.param("null", null_, -1);
 
+        // optional tiled transport of the result, only the changed tiles are sent
+        std::string map_tiles_topic_result;
+        nh.param("topic_map_tiles_result", map_tiles_topic_result, map_tiles_topic_result);
+        int keyframe_interval;
+        nh.param("tile_size", tile_size_, 64);
+        nh.param("tile_keyframe_interval", keyframe_interval, 50);
+        tile_size_ = std::max(tile_size_, 1);
+        tile_encoder_ = path_msgs::TiledMapEncoder(tile_size_, keyframe_interval);
+
         map_subscriber_ = nh.subscribe<nav_msgs::OccupancyGrid> (map_topic, 10, boost::bind(&ROIMapNode::updateMapCallback, this, _1));
         map_publisher_  = nh.advertise<nav_msgs::OccupancyGrid> (map_topic_result, 10, true);
+        if(!map_tiles_topic_result.empty()) {
+            tiles_publisher_ = nh.advertise<path_msgs::TiledMap> (map_tiles_topic_result, 10,
+                                                                  boost::bind(&ROIMapNode::tilesSubscriberConnected, this, _1));
+        }
 
 
         map_service_client = nh.serviceClient<nav_msgs::GetMap> (map_service);
@@ -60,36 +78,54 @@ public:
             }
 
             map_publisher_.publish(current_map_);
+
+            if(tiles_publisher_) {
+                // the tiled map is cropped at tile borders of the input map, so the tiles stay in place when the region of interest grows
+                cv::Rect tiled_roi;
+                tiled_roi.x = roi_.x / tile_size_ * tile_size_;
+                tiled_roi.y = roi_.y / tile_size_ * tile_size_;
+                tiled_roi.width  = std::min(((roi_.x + roi_.width - 1) / tile_size_ + 1) * tile_size_, (int) ptr->info.width) - tiled_roi.x;
+                tiled_roi.height = std::min(((roi_.y + roi_.height - 1) / tile_size_ + 1) * tile_size_, (int) ptr->info.height) - tiled_roi.y;
+                crop(*ptr, tiled_roi, tiled_map_);
+                tiled_map_.header = ptr->header;
+
+                publishTiles();
+            }
         } catch(const std::exception& e) {
             ROS_ERROR_STREAM("shrinking map failed with " << e.what());
         }
     }
 
-    bool updateMap(const nav_msgs::OccupancyGrid &map)
+    void tilesSubscriberConnected(const ros::SingleSubscriberPublisher&)
+    {
+        // deltas are of no use without the map they are based on, a new subscriber gets a keyframe of the last map right away
+        if(tiled_map_.data.empty()) {
+            return;
+        }
+        tile_encoder_.forceKeyframe();
+        publishTiles();
+    }
+
+    void publishTiles()
     {
-        map_data_ = map.data;
+        path_msgs::TiledMap tiles;
+        if(tile_encoder_.encode(tiled_map_, tiles)) {
+            tiles_publisher_.publish(tiles);
+        }
+    }
 
+    bool updateMap(const nav_msgs::OccupancyGrid &map)
+    {
         ros::Time start = ros::Time::now();
 
-        cv::Mat working(map.info.height, map.info.width, CV_8SC1, map_data_.data());
-        cv::Point min(map.info.width, map.info.height);
-        cv::Point max(-1,-1);
-
-        bool empty = true;
-        int8_t* ptr = working.ptr<int8_t>();
-        for(int y = 0 ; y < working.rows ; ++y) {
-            for(int x = 0 ; x < working.cols ; ++x) {
-                if(ptr[y * working.cols + x] != null_) {
-                   min.x = std::min(min.x, x);
-                   min.y = std::min(min.y, y);
-                   max.x = std::max(max.x, x);
-                   max.y = std::max(max.y, y);
-                   empty = false;
-                }
-            }
+        const int cols = map.info.width;
+        const int rows = map.info.height;
+        if(cols <= 0 || rows <= 0 || (int) map.data.size() < cols * rows) {
+            return false;
         }
 
-        if(empty) {
+        cv::Point min, max;
+        if(!findBoundingBox(map, min, max)) {
             return false;
         }
 
@@ -97,52 +133,210 @@ public:
         int padding = std::floor(padding_ / map.info.resolution + 0.5);
         min.x = std::max(min.x - padding, 0);
         min.y = std::max(min.y - padding, 0);
-        max.x = std::min(max.x + padding, working.cols - 1);
-        max.y = std::min(max.y + padding, working.rows - 1);
-
-        int width  = max.x - min.x;
-        int height = max.y - min.y;
-        cv::Rect roi(min.x , min.y, width, height);
-
-        current_map_.data.resize(width * height);
-        int8_t *data_ptr = current_map_.data.data();
-        for(int y = 0 ; y < height ; ++y) {
-            for(int x = 0 ; x < width ; ++x) {
-                 data_ptr[y * width + x] = ptr[(min.y + y) * working.cols + (min.x + x)];
-            }
-        }
+        max.x = std::min(max.x + padding, cols - 1);
+        max.y = std::min(max.y + padding, rows - 1);
 
-        current_map_.info                    = map.info;
-        current_map_.info.height             = height;
-        current_map_.info.width              = width;
-        current_map_.info.origin.position.x += roi.x * map.info.resolution;
-        current_map_.info.origin.position.y += roi.y * map.info.resolution;
+        int width  = max.x - min.x + 1;
+        int height = max.y - min.y + 1;
+        roi_ = cv::Rect(min.x , min.y, width, height);
+
+        crop(map, roi_, current_map_);
 
         ros::Duration diff = ros::Time::now() - start;
         double diff_ms =  diff.toNSec() * 1e-6;
         running_avg_ticks_++;
         running_avg_ = (running_avg_ * (running_avg_ticks_-1) / running_avg_ticks_) + diff_ms / running_avg_ticks_;
-        ROS_INFO_STREAM("map shrink took " << diff_ms << "ms , sampling: " << sampling_ << "] [avg. " << running_avg_ << "ms]");
+        ROS_INFO_STREAM("map shrink took " << diff_ms << "ms [avg. " << running_avg_ << "ms]");
 
         return true;
     }
 
 
 private:
+    /**
+     * @brief Copies roi of map into out, straight from the message with one copy per row
+     */
+    static void crop(const nav_msgs::OccupancyGrid &map, const cv::Rect &roi, nav_msgs::OccupancyGrid &out)
+    {
+        const int cols = map.info.width;
+        const int8_t* ptr = map.data.data();
+
+        out.data.resize(roi.width * roi.height);
+        int8_t *data_ptr = out.data.data();
+        for(int y = 0 ; y < roi.height ; ++y) {
+            memcpy(data_ptr + y * roi.width, ptr + (roi.y + y) * cols + roi.x, roi.width);
+        }
+
+        out.info                    = map.info;
+        out.info.height             = roi.height;
+        out.info.width              = roi.width;
+        out.info.origin.position.x += roi.x * map.info.resolution;
+        out.info.origin.position.y += roi.y * map.info.resolution;
+    }
+
+    /**
+     * @brief Index of the first cell in row[0,n) that is not null, -1 if there is none
+     */
+    static int firstNotNull(const int8_t* row, int n, int8_t null)
+    {
+        int x = 0;
+#ifdef __SSE2__
+        const __m128i nullv = _mm_set1_epi8(null);
+        for(; x + 16 <= n ; x += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i*) (row + x));
+            const int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, nullv)) & 0xFFFF;
+            if(mask) {
+                return x + __builtin_ctz(mask);
+            }
+        }
+#endif
+        for(; x < n ; ++x) {
+            if(row[x] != null) {
+                return x;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Index of the last cell in row[0,n) that is not null, -1 if there is none
+     */
+    static int lastNotNull(const int8_t* row, int n, int8_t null)
+    {
+        int x = n;
+#ifdef __SSE2__
+        const __m128i nullv = _mm_set1_epi8(null);
+        for(; x >= 16 ; x -= 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i*) (row + x - 16));
+            const int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, nullv)) & 0xFFFF;
+            if(mask) {
+                return x - 16 + 31 - __builtin_clz(mask);
+            }
+        }
+#endif
+        for(--x; x >= 0 ; --x) {
+            if(row[x] != null) {
+                return x;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief True if the border of the last bounding box still touches non null cells, the new box then contains the last one
+     */
+    bool lastBoxStillValid(const nav_msgs::OccupancyGrid &map) const
+    {
+        if(!has_box_ || map.info.width != box_info_.width || map.info.height != box_info_.height ||
+                map.info.resolution != box_info_.resolution ||
+                map.info.origin.position.x != box_info_.origin.position.x ||
+                map.info.origin.position.y != box_info_.origin.position.y) {
+            return false;
+        }
+
+        const int8_t null = null_;
+        const int cols = map.info.width;
+        const int8_t* ptr = map.data.data();
+        const int boxWidth = box_max_.x - box_min_.x + 1;
+
+        if(firstNotNull(ptr + box_min_.y * cols + box_min_.x, boxWidth, null) < 0 ||
+                firstNotNull(ptr + box_max_.y * cols + box_min_.x, boxWidth, null) < 0) {
+            return false;
+        }
+
+        bool left = false, right = false;
+        for(int y = box_min_.y ; y <= box_max_.y && !(left && right) ; ++y) {
+            const int8_t* row = ptr + y * cols;
+            left  = left  || row[box_min_.x] != null;
+            right = right || row[box_max_.x] != null;
+        }
+        return left && right;
+    }
+
+    /**
+     * @brief Bounding box of all non null cells. Starts from the box of the last map if it is still valid, so only the cells outside of it are searched
+     */
+    bool findBoundingBox(const nav_msgs::OccupancyGrid &map, cv::Point &min, cv::Point &max)
+    {
+        const int8_t null = null_;
+        const int cols = map.info.width;
+        const int rows = map.info.height;
+        const int8_t* ptr = map.data.data();
+
+        const bool seeded = lastBoxStillValid(map);
+
+        // first and last rows containing data, rows inside of a valid last box need no test
+        int minY = seeded ? box_min_.y : rows;
+        for(int y = 0 ; y < minY ; ++y) {
+            if(firstNotNull(ptr + y * cols, cols, null) >= 0) {
+                minY = y;
+                break;
+            }
+        }
+        if(minY == rows) {
+            has_box_ = false;
+            return false;
+        }
+
+        int maxY = seeded ? box_max_.y : minY;
+        for(int y = rows - 1 ; y > maxY ; --y) {
+            if(firstNotNull(ptr + y * cols, cols, null) >= 0) {
+                maxY = y;
+                break;
+            }
+        }
+
+        // per row only the columns outside of the current box are searched
+        min = cv::Point(seeded ? box_min_.x : cols, minY);
+        max = cv::Point(seeded ? box_max_.x : -1, maxY);
+        for(int y = minY ; y <= maxY ; ++y) {
+            const int8_t* row = ptr + y * cols;
+            if(min.x > 0) {
+                const int x = firstNotNull(row, min.x, null);
+                if(x >= 0) {
+                    min.x = x;
+                }
+            }
+            if(max.x < cols - 1) {
+                const int x = lastNotNull(row + max.x + 1, cols - max.x - 1, null);
+                if(x >= 0) {
+                    max.x += 1 + x;
+                }
+            }
+        }
+
+        has_box_   = true;
+        box_min_   = min;
+        box_max_   = max;
+        box_info_  = map.info;
+        return true;
+    }
+
     ros::Subscriber     map_subscriber_;
     ros::Publisher      map_publisher_;
+    ros::Publisher      tiles_publisher_;
 
     ros::ServiceClient  map_service_client;
     ros::ServiceServer  map_service_;
 
     nav_msgs::OccupancyGrid current_map_;
-    std::vector<int8_t>     map_data_;
+    // region of interest of the last map in cells of the input map
+    cv::Rect                roi_;
+
+    nav_msgs::OccupancyGrid tiled_map_;
+    path_msgs::TiledMapEncoder tile_encoder_;
+    int                     tile_size_;
+
+    // bounding box of the last map, reused if the map geometry did not change
+    bool                    has_box_;
+    cv::Point               box_min_;
+    cv::Point               box_max_;
+    nav_msgs::MapMetaData   box_info_;
 
     int     null_;
 
     double  running_avg_;
     int     running_avg_ticks_;
-    int     sampling_;
 
     double padding_;
 };
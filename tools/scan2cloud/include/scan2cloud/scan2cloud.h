@@ -1,13 +1,8 @@
 #include <ros/ros.h>
 #include <tf/transform_listener.h>
-#include <laser_geometry/laser_geometry.h>
+#include <sensor_msgs/LaserScan.h>
 #include <sensor_msgs/PointCloud2.h>
-#include <pcl_ros/point_cloud.h>
-// pcl
-#include <pcl/point_cloud.h>
-#include <pcl/conversions.h>
-#include <pcl/point_types.h>
-#include <pcl/filters/statistical_outlier_removal.h>
+#include <stdint.h>
 
 
 class ScanConverter {
@@ -16,29 +11,97 @@ class ScanConverter {
         void scanCallback(const sensor_msgs::LaserScan::ConstPtr& scan_in, bool is_back);
         void spin();
      private:
+        /**
+         * @brief Projection state of one laser scanner
+         */
+        struct ScanInput
+        {
+            ScanInput():
+                hasTransform(false),
+                hasScan(false),
+                fresh(false),
+                numBeams(0),
+                angleMin(0),
+                angleIncrement(0)
+            {}
+
+            bool hasTransform;
+            std::string laserFrame;
+            /// laser to base transform, the scanner is assumed to be fixed on the robot
+            tf::StampedTransform laser2base;
+
+            bool hasScan;
+            /// true until the scan was published
+            bool fresh;
+            /// time of the last beam, the points are given in the base frame at this time
+            ros::Time stamp;
+            /// projected x,y,z of the valid beams
+            std::vector<float> points;
+
+            // per beam sin/cos, only recomputed if the scan geometry changes
+            size_t numBeams;
+            float angleMin;
+            float angleIncrement;
+            std::vector<float> cosTable;
+            std::vector<float> sinTable;
+        };
+
+        /**
+         * @brief Sparse 2D grid of point counts, a hash table that is cleared in O(1) by bumping a generation counter
+         */
+        struct CountGrid
+        {
+            CountGrid():
+                generation(0),
+                mask(0)
+            {}
+
+            void reset(size_t numPoints);
+            void add(int cx, int cy);
+            int count(int cx, int cy) const;
+
+            std::vector<int64_t> keys;
+            std::vector<int> counts;
+            std::vector<uint32_t> generations;
+            uint32_t generation;
+            size_t mask;
+        };
+
         ros::NodeHandle node_;
         ros::NodeHandle private_node_;
-        laser_geometry::LaserProjection projector_;
         tf::TransformListener tfListener_;
 
         ros::Publisher point_cloud_publisher_;
         ros::Subscriber scan_sub_back_;
         ros::Subscriber scan_sub_front_;
-        sensor_msgs::PointCloud2 cloud_front_;
-        sensor_msgs::PointCloud2 cloud_back_;
+        ScanInput scan_front_;
+        ScanInput scan_back_;
         sensor_msgs::PointCloud2 cloud_total_;
-
-
-        bool cbScanfront_;
-        bool cbScanback_;
+        CountGrid filterGrid_;
+        std::vector<int> filterCells_;
 
          // ros params
         std::string baseFrame_;
-        double cloudFilterMean_;
-        double cloudFilterStdD_;
+        /// frame used for motion compensation of scans with time_increment, empty to disable
+        std::string fixedFrame_;
+        /// maximum stamp difference of a front / back pair, <= 0 publishes every scan with the latest scan of the other scanner.
+        /// A scan without a partner in the window is published with the latest scan of the other scanner once the next scan of either scanner arrives
+        double syncWindow_;
+        /// scans of the other scanner older than this are not merged, a single scanner is published alone
+        double scanTimeout_;
+        bool filterCloud_;
+        /// a beam is an outlier if its range differs from both neighbouring beams by more than filterMaxJump + filterJumpRatio*range
+        double filterMaxJump_;
+        double filterJumpRatio_;
+        /// minimum number of points in the 3x3 cells around a point, including the point itself
+        int filterMinNeighbors_;
+        double filterCellSize_;
 
 
-        void mergeSensorMsgsPointCloud2();
-        void filter(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloudIn,
-                    pcl::PointCloud<pcl::PointXYZ>::Ptr &cloudOut);
+        bool projectScan(const sensor_msgs::LaserScan &scan, ScanInput &input, bool is_back);
+        void publishMerged(ScanInput &newest, ScanInput &other, bool mergeOther);
+        /**
+         * @brief Removes the points of isolated cells from input.points in O(n)
+         */
+        void filter(ScanInput &input);
 };
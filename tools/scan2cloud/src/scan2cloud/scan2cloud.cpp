@@ -1,13 +1,53 @@
 #include "../../include/scan2cloud/scan2cloud.h"
 
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+inline int64_t cellKey(int cx, int cy)
+{
+    return (int64_t)(((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy);
+}
+
+inline size_t cellHash(int64_t key)
+{
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+}
+
 ScanConverter::ScanConverter():
     private_node_("~")
 {
     // init parameter with a default value
     private_node_.param<std::string>("baseFrame",baseFrame_,"base_link");
+    private_node_.param<std::string>("fixedFrame",fixedFrame_,"odom");
+
+    private_node_.param<double>("syncWindow",syncWindow_,0.05);
+    private_node_.param<double>("scanTimeout",scanTimeout_,0.5);
 
-    private_node_.param<double>("cloudFilterMean",cloudFilterMean_,50.0);
-    private_node_.param<double>("cloudFilterStdD",cloudFilterStdD_,1.0);
+    private_node_.param<bool>("filterCloud",filterCloud_,true);
+    private_node_.param<double>("filterMaxJump",filterMaxJump_,0.1);
+    private_node_.param<double>("filterJumpRatio",filterJumpRatio_,0.05);
+    private_node_.param<int>("filterMinNeighbors",filterMinNeighbors_,3);
+    private_node_.param<double>("filterCellSize",filterCellSize_,0.15);
+
+    // compact x,y,z cloud, the data buffer is reused for every message
+    const char *names[3] = {"x","y","z"};
+    cloud_total_.fields.resize(3);
+    for (int i = 0; i < 3; ++i) {
+        cloud_total_.fields[i].name = names[i];
+        cloud_total_.fields[i].offset = i*sizeof(float);
+        cloud_total_.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+        cloud_total_.fields[i].count = 1;
+    }
+    cloud_total_.height = 1;
+    cloud_total_.point_step = 3*sizeof(float);
+    cloud_total_.is_bigendian = false;
+    cloud_total_.is_dense = true;
+    cloud_total_.header.frame_id = baseFrame_;
 
 
     scan_sub_front_ = node_.subscribe<sensor_msgs::LaserScan>(
@@ -18,97 +58,276 @@ ScanConverter::ScanConverter():
 }
 
 void ScanConverter::scanCallback(const sensor_msgs::LaserScan::ConstPtr &scan_in, bool is_back)
+{
+    ScanInput &input = is_back ? scan_back_ : scan_front_;
+    ScanInput &other = is_back ? scan_front_ : scan_back_;
+
+    // the last scan of this scanner was not published, no partner arrived within a whole scan period
+    const bool missedPartner = input.fresh;
+
+    if(!projectScan(*scan_in, input, is_back)){
+        return;
+    }
+
+    const double otherAge = std::fabs((input.stamp - other.stamp).toSec());
+    const bool otherRecent = other.hasScan && otherAge <= scanTimeout_;
+
+    if(syncWindow_ > 0.0){
+        // publish once per pair. If the scanners are not synchronized (different rates or an offset larger than the window),
+        // a scan is published with the latest scan of the other scanner instead of waiting for a partner that never comes.
+        if(other.fresh && otherAge <= syncWindow_){
+            publishMerged(input, other, true);
+        }else if(other.fresh || missedPartner || !otherRecent){
+            publishMerged(input, other, otherRecent);
+        }
+    }else{
+        publishMerged(input, other, otherRecent);
+    }
+}
+
+bool ScanConverter::projectScan(const sensor_msgs::LaserScan &scan, ScanInput &input, bool is_back)
 {
     ros::Duration wait_tf_timeout = is_back ? ros::Duration(0.0) : ros::Duration(0.1);
 
+    const size_t numBeams = scan.ranges.size();
+    // time of the last beam, the first beam is measured at the stamp of the scan
+    const double scanDuration = numBeams > 1 ? (numBeams-1)*(double)scan.time_increment : 0.0;
+    const ros::Time endStamp = scan.header.stamp + ros::Duration().fromSec(scanDuration);
+
     try{
-        if(!tfListener_.waitForTransform(
-                    scan_in->header.frame_id,
-                    baseFrame_,
-                    scan_in->header.stamp + ros::Duration().fromSec(scan_in->ranges.size()*scan_in->time_increment),
-                    wait_tf_timeout)){
-            ROS_ERROR_STREAM_THROTTLE(1.0, "cannot transform "  << (is_back ? "back" : "front") 
-                << " from frame " << scan_in->header.frame_id << " to " << baseFrame_);
-            return;
-        }
-        // as (at least in the simulation) there are end-of-range scans slightly below the
-        // range_max value, move the cutof to 99% of the range.
-        double range_cutoff = scan_in->range_max * 0.99;
-        if (is_back) {
-            projector_.transformLaserScanToPointCloud(baseFrame_, *scan_in, cloud_back_, tfListener_, range_cutoff);
-            cbScanback_ = true;
-        } else {
-            projector_.transformLaserScanToPointCloud(baseFrame_, *scan_in, cloud_front_, tfListener_, range_cutoff);
-            cbScanfront_ = true;
+        if(!input.hasTransform || input.laserFrame != scan.header.frame_id){
+            if(!tfListener_.waitForTransform(baseFrame_, scan.header.frame_id, endStamp, wait_tf_timeout)){
+                ROS_ERROR_STREAM_THROTTLE(1.0, "cannot transform "  << (is_back ? "back" : "front")
+                    << " from frame " << scan.header.frame_id << " to " << baseFrame_);
+                return false;
+            }
+            tfListener_.lookupTransform(baseFrame_, scan.header.frame_id, endStamp, input.laser2base);
+            input.laserFrame = scan.header.frame_id;
+            input.hasTransform = true;
         }
     } catch(...) {
-        // do nothing
+        return false;
+    }
+
+    if(numBeams != input.numBeams || scan.angle_min != input.angleMin || scan.angle_increment != input.angleIncrement){
+        input.cosTable.resize(numBeams);
+        input.sinTable.resize(numBeams);
+        for(size_t i = 0; i < numBeams; ++i){
+            const double angle = scan.angle_min + i*(double)scan.angle_increment;
+            input.cosTable[i] = std::cos(angle);
+            input.sinTable[i] = std::sin(angle);
+        }
+        input.numBeams = numBeams;
+        input.angleMin = scan.angle_min;
+        input.angleIncrement = scan.angle_increment;
+    }
+
+    // motion of the base between the first and the last beam, points are moved into the base frame at the last beam
+    bool compensate = false;
+    tf::StampedTransform motion;
+    motion.setIdentity();
+    if(scan.time_increment != 0.0f && numBeams > 1 && !fixedFrame_.empty()){
+        try{
+            if(tfListener_.waitForTransform(baseFrame_, endStamp, baseFrame_, scan.header.stamp, fixedFrame_, wait_tf_timeout)){
+                tfListener_.lookupTransform(baseFrame_, endStamp, baseFrame_, scan.header.stamp, fixedFrame_, motion);
+                compensate = true;
+            }
+        } catch(...) {
+            // project without compensation
+        }
+    }
+
+    const tf::Matrix3x3 &rot = input.laser2base.getBasis();
+    const tf::Vector3 &trans = input.laser2base.getOrigin();
+    const float r00 = rot[0][0], r01 = rot[0][1];
+    const float r10 = rot[1][0], r11 = rot[1][1];
+    const float r20 = rot[2][0], r21 = rot[2][1];
+    const float t0 = trans.x(), t1 = trans.y(), t2 = trans.z();
+
+    const tf::Quaternion identity = tf::Quaternion::getIdentity();
+    const tf::Quaternion motionRot = motion.getRotation();
+    const tf::Vector3 motionTrans = motion.getOrigin();
+
+    // as (at least in the simulation) there are end-of-range scans slightly below the
+    // range_max value, move the cutof to 99% of the range.
+    const float range_cutoff = scan.range_max * 0.99f;
+    const float range_min = scan.range_min;
+
+    const float maxJump = filterMaxJump_;
+    const float jumpRatio = filterJumpRatio_;
+
+    input.points.resize(3*numBeams);
+    float *outP = input.points.data();
+
+    for(size_t i = 0; i < numBeams; ++i){
+        const float range = scan.ranges[i];
+        // also rejects NAN
+        if(!(range >= range_min && range < range_cutoff)){
+            continue;
+        }
+
+        if(filterCloud_){
+            // single beams without a continuous neighbour are outliers, invalid neighbours are never continuous
+            const float jump = maxJump + jumpRatio*range;
+            const bool prevCont = i > 0 && std::fabs(scan.ranges[i-1] - range) <= jump;
+            const bool nextCont = i+1 < numBeams && std::fabs(scan.ranges[i+1] - range) <= jump;
+            if(!prevCont && !nextCont){
+                continue;
+            }
+        }
+
+        const float lx = range*input.cosTable[i];
+        const float ly = range*input.sinTable[i];
+
+        float px = r00*lx + r01*ly + t0;
+        float py = r10*lx + r11*ly + t1;
+        float pz = r20*lx + r21*ly + t2;
+
+        if(compensate){
+            // the first beam gets the full motion, the last one none
+            const double w = 1.0 - i/(double)(numBeams-1);
+            const tf::Transform beamMotion(identity.slerp(motionRot, w), motionTrans*w);
+            const tf::Vector3 p = beamMotion*tf::Vector3(px, py, pz);
+            px = p.x();
+            py = p.y();
+            pz = p.z();
+        }
+
+        outP[0] = px;
+        outP[1] = py;
+        outP[2] = pz;
+        outP += 3;
+    }
+
+    input.points.resize(outP - input.points.data());
+
+    if(filterCloud_){
+        filter(input);
     }
+
+    input.stamp = compensate ? endStamp : scan.header.stamp;
+    input.hasScan = true;
+    input.fresh = true;
+
+    return true;
 }
 
-void ScanConverter::spin()
+void ScanConverter::publishMerged(ScanInput &newest, ScanInput &other, bool mergeOther)
 {
+    const size_t numNewest = newest.points.size();
+    const size_t numOther = mergeOther ? other.points.size() : 0;
 
-    cbScanfront_ = false;
-    cbScanback_ = false;
-    ros::Rate loopRate(50);
-    while(ros::ok()){
-        //ros::spinOnce();
-        ros::getGlobalCallbackQueue()->callAvailable(ros::WallDuration(0));
+    cloud_total_.data.resize((numNewest + numOther)*sizeof(float));
+    float *outP = (float*)cloud_total_.data.data();
+    std::copy(newest.points.begin(), newest.points.end(), outP);
+    if(mergeOther){
+        std::copy(other.points.begin(), other.points.end(), outP + numNewest);
+        other.fresh = false;
+    }
+    newest.fresh = false;
 
-        if(cbScanfront_ || cbScanback_){
-            this->mergeSensorMsgsPointCloud2();
-            point_cloud_publisher_.publish(cloud_total_);
-        }
+    cloud_total_.width = (numNewest + numOther)/3;
+    cloud_total_.row_step = cloud_total_.width*cloud_total_.point_step;
+    cloud_total_.header.stamp = newest.stamp;
 
-        //this->updateParameter();
+    point_cloud_publisher_.publish(cloud_total_);
+}
 
-        loopRate.sleep();
+void ScanConverter::spin()
+{
+    // merging and publishing is driven by the scan callbacks
+    ros::spin();
+}
+
+void ScanConverter::CountGrid::reset(size_t numPoints)
+{
+    // at most a quarter of the slots are used
+    size_t size = 64;
+    while(size < 4*numPoints){
+        size *= 2;
+    }
+    if(keys.size() < size){
+        keys.resize(size);
+        counts.resize(size);
+        generations.assign(size, 0);
+        generation = 0;
+    }
+    mask = keys.size()-1;
+
+    if(++generation == 0){
+        std::fill(generations.begin(), generations.end(), 0);
+        generation = 1;
     }
 }
 
-void ScanConverter::mergeSensorMsgsPointCloud2()
+void ScanConverter::CountGrid::add(int cx, int cy)
 {
-    pcl::PointCloud<pcl::PointXYZ> combined_pcl;
-    pcl::PointCloud<pcl::PointXYZ> output_pcl_front;
-    pcl::PointCloud<pcl::PointXYZ> output_pcl_back;
-
-    if(cbScanfront_){
-        pcl::fromROSMsg(cloud_front_,output_pcl_front);
-        combined_pcl = output_pcl_front;
-    }
-    if(cbScanback_){
-        pcl::fromROSMsg(cloud_back_,output_pcl_back);
-        if(cbScanfront_){
-            combined_pcl += output_pcl_back;
-        }else{
-            combined_pcl = output_pcl_back;
+    const int64_t key = cellKey(cx, cy);
+    for(size_t slot = cellHash(key) & mask; ; slot = (slot+1) & mask){
+        if(generations[slot] != generation){
+            generations[slot] = generation;
+            keys[slot] = key;
+            counts[slot] = 1;
+            return;
+        }
+        if(keys[slot] == key){
+            ++counts[slot];
+            return;
         }
     }
+}
 
-    if(cbScanfront_ || cbScanback_){
-        pcl::toROSMsg(combined_pcl, cloud_total_);
-        cloud_total_.header.frame_id = baseFrame_;
+int ScanConverter::CountGrid::count(int cx, int cy) const
+{
+    const int64_t key = cellKey(cx, cy);
+    for(size_t slot = cellHash(key) & mask; generations[slot] == generation; slot = (slot+1) & mask){
+        if(keys[slot] == key){
+            return counts[slot];
+        }
     }
-
+    return 0;
 }
 
-void ScanConverter::filter(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloudIn,
-                           pcl::PointCloud<pcl::PointXYZ>::Ptr &cloudOut){
+void ScanConverter::filter(ScanInput &input)
+{
+    const size_t numPoints = input.points.size()/3;
+    if(numPoints == 0 || filterMinNeighbors_ <= 1){
+        return;
+    }
 
+    const float cellScale = 1.0/filterCellSize_;
 
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZ>);
+    filterGrid_.reset(numPoints);
+    filterCells_.resize(2*numPoints);
 
-    // Create the filtering object
-    pcl::StatisticalOutlierRemoval<pcl::PointXYZ> sor;
-    sor.setInputCloud (cloudIn);
-    sor.setMeanK (cloudFilterMean_);
-    sor.setStddevMulThresh (cloudFilterStdD_);
-    sor.filter (*cloud_filtered);
+    const float *pointP = input.points.data();
+    for(size_t i = 0; i < numPoints; ++i){
+        const int cx = (int)std::floor(pointP[3*i]*cellScale);
+        const int cy = (int)std::floor(pointP[3*i+1]*cellScale);
+        filterCells_[2*i] = cx;
+        filterCells_[2*i+1] = cy;
+        filterGrid_.add(cx, cy);
+    }
 
-    cloudOut = cloud_filtered;
+    float *outP = input.points.data();
+    for(size_t i = 0; i < numPoints; ++i){
+        const int cx = filterCells_[2*i];
+        const int cy = filterCells_[2*i+1];
 
-    cloudOut = cloudIn;
+        int neighbors = 0;
+        for(int dy = -1; dy <= 1 && neighbors < filterMinNeighbors_; ++dy){
+            for(int dx = -1; dx <= 1; ++dx){
+                neighbors += filterGrid_.count(cx+dx, cy+dy);
+            }
+        }
 
+        if(neighbors >= filterMinNeighbors_){
+            outP[0] = pointP[3*i];
+            outP[1] = pointP[3*i+1];
+            outP[2] = pointP[3*i+2];
+            outP += 3;
+        }
+    }
 
+    input.points.resize(outP - input.points.data());
 }